@@ -3,12 +3,23 @@
 
 #include "application.hpp"
 #include "model.hpp"
+#include "mesh_cache.hpp"
 #include "structs.hpp"
 #include "scene_graph.hpp"
 #include "geometry_node.hpp"
 #include "point_light_node.hpp"
 #include "pixel_data.hpp"
 #include "texture_loader.hpp"
+#include "gpu_culling.hpp"
+#include "texture_array.hpp"
+#include "texture_streamer.hpp"
+#include "asset_graph.hpp"
+#include "star_catalog.hpp"
+#include "cubemap.hpp"
+#include "trail_buffer.hpp"
+#include "gbuffer.hpp"
+#include "occlusion_culler.hpp"
+#include "command_buffer.hpp"
 
 // gpu representation of model
 class ApplicationSolar : public Application {
@@ -25,30 +36,75 @@ class ApplicationSolar : public Application {
   //handle resizing
   void resizeCallback(unsigned width, unsigned height);
 
+  // move camera along overview, orbit or flyby path
+  void scriptCamera(std::string const& scene, unsigned frame, unsigned num_frames);
+  // stream pending texture data
+  void update();
   // draw all objects
   void render() const;
 
   // Personal Code, draw single object--------------------
-  void renderObject(geometry_node * object, int count) const;
+  void recordObject(command_buffer& commands, geometry_node * object, shader_program const& program) const;
+  // draw the visible planets with given program
+  void renderPlanetList(shader_program const& program) const;
+  void animateObject(geometry_node * object) const;
   void renderPlanetObjects() const;
+  void renderPlanetObjectsIndirect() const;
+  void renderPlanetObjectsDeferred() const;
+  // collect planets not hidden behind large bodies
+  void cullOccludedPlanets();
   void renderStarObjects() const;
+  // which star chunks to draw, relative to the bake position of a cube map
+  enum class star_range {all, near, far};
+  void renderStarChunks(glm::fmat4 const& view_projection, glm::fvec3 const& eye, star_range range, glm::fvec3 const& bake_position) const;
+  void renderSkybox() const;
+  // orbit rings and motion trails
   void renderOrbitObjects() const;
 
  protected:
-  void initializeShaderPrograms();
-  void initializeGeometry();
+  // register loading tasks, gl objects are created by the upload methods
+  void initializeShaderPrograms(asset_graph& assets);
+  void initializeGeometry(asset_graph& assets);
   void initializeSceneGraph();
-  void initializeStars();
-  void initializeTextures();
+  void initializeStars(asset_graph& assets);
+  void initializeTextures(asset_graph& assets);
+  void uploadGeometry(mesh_cache::mesh const& planet_model);
+  void uploadStars(starfield& field);
+  void initializeSkybox();
+  void initializeOrbits();
+  void initializeDeferred();
+  // move moon rings and push newest trail samples
+  void updateOrbits();
+  // rebake far stars when the camera moved
+  void updateStarCubemap();
+  // bake next faces of the back cube map
+  void bakeStarFaces(unsigned num_faces);
+  static pixel_data loadPlanetImage(std::string const& path);
+  void uploadTextures(std::vector<cooked_texture>& cooked, std::vector<pixel_data>& layers);
   // update uniform values
   void uploadUniforms();
   // upload projection matrix
   void uploadProjection();
+  // static data of the planets in the gpu driven path
+  void uploadPlanetObjects();
+  // distances at which planets switch to coarser levels for this framebuffer height
+  void updatePlanetLods(unsigned height);
   // upload view matrix
   void uploadView();
 
   // cpu representation of model
   model_object planet_object;
+  // planet vertices are stored quantized, see vertex_format::quantize
+  bool m_quantized_vertices;
+  // bounds to dequantize planet positions and texture coordinates
+  glm::fvec3 planet_position_min;
+  glm::fvec3 planet_position_extent;
+  glm::fvec2 planet_texcoord_min;
+  glm::fvec2 planet_texcoord_extent;
+  // errors of the cooked planet levels of detail
+  std::vector<mesh_simplifier::level> planet_levels;
+  // index range and switch distance of every level at the current resolution
+  std::vector<lod_level> planet_lods;
   
   // camera transform matrix
   glm::fmat4 m_view_transform;
@@ -60,9 +116,53 @@ class ApplicationSolar : public Application {
   point_light_node * light_all;
   std::vector<geometry_node*> geometry_node_Vector;
   model_object star_object;
+  // chunks of star_object, stars are only stored on the gpu
+  starfield star_field;
+  // vertex array of the fullscreen sky triangle
+  model_object skybox_object;
+  // far stars, the front cube map is sampled while the back one is baked
+  cubemap_target star_cubemaps[2];
+  glm::fvec3 star_bake_positions[2];
+  std::size_t m_star_front;
+  // next face of the back cube map to bake, NUM_FACES if no bake is running
+  unsigned m_star_bake_face;
+  bool m_star_cubemap_valid;
+  bool m_star_cubemap_mode;
+  // ring instances, center and radius followed by color, rings around the root first
   std::vector<float> orbits;
+  // unit circle shared by all rings
   model_object orbit_object;
-
+  GLuint orbit_instance_BO;
+  // buffer texture view of orbit_instance_BO
+  texture_object orbit_instances;
+  // body of every ring and trail
+  std::vector<geometry_node*> orbit_bodies;
+  // number of rings which never move
+  std::size_t m_orbit_static;
+  trail_buffer planet_trails;
+  // point lights of the scene graph, each one is a light volume in the deferred path
+  std::vector<point_light_node*> light_nodes;
+  // surface attributes of the planets for deferred lighting
+  gbuffer_target planet_gbuffer;
+  bool m_deferred;
+  // loads assets and rasterizes occluders
+  thread_pool m_workers;
+  occlusion_culler m_occlusion;
+  // draws of the visible planets, recorded on the workers
+  mutable command_recorder m_planet_commands;
+  // inscribed low poly sphere rasterized for large bodies
+  std::vector<glm::fvec3> occluder_mesh;
+  // planets drawn by the cpu paths this frame
+  std::vector<geometry_node*> m_visible_planets;
+  bool m_occlusion_culling;
+  // textures of all planets, one layer per geometry node
+  texture_object planet_textures;
+  // uploads planet texture layers over the first frames
+  texture_streamer m_texture_streamer;
+  // gpu driven culling and drawing of planets
+  // transforms are compared with the last uploaded ones while rendering
+  mutable indirect_batch planet_batch;
+  bool m_gpu_driven;
 
 };
 
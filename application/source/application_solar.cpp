@@ -13,11 +13,19 @@ using namespace gl;
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <set>
+#include <stdexcept>
 
 // ------------------Personal includes------------------------------------------------------------------------
 #include "scene_graph.hpp"
@@ -37,18 +45,77 @@ using namespace gl;
 
 // ------------------Personal includes------------------------------------------------------------------------
 
+// stars farther than this from the bake position are drawn from the cube map
+static const float STAR_BAKE_RADIUS = 20.f;
+// camera distance from the bake position which triggers a new bake
+static const float STAR_REBAKE_DISTANCE = 2.f;
+// floats per ring instance, center and radius followed by color
+static const std::size_t ORBIT_FLOATS = 8;
+// line segments of an orbit ring
+static const GLsizei ORBIT_SEGMENTS = 128;
+// samples per trail, one sample is taken per frame
+static const GLsizei TRAIL_LENGTH = 256;
+// bodies with a smaller world radius are only tested, never rasterized as occluders
+static const float OCCLUDER_MIN_RADIUS = 1.f;
+// occluders rasterized per frame, largest on screen first
+static const std::size_t MAX_OCCLUDERS = 8;
+// screen space error of a coarser planet level in pixels, up to which it replaces the finer one
+static const float PLANET_LOD_PIXELS = 1.f;
+
 ApplicationSolar::ApplicationSolar(std::string const& resource_path)
  :Application{resource_path}
  ,planet_object{}
+ ,m_quantized_vertices{true}
+ ,planet_position_min{0.f}
+ ,planet_position_extent{1.f}
+ ,planet_texcoord_min{0.f}
+ ,planet_texcoord_extent{1.f}
+ ,planet_levels{}
+ ,planet_lods{}
  ,star_object{}
+ ,star_field{}
+ ,skybox_object{}
+ ,star_cubemaps{}
+ ,star_bake_positions{}
+ ,m_star_front{0}
+ ,m_star_bake_face{cubemap::NUM_FACES}
+ ,m_star_cubemap_valid{false}
+ ,m_star_cubemap_mode{true}
+ ,orbits{}
+ ,orbit_object{}
+ ,orbit_instance_BO{0}
+ ,orbit_instances{}
+ ,orbit_bodies{}
+ ,m_orbit_static{0}
+ ,planet_trails{}
+ ,light_nodes{}
+ ,planet_gbuffer{}
+ ,m_deferred{false}
+ ,m_workers{}
+ ,m_occlusion{m_workers}
+ ,m_planet_commands{m_workers}
+ ,occluder_mesh{occlusion_culler::inscribed_sphere(8, 12)}
+ ,m_visible_planets{}
+ ,m_occlusion_culling{true}
  ,m_view_transform{glm::translate(glm::fmat4{}, glm::fvec3{0.0f, 0.0f, 4.0f})}
  ,m_view_projection{utils::calculate_projection_matrix(initial_aspect_ratio)}
+ ,planet_textures{}
+ ,m_texture_streamer{}
+ ,planet_batch{}
+ ,m_gpu_driven{false}
 {
+  PROFILE_SCOPE("ApplicationSolar::initialize");
   initializeSceneGraph();
-  initializeGeometry();
-  initializeStars();
-  initializeTextures();
-  initializeShaderPrograms();
+  // Files are read and decoded on all cores, gl objects are created here as the data arrives
+  asset_graph assets{m_workers};
+  initializeGeometry(assets);
+  initializeStars(assets);
+  initializeTextures(assets);
+  initializeShaderPrograms(assets);
+  assets.wait();
+  initializeSkybox();
+  initializeOrbits();
+  initializeDeferred();
 }
 
 ApplicationSolar::~ApplicationSolar() {
@@ -59,43 +126,256 @@ ApplicationSolar::~ApplicationSolar() {
   glDeleteBuffers(1, &star_object.vertex_BO);
   glDeleteBuffers(1, &star_object.element_BO);
   glDeleteVertexArrays(1, &star_object.vertex_AO);
+
+  glDeleteTextures(1, &planet_textures.handle);
+
+  gpu_culling::destroy(planet_batch);
+
+  glDeleteVertexArrays(1, &skybox_object.vertex_AO);
+  cubemap::destroy(star_cubemaps[0]);
+  cubemap::destroy(star_cubemaps[1]);
+
+  glDeleteBuffers(1, &orbit_object.vertex_BO);
+  glDeleteVertexArrays(1, &orbit_object.vertex_AO);
+  glDeleteBuffers(1, &orbit_instance_BO);
+  glDeleteTextures(1, &orbit_instances.handle);
+  trails::destroy(planet_trails);
+  deferred::destroy(planet_gbuffer);
+}
+
+void ApplicationSolar::update() {
+  // Upload a budget of texture rows per frame instead of stalling at startup
+  {
+    PROFILE_SCOPE("streaming");
+    gpu_profiler::scope timer{m_gpu_profiler, "streaming"};
+    m_texture_streamer.update();
+  }
+  // Advance all planets once per frame, the render paths only draw them
+  {
+    PROFILE_SCOPE("animate");
+    for (auto planet_geo : geometry_node_Vector) {
+      this->animateObject(planet_geo);
+    }
+  }
+  {
+    PROFILE_SCOPE("occlusion culling");
+    this->cullOccludedPlanets();
+  }
+  if (m_star_cubemap_mode) {
+    PROFILE_SCOPE("star_bake");
+    gpu_profiler::scope timer{m_gpu_profiler, "star_bake"};
+    this->updateStarCubemap();
+  }
+  {
+    PROFILE_SCOPE("orbit upload");
+    this->updateOrbits();
+  }
 }
 
 void ApplicationSolar::render() const {
-  this->renderPlanetObjects();
-  this->renderStarObjects();
+  // Every object class is timed as its own pass
+  {
+    PROFILE_SCOPE("planets");
+    gpu_profiler::scope timer{m_gpu_profiler, "planets"};
+    this->renderPlanetObjects();
+  }
+  {
+    PROFILE_SCOPE("orbits");
+    gpu_profiler::scope timer{m_gpu_profiler, "orbits"};
+    this->renderOrbitObjects();
+  }
+  {
+    PROFILE_SCOPE("stars");
+    gpu_profiler::scope timer{m_gpu_profiler, "stars"};
+    this->renderStarObjects();
+  }
 }
 
 //Personal Code --------------------
 
 void ApplicationSolar::renderStarObjects() const{
-  
-  glUseProgram(m_shaders.at("star").handle);
+  glm::fmat4 view_projection = m_view_projection * glm::inverse(m_view_transform);
+  glm::fvec3 cam_position{m_view_transform * glm::fvec4(0.f, 0.f, 0.f, 1.f)};
 
-  glBindVertexArray(star_object.vertex_AO);
+  // Far stars come from the baked cube map, only the near ones are drawn as points
+  if (m_star_cubemap_mode && m_star_cubemap_valid) {
+    this->renderSkybox();
+    this->renderStarChunks(view_projection, cam_position, star_range::near, star_bake_positions[m_star_front]);
+  }
+  else {
+    this->renderStarChunks(view_projection, cam_position, star_range::all, cam_position);
+  }
+}
+
+void ApplicationSolar::renderStarChunks(glm::fmat4 const& view_projection, glm::fvec3 const& eye, star_range range, glm::fvec3 const& bake_position) const{
   
-  glDrawArrays(star_object.draw_mode, GLint(0), star_object.num_elements);
+  m_gl_state.use_program(m_shaders.at("star").handle);
+
+  m_gl_state.bind_vertex_array(star_object.vertex_AO);
+
+  // Draw only chunks inside the frustum, far chunks only with their brightest stars
+  std::vector<glm::fvec4> planes = gpu_culling::frustum_planes(view_projection);
+  float max_magnitude = star_field.min_magnitude + star_field.magnitude_step * float(star_field.chunks.empty() ? 0 : star_field.chunks[0].counts.size());
+  shader_program const& program = m_shaders.at("star");
+  for (auto const& chunk : star_field.chunks) {
+    glm::fvec3 center = chunk.min + chunk.extent * 0.5f;
+    float radius = std::max(glm::length(chunk.extent) * 0.5f, 1e-3f);
+    // Chunks entirely outside the bake radius belong to the cube map
+    if (range != star_range::all) {
+      bool far = glm::length(center - bake_position) - radius > STAR_BAKE_RADIUS;
+      if (far != (range == star_range::far)) {
+        continue;
+      }
+    }
+    if (!star_catalog::in_frustum(planes, chunk)) {
+      continue;
+    }
+    // Brightness falls with the squared distance, 5 magnitudes per factor 10
+    float distance = glm::length(center - eye);
+    float limit = max_magnitude - 5.f * std::log10(std::max(distance / radius, 1.f));
+    GLsizei count = star_catalog::visible_count(star_field, chunk, limit);
+    if (count == 0) {
+      continue;
+    }
+    m_gl_state.uniform(program.u_locs.at("chunk_min"), chunk.min);
+    m_gl_state.uniform(program.u_locs.at("chunk_extent"), chunk.extent);
+    glDrawArrays(star_object.draw_mode, chunk.first, count);
+  }
+}
 
+void ApplicationSolar::renderSkybox() const{
+  gpu_profiler::scope timer{m_gpu_profiler, "skybox"};
+  m_gl_state.use_program(m_shaders.at("skybox").handle);
+  // Directions only depend on the camera rotation
+  glm::fmat4 rotation{glm::fmat3{glm::inverse(m_view_transform)}};
+  m_gl_state.uniform(m_shaders.at("skybox").u_locs.at("InverseViewProjection"), glm::inverse(m_view_projection * rotation));
+
+  m_gl_state.bind_texture(1, GL_TEXTURE_CUBE_MAP, star_cubemaps[m_star_front].texture.handle);
+
+  // The triangle lies on the far plane, so it only covers pixels nothing was drawn to
+  glDepthFunc(GL_LEQUAL);
+  glDepthMask(GL_FALSE);
+  m_gl_state.bind_vertex_array(skybox_object.vertex_AO);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glDepthMask(GL_TRUE);
+  glDepthFunc(GL_LESS);
 }
 
-void ApplicationSolar::renderPlanetObjects() const{
-  geometry_node * planet_geo = new geometry_node();
-  // Iterating through the geometry_node_Vector and rendering each planets(or moons) position
-  for (int i = 0; i < (int)geometry_node_Vector.size(); i++){
-    planet_geo = geometry_node_Vector[i];
-    // Rendering planet/moon object
-    this->renderObject(planet_geo, i);
+// Starts a new bake once the camera left the bake position and bakes one face per frame
+void ApplicationSolar::updateStarCubemap(){
+  glm::fvec3 cam_position{m_view_transform * glm::fvec4(0.f, 0.f, 0.f, 1.f)};
+  bool moved = glm::length(cam_position - star_bake_positions[m_star_front]) > STAR_REBAKE_DISTANCE;
+  if (m_star_bake_face == cubemap::NUM_FACES && (!m_star_cubemap_valid || moved)) {
+    star_bake_positions[1 - m_star_front] = cam_position;
+    m_star_bake_face = 0;
+  }
+  if (m_star_bake_face < cubemap::NUM_FACES) {
+    // Without any baked cube map all faces are needed right away
+    this->bakeStarFaces(m_star_cubemap_valid ? 1 : cubemap::NUM_FACES);
   }
 }
 
-void ApplicationSolar::renderObject(geometry_node * planet_geo, int object_number) const{
+void ApplicationSolar::bakeStarFaces(unsigned num_faces){
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+
+  // Bake into the back cube map while the front one is still sampled
+  std::size_t back = 1 - m_star_front;
+  glm::fvec3 position = star_bake_positions[back];
+  glm::fmat4 projection = cubemap::face_projection(0.1f, 100.f);
+  shader_program const& program = m_shaders.at("star");
+  m_gl_state.use_program(program.handle);
+  m_gl_state.uniform(program.u_locs.at("ProjectionMatrix"), projection);
+
+  static const GLfloat black[] = {0.f, 0.f, 0.f, 1.f};
+  for (unsigned i = 0; i < num_faces && m_star_bake_face < cubemap::NUM_FACES; ++i, ++m_star_bake_face) {
+    cubemap::bind_face(star_cubemaps[back], m_star_bake_face);
+    glClearBufferfv(GL_COLOR, 0, black);
+    glm::fmat4 view = cubemap::face_view(m_star_bake_face, position);
+    m_gl_state.use_program(program.handle);
+    m_gl_state.uniform(program.u_locs.at("ModelViewMatrix"), view);
+    this->renderStarChunks(projection * view, position, star_range::far, position);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
 
-  // Each holder already contains the planets relative postion in the solar system, set via translate() ininitializeSceneGraph()
-  // This postion can be combined with the already written code to create the planets rotation and revolvement around the sun
-  // bind shader to upload uniforms
+  if (m_star_bake_face == cubemap::NUM_FACES) {
+    m_star_front = back;
+    m_star_cubemap_valid = true;
+  }
+  // Restore the camera matrices of the star shader
+  uploadView();
+  uploadProjection();
+}
+
+// Rings of all bodies with one instanced call, followed by all trails with another one
+void ApplicationSolar::renderOrbitObjects() const{
+  if (orbit_bodies.empty()) {
+    return;
+  }
+  {
+    gpu_profiler::scope timer{m_gpu_profiler, "rings"};
+    m_gl_state.use_program(m_shaders.at("orbit").handle);
+    m_gl_state.bind_texture(2, GL_TEXTURE_BUFFER, orbit_instances.handle);
+    m_gl_state.bind_vertex_array(orbit_object.vertex_AO);
+    glDrawArraysInstanced(orbit_object.draw_mode, 0, orbit_object.num_elements, GLsizei(orbit_bodies.size()));
+  }
+
+  gpu_profiler::scope timer{m_gpu_profiler, "trails"};
+  shader_program const& program = m_shaders.at("trail");
+  m_gl_state.use_program(program.handle);
+  trails::draw(planet_trails, program, 3);
+  // Trails bind their own buffers and textures
+  m_gl_state.invalidate();
+}
+
+// Moves the rings of moons with their planet and appends the newest position to every trail
+void ApplicationSolar::updateOrbits(){
+  if (orbit_bodies.empty()) {
+    return;
+  }
+  // Rings around the sun never move, only the tail with the moon rings is rewritten
+  std::size_t floats = ORBIT_FLOATS;
+  for (std::size_t i = m_orbit_static; i < orbit_bodies.size(); ++i) {
+    glm::fvec4 center = orbit_bodies[i]->parent->parent->getWorldTransform()[3];
+    std::copy(&center[0], &center[0] + 3, orbits.begin() + std::ptrdiff_t(i * floats));
+  }
+  if (m_orbit_static < orbit_bodies.size()) {
+    glBindBuffer(GL_TEXTURE_BUFFER, orbit_instance_BO);
+    glBufferSubData(GL_TEXTURE_BUFFER, GLintptr(sizeof(float) * m_orbit_static * floats),
+                    GLsizeiptr(sizeof(float) * (orbit_bodies.size() - m_orbit_static) * floats), &orbits[m_orbit_static * floats]);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+
+  // Only the newest sample of each trail is uploaded
+  std::vector<glm::fvec4> positions;
+  positions.reserve(orbit_bodies.size());
+  for (auto body : orbit_bodies) {
+    positions.push_back(body->getWorldTransform()[3]);
+  }
+  trails::push(planet_trails, positions);
+}
+
+void ApplicationSolar::renderPlanetObjects() const{
+  // Cull and draw all planets on the gpu with one dispatch and one draw call
+  if (m_gpu_driven) {
+    this->renderPlanetObjectsIndirect();
+    return;
+  }
+  // Light only the visible surface pixels instead of every rasterized fragment
+  if (m_deferred) {
+    this->renderPlanetObjectsDeferred();
+    return;
+  }
+  // All planet textures are layers of one array texture, bind it once for all planets
+  m_gl_state.bind_texture(0, planet_textures.target, planet_textures.handle);
 
-  glUseProgram(m_shaders.at("planet").handle);
+  // Rendering the planets not hidden behind others, each planets(or moons) position is recorded in parallel
+  this->renderPlanetList(m_shaders.at("planet"));
+}
 
+// Rotates the planets holder around its parent and the planet around its own axis
+void ApplicationSolar::animateObject(geometry_node * planet_geo) const{
   glm::fmat4 model_matrix(1.0f);
 
   // SEE-1 in initializeSceneGraph():
@@ -122,61 +402,211 @@ void ApplicationSolar::renderObject(geometry_node * planet_geo, int object_numbe
   // Let the object around its own axis(applied last in matrix calculation)
   model_matrix = glm::rotate(glm::mat4{}, 0.0009f, glm::fvec3{0.0f, 1.0f, 0.0f});
   planet_geo->setLocalTransform(model_matrix*planet_geo->getLocalTransform());
+}
 
+// Sets the state shared by all planets, workers record the per planet uniforms and draws
+void ApplicationSolar::renderPlanetList(shader_program const& program) const{
+  // bind shader and the VAO once for all planets
+  m_gl_state.use_program(program.handle);
+  m_gl_state.bind_vertex_array(planet_object.vertex_AO);
 
-  glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ModelMatrix"),
-                    1, GL_FALSE, glm::value_ptr(planet_geo->getWorldTransform()));
-
-  // extra matrix for normal transformation to keep them orthogonal to surface
-  glm::fmat4 normal_matrix = glm::inverseTranspose(glm::inverse(m_view_transform) * planet_geo->getWorldTransform());
-  glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("NormalMatrix"),
-                    1, GL_FALSE, glm::value_ptr(normal_matrix));
-
-  // bind the VAO to draw
-  glBindVertexArray(planet_object.vertex_AO);
-
-
-  // Render Color of planet
-  // glUniform3f
-  GLint location = glGetUniformLocation(m_shaders.at("planet").handle, "geo_color");
-  glUniform3f(location, planet_geo->geo_color[0], planet_geo->geo_color[1], planet_geo->geo_color[2]);
-  
+  // Programs without lighting, like the g-buffer one, do not have these locations
+  auto location = [&program](char const* name) {
+    auto found = program.u_locs.find(name);
+    return found == program.u_locs.end() ? GLint(-1) : found->second;
+  };
 
   // Render lightning:
   
   // Light intensity:
-  location = glGetUniformLocation(m_shaders.at("planet").handle, "light_intensity");
-  glUniform1f(location, light_all->lightIntensity);
+  m_gl_state.uniform(location("light_intensity"), light_all->lightIntensity);
 
   // Light Color:
-  location = glGetUniformLocation(m_shaders.at("planet").handle, "light_color");
-  glUniform3f(location, light_all->lightColor[0], light_all->lightColor[1], light_all->lightColor[2]);
+  m_gl_state.uniform(location("light_color"), light_all->lightColor);
 
   // Light position:
   glm::fvec4 light_position = light_all->getWorldTransform() * glm::fvec4{0.f, 0.f, 0.f, 1.f};
-  location = glGetUniformLocation(m_shaders.at("planet").handle, "light_position");
-  glUniform3f(location, light_position[0], light_position[1], light_position[2]);
+  m_gl_state.uniform(location("light_position"), glm::fvec3{light_position});
 
   // Camera position:
   glm::fvec4 cam_position = m_view_transform * glm::fvec4(0.f, 0.f, 0.f, 1.f);
-  location = glGetUniformLocation(m_shaders.at("planet").handle, "cam_position");
-  glUniform3f(location, cam_position[0], cam_position[1], cam_position[2]);
+  m_gl_state.uniform(location("cam_position"), glm::fvec3{cam_position});
+
+  m_planet_commands.record(m_visible_planets.size(), [this, &program](command_buffer& commands, std::size_t first, std::size_t last){
+    for (std::size_t i = first; i < last; i++){
+      // Recording planet/moon object
+      this->recordObject(commands, m_visible_planets[i], program);
+    }
+  });
+  m_planet_commands.replay(m_gl_state);
+}
 
-  //std::cout<<cam_position[0]<<cam_position[1]<<cam_position[2]<<"\n";
+// Runs on the workers, so only reads the scene graph and makes no gl calls
+void ApplicationSolar::recordObject(command_buffer& commands, geometry_node * planet_geo, shader_program const& program) const{
 
+  // Each holder already contains the planets relative postion in the solar system, set via translate() ininitializeSceneGraph()
+  // This postion is combined with the rotation and revolvement applied by animateObject() in update()
+  glm::fmat4 world_transform = planet_geo->getWorldTransform();
+  commands.uniform(program.u_locs.at("ModelMatrix"), world_transform);
+
+  // extra matrix for normal transformation to keep them orthogonal to surface
+  glm::fmat4 normal_matrix = glm::inverseTranspose(glm::inverse(m_view_transform) * world_transform);
+  commands.uniform(program.u_locs.at("NormalMatrix"), normal_matrix);
+
+  // Render Color of planet
+  auto color = program.u_locs.find("geo_color");
+  if (color != program.u_locs.end()) {
+    commands.uniform(color->second, planet_geo->geo_color);
+  }
 
   // Render Textures
-  // Bind for Accessing
-  glActiveTexture(GL_TEXTURE0);
-  texture_object texture = planet_geo->geo_texture;
-  glBindTexture(texture.target, texture.handle);
-  // Upload Texture Unit data to shader
-  int sampler_location = glGetUniformLocation(m_shaders.at("planet").handle,"current_texture");
-  //glUseProgram(m_shaders.at("planet").handle);
-  glUniform1i(sampler_location, 0);
+  // Texture array is bound in renderPlanetObjects(), select layer of this planet
+  commands.uniform(program.u_locs.at("texture_layer"), planet_geo->geo_layer);
+
+  // Level of detail by distance relative to the radius, same choice as cull.comp in the gpu driven path
+  glm::fvec3 center{world_transform[3]};
+  float scale = std::max(glm::length(glm::fvec3{world_transform[0]}), std::max(glm::length(glm::fvec3{world_transform[1]}), glm::length(glm::fvec3{world_transform[2]})));
+  glm::fvec3 cam_position{m_view_transform[3]};
+  lod_level const& lod = planet_lods[gpu_culling::select_lod(planet_lods, glm::length(center - cam_position) / std::max(scale, 1e-6f))];
+  std::size_t index_bytes = planet_object.index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
 
   // draw bound vertex array using bound shader
-  glDrawElements(planet_object.draw_mode, planet_object.num_elements, model::INDEX.type, NULL);
+  commands.draw_elements(planet_object.draw_mode, GLsizei(lod.num_elements), planet_object.index_type, lod.first_index * index_bytes);
+}
+
+// Rasterizes the largest bodies on screen into a small depth buffer on the workers and keeps
+// only the planets whose bounding sphere is not completely behind it
+void ApplicationSolar::cullOccludedPlanets(){
+  m_visible_planets.clear();
+  if (!m_occlusion_culling) {
+    m_visible_planets = geometry_node_Vector;
+    return;
+  }
+  glm::fvec3 cam_position{m_view_transform * glm::fvec4(0.f, 0.f, 0.f, 1.f)};
+  // sphere.obj is a unit sphere, the largest axis scale is the bounding radius
+  std::vector<glm::fvec4> bounds;
+  std::vector<std::pair<float, std::size_t>> occluders;
+  for (std::size_t i = 0; i < geometry_node_Vector.size(); ++i) {
+    glm::fmat4 world = geometry_node_Vector[i]->getWorldTransform();
+    float radius = std::max(glm::length(glm::fvec3(world[0])), std::max(glm::length(glm::fvec3(world[1])), glm::length(glm::fvec3(world[2]))));
+    bounds.push_back(glm::fvec4{glm::fvec3(world[3]), radius});
+    if (radius >= OCCLUDER_MIN_RADIUS) {
+      occluders.push_back(std::make_pair(radius / std::max(glm::length(glm::fvec3(world[3]) - cam_position), 1e-3f), i));
+    }
+  }
+  // Ties keep scene graph order, so the same view always gives the same visible set
+  std::stable_sort(occluders.begin(), occluders.end(), [](std::pair<float, std::size_t> const& a, std::pair<float, std::size_t> const& b){
+    return a.first > b.first;
+  });
+
+  m_occlusion.begin(m_view_projection * glm::inverse(m_view_transform));
+  for (std::size_t i = 0; i < std::min(occluders.size(), MAX_OCCLUDERS); ++i) {
+    m_occlusion.add_occluder(geometry_node_Vector[occluders[i].second]->getWorldTransform(), occluder_mesh);
+  }
+  m_occlusion.finish();
+
+  for (std::size_t i = 0; i < geometry_node_Vector.size(); ++i) {
+    if (m_occlusion.visible(glm::fvec3(bounds[i]), bounds[i].w)) {
+      m_visible_planets.push_back(geometry_node_Vector[i]);
+    }
+  }
+}
+
+// Deferred path: planets only write surface color and normal to the g-buffer, lighting
+// is computed afterwards once per covered pixel and light volume
+void ApplicationSolar::renderPlanetObjectsDeferred() const{
+  m_gpu_profiler.begin("gbuffer");
+  glBindFramebuffer(GL_FRAMEBUFFER, planet_gbuffer.framebuffer);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  m_gl_state.bind_texture(0, planet_textures.target, planet_textures.handle);
+  this->renderPlanetList(m_shaders.at("planet_gbuffer"));
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  m_gpu_profiler.end();
+
+  deferred::bind_textures(planet_gbuffer, 4);
+  m_gl_state.invalidate();
+
+  // Ambient pass also copies the depth, so orbits and stars are hidden behind planets
+  m_gpu_profiler.begin("ambient");
+  m_gl_state.use_program(m_shaders.at("deferred_ambient").handle);
+  glDepthFunc(GL_ALWAYS);
+  m_gl_state.bind_vertex_array(skybox_object.vertex_AO);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glDepthFunc(GL_LESS);
+  m_gpu_profiler.end();
+
+  // Light passes are added on top, back faces keep the volume visible with the camera inside
+  // and depth clamping keeps it when it reaches past the far plane
+  m_gpu_profiler.begin("lights");
+  shader_program const& light_program = m_shaders.at("deferred_light");
+  m_gl_state.use_program(light_program.handle);
+  glm::fmat4 inverse_view_projection = glm::inverse(m_view_projection * glm::inverse(m_view_transform));
+  m_gl_state.uniform(light_program.u_locs.at("InverseViewProjection"), inverse_view_projection);
+  glm::fvec3 cam_position{m_view_transform * glm::fvec4(0.f, 0.f, 0.f, 1.f)};
+  m_gl_state.uniform(light_program.u_locs.at("cam_position"), cam_position);
+
+  glDisable(GL_DEPTH_TEST);
+  glDepthMask(GL_FALSE);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  glEnable(GL_CULL_FACE);
+  glCullFace(GL_FRONT);
+  glEnable(GL_DEPTH_CLAMP);
+  m_gl_state.bind_vertex_array(planet_object.vertex_AO);
+  for (point_light_node * light : light_nodes) {
+    glm::fvec3 light_position{light->getWorldTransform() * glm::fvec4{0.f, 0.f, 0.f, 1.f}};
+    // Same falloff as in lighting.glsl, cut off below one 8 bit step
+    float radius = deferred::light_radius(10.f * light->lightIntensity, light->lightColor, 1.f / 256.f);
+    // The tessellated sphere lies inside the unit sphere, grow it a little
+    glm::fmat4 model_matrix = glm::scale(glm::translate(glm::fmat4{}, light_position), glm::fvec3{radius * 1.1f});
+    m_gl_state.uniform(light_program.u_locs.at("ModelMatrix"), model_matrix);
+    m_gl_state.uniform(light_program.u_locs.at("light_intensity"), light->lightIntensity);
+    m_gl_state.uniform(light_program.u_locs.at("light_color"), light->lightColor);
+    m_gl_state.uniform(light_program.u_locs.at("light_position"), light_position);
+    glDrawElements(planet_object.draw_mode, planet_object.num_elements, planet_object.index_type, NULL);
+  }
+  glDisable(GL_DEPTH_CLAMP);
+  glCullFace(GL_BACK);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_BLEND);
+  glDepthMask(GL_TRUE);
+  glEnable(GL_DEPTH_TEST);
+  m_gpu_profiler.end();
+}
+
+// Gpu driven path: transforms go to a storage buffer, a compute pass frustum culls and picks
+// the lod of every planet and one indirect draw call renders all visible ones
+void ApplicationSolar::renderPlanetObjectsIndirect() const{
+  // colors and bounds were uploaded with the batch, only moved planets are uploaded again
+  std::vector<glm::fmat4> transforms;
+  transforms.reserve(geometry_node_Vector.size());
+  for (auto planet_geo : geometry_node_Vector) {
+    transforms.push_back(planet_geo->getWorldTransform());
+  }
+  gpu_culling::update_transforms(planet_batch, transforms);
+
+  glm::fmat4 view_projection = m_view_projection * glm::inverse(m_view_transform);
+  glm::fvec3 cam_position{m_view_transform * glm::fvec4(0.f, 0.f, 0.f, 1.f)};
+
+  m_gpu_profiler.begin("cull");
+  m_gl_state.use_program(m_shaders.at("cull").handle);
+  gpu_culling::cull(planet_batch, GLsizei(transforms.size()), m_shaders.at("cull"), view_projection, cam_position);
+  m_gl_state.invalidate();
+  m_gpu_profiler.end();
+
+  shader_program const& program = m_shaders.at("planet_indirect");
+  m_gl_state.use_program(program.handle);
+  // Lightning, same values as in renderObject()
+  m_gl_state.uniform(program.u_locs.at("light_intensity"), light_all->lightIntensity);
+  m_gl_state.uniform(program.u_locs.at("light_color"), light_all->lightColor);
+  glm::fvec3 light_position{light_all->getWorldTransform() * glm::fvec4{0.f, 0.f, 0.f, 1.f}};
+  m_gl_state.uniform(program.u_locs.at("light_position"), light_position);
+  m_gl_state.uniform(program.u_locs.at("cam_position"), cam_position);
+
+  // planets sample their layer of the bound array texture
+  m_gl_state.bind_texture(0, planet_textures.target, planet_textures.handle);
+  gpu_culling::draw(planet_batch, GLsizei(transforms.size()), planet_object);
+  m_gl_state.invalidate();
 }
 
 //Personal Code --------------------
@@ -186,27 +616,78 @@ void ApplicationSolar::uploadView() {
   // vertices are transformed in camera space, so camera transform must be inverted
   glm::fmat4 view_matrix = glm::inverse(m_view_transform);
   // upload matrix to gpu
-  glUseProgram(m_shaders.at("planet").handle);
-  glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ViewMatrix"),
-                     1, GL_FALSE, glm::value_ptr(view_matrix));
+  m_gl_state.use_program(m_shaders.at("planet").handle);
+  m_gl_state.uniform(m_shaders.at("planet").u_locs.at("ViewMatrix"), view_matrix);
+
+  // upload matrix to gpu driven planet shader
+  if (m_shaders.count("planet_indirect") > 0) {
+    m_gl_state.use_program(m_shaders.at("planet_indirect").handle);
+    m_gl_state.uniform(m_shaders.at("planet_indirect").u_locs.at("ViewMatrix"), view_matrix);
+  }
 
 
   // upload star matrix to gpu
-  glUseProgram(m_shaders.at("star").handle);
-  glUniformMatrix4fv(m_shaders.at("star").u_locs.at("ModelViewMatrix"),
-                     1, GL_FALSE, glm::value_ptr(view_matrix));
+  m_gl_state.use_program(m_shaders.at("star").handle);
+  m_gl_state.uniform(m_shaders.at("star").u_locs.at("ModelViewMatrix"), view_matrix);
+
+  // upload orbit, trail and deferred matrices to gpu
+  for (char const* name : {"orbit", "trail", "planet_gbuffer", "deferred_light"}) {
+    m_gl_state.use_program(m_shaders.at(name).handle);
+    m_gl_state.uniform(m_shaders.at(name).u_locs.at("ViewMatrix"), view_matrix);
+  }
 }
 
 void ApplicationSolar::uploadProjection() {
   // upload matrix to gpu
-  glUseProgram(m_shaders.at("planet").handle);
-  glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ProjectionMatrix"),
-                     1, GL_FALSE, glm::value_ptr(m_view_projection));
+  m_gl_state.use_program(m_shaders.at("planet").handle);
+  m_gl_state.uniform(m_shaders.at("planet").u_locs.at("ProjectionMatrix"), m_view_projection);
+
+  if (m_shaders.count("planet_indirect") > 0) {
+    m_gl_state.use_program(m_shaders.at("planet_indirect").handle);
+    m_gl_state.uniform(m_shaders.at("planet_indirect").u_locs.at("ProjectionMatrix"), m_view_projection);
+  }
 
   // upload star matrix to gpu
-  glUseProgram(m_shaders.at("star").handle);
-  glUniformMatrix4fv(m_shaders.at("star").u_locs.at("ProjectionMatrix"),
-                     1, GL_FALSE, glm::value_ptr(m_view_projection));
+  m_gl_state.use_program(m_shaders.at("star").handle);
+  m_gl_state.uniform(m_shaders.at("star").u_locs.at("ProjectionMatrix"), m_view_projection);
+
+  // upload orbit, trail and deferred matrices to gpu
+  for (char const* name : {"orbit", "trail", "planet_gbuffer", "deferred_light"}) {
+    m_gl_state.use_program(m_shaders.at(name).handle);
+    m_gl_state.uniform(m_shaders.at(name).u_locs.at("ProjectionMatrix"), m_view_projection);
+  }
+}
+
+// Colors, texture layers and bounds of the planets for the gpu driven path, they never change while rendering
+void ApplicationSolar::uploadPlanetObjects() {
+  if (planet_batch.object_BO == 0) {
+    return;
+  }
+  std::vector<culling_object_data> objects;
+  for (auto planet_geo : geometry_node_Vector) {
+    // sphere.obj is a unit sphere around the origin
+    objects.push_back(culling_object_data{glm::fvec4{planet_geo->geo_color, float(planet_geo->geo_layer)},
+                                          glm::fvec4{0.f, 0.f, 0.f, 1.f}});
+  }
+  gpu_culling::update(planet_batch, objects);
+}
+
+// A planet keeps its level until the next coarser one deviates by less than PLANET_LOD_PIXELS on screen
+void ApplicationSolar::updatePlanetLods(unsigned height) {
+  // sphere.obj is a unit sphere, so its level errors are relative to the radius, which covers
+  // pixels_per_radius / (camera distance / radius) pixels
+  float pixels_per_radius = m_view_projection[1][1] * float(height) * 0.5f;
+  planet_lods.clear();
+  for (std::size_t i = 0; i < planet_levels.size(); ++i) {
+    float max_distance = std::numeric_limits<float>::max();
+    if (i + 1 < planet_levels.size()) {
+      max_distance = planet_levels[i + 1].error * pixels_per_radius / PLANET_LOD_PIXELS;
+    }
+    planet_lods.push_back(lod_level{GLuint(planet_levels[i].first_index), GLuint(planet_levels[i].num_indices), max_distance, 0.f});
+  }
+  if (planet_batch.lod_BO != 0) {
+    gpu_culling::update_lods(planet_batch, planet_lods);
+  }
 }
 
 // update uniform locations
@@ -219,37 +700,191 @@ void ApplicationSolar::uploadUniforms() {
   uploadView();
   uploadProjection();
 
+  // star cube map is always bound to unit 1
+  m_gl_state.use_program(m_shaders.at("skybox").handle);
+  m_gl_state.uniform(m_shaders.at("skybox").u_locs.at("sky_texture"), 1);
+
+  // orbit instances are always bound to unit 2
+  m_gl_state.use_program(m_shaders.at("orbit").handle);
+  m_gl_state.uniform(m_shaders.at("orbit").u_locs.at("orbit_instances"), 2);
+
+  // g-buffer textures are bound to units 4 to 6 for the deferred passes
+  for (char const* name : {"deferred_ambient", "deferred_light"}) {
+    m_gl_state.use_program(m_shaders.at(name).handle);
+    m_gl_state.uniform(m_shaders.at(name).u_locs.at("gbuffer_albedo"), 4);
+    m_gl_state.uniform(m_shaders.at(name).u_locs.at("gbuffer_depth"), 6);
+  }
+  m_gl_state.uniform(m_shaders.at("deferred_light").u_locs.at("gbuffer_normal"), 5);
+
+  // planet textures are always bound to unit 0
+  m_gl_state.use_program(m_shaders.at("planet").handle);
+  m_gl_state.uniform(m_shaders.at("planet").u_locs.at("current_texture"), 0);
+  m_gl_state.use_program(m_shaders.at("planet_gbuffer").handle);
+  m_gl_state.uniform(m_shaders.at("planet_gbuffer").u_locs.at("current_texture"), 0);
+  if (m_shaders.count("planet_indirect") > 0) {
+    m_gl_state.use_program(m_shaders.at("planet_indirect").handle);
+    m_gl_state.uniform(m_shaders.at("planet_indirect").u_locs.at("current_texture"), 0);
+  }
+
+  // planet mesh is loaded before the first upload, its bounds never change
+  if (m_quantized_vertices) {
+    for (char const* name : {"planet", "planet_gbuffer", "deferred_light", "planet_indirect"}) {
+      if (m_shaders.count(name) > 0) {
+        std::map<std::string, GLint> const& u_locs = m_shaders.at(name).u_locs;
+        m_gl_state.use_program(m_shaders.at(name).handle);
+        m_gl_state.uniform(u_locs.at("position_min"), planet_position_min);
+        m_gl_state.uniform(u_locs.at("position_extent"), planet_position_extent);
+        if (std::string{name} != "deferred_light") {
+          m_gl_state.uniform(u_locs.at("texcoord_min"), planet_texcoord_min);
+          m_gl_state.uniform(u_locs.at("texcoord_extent"), planet_texcoord_extent);
+        }
+      }
+    }
+  }
 }
 
 ///////////////////////////// intialisation functions /////////////////////////
 // load shader sources
-void ApplicationSolar::initializeShaderPrograms() {
+void ApplicationSolar::initializeShaderPrograms(asset_graph& assets) {
+  // Shaders reading the planet vertex array decode its format
+  std::vector<std::string> vertex_defines{};
+  if (m_quantized_vertices) {
+    vertex_defines.push_back("QUANTIZED_VERTICES");
+  }
   // store shader program objects in container
   m_shaders.emplace("planet", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/simple.vert"},
-                                           {GL_FRAGMENT_SHADER, m_resource_path + "shaders/simple.frag"}}});
+                                           {GL_FRAGMENT_SHADER, m_resource_path + "shaders/simple.frag"}}, vertex_defines});
   // request uniform locations for shader program
   m_shaders.at("planet").u_locs["NormalMatrix"] = -1;
   m_shaders.at("planet").u_locs["ModelMatrix"] = -1;
   m_shaders.at("planet").u_locs["ViewMatrix"] = -1;
   m_shaders.at("planet").u_locs["ProjectionMatrix"] = -1;
+  m_shaders.at("planet").u_locs["current_texture"] = -1;
+  m_shaders.at("planet").u_locs["texture_layer"] = -1;
+
+  // Same planet shaders writing surface attributes for deferred lighting
+  std::vector<std::string> gbuffer_defines{vertex_defines};
+  gbuffer_defines.push_back("GBUFFER");
+  m_shaders.emplace("planet_gbuffer", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/simple.vert"},
+                                                     {GL_FRAGMENT_SHADER, m_resource_path + "shaders/simple.frag"}}, gbuffer_defines});
+  m_shaders.at("planet_gbuffer").u_locs = m_shaders.at("planet").u_locs;
+  // lighting of the forward planet shader, the g-buffer one has none
+  for (char const* name : {"light_intensity", "light_color", "light_position", "cam_position"}) {
+    m_shaders.at("planet").u_locs[name] = -1;
+  }
+
+  m_shaders.emplace("deferred_ambient", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/fullscreen.vert"},
+                                                       {GL_FRAGMENT_SHADER, m_resource_path + "shaders/deferred.frag"}}, {"AMBIENT"}});
+  m_shaders.emplace("deferred_light", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/light_volume.vert"},
+                                                     {GL_FRAGMENT_SHADER, m_resource_path + "shaders/deferred.frag"}}, vertex_defines});
+  for (char const* name : {"deferred_ambient", "deferred_light"}) {
+    m_shaders.at(name).u_locs["gbuffer_albedo"] = -1;
+    m_shaders.at(name).u_locs["gbuffer_depth"] = -1;
+  }
+  // ambient pass needs no normals
+  m_shaders.at("deferred_light").u_locs["gbuffer_normal"] = -1;
+  m_shaders.at("deferred_light").u_locs["ModelMatrix"] = -1;
+  m_shaders.at("deferred_light").u_locs["ViewMatrix"] = -1;
+  m_shaders.at("deferred_light").u_locs["ProjectionMatrix"] = -1;
+  m_shaders.at("deferred_light").u_locs["InverseViewProjection"] = -1;
+  for (char const* name : {"light_intensity", "light_color", "light_position", "cam_position"}) {
+    m_shaders.at("deferred_light").u_locs[name] = -1;
+  }
 
 
   // Star shader
   // store shader program objects in container
-  m_shaders.emplace("star", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/vao.vert"},
+  m_shaders.emplace("star", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/stars.vert"},
                                            {GL_FRAGMENT_SHADER, m_resource_path + "shaders/vao.frag"}}});
 
   // request uniform locations for shader program
   // Content of vao.vert
   m_shaders.at("star").u_locs["ModelViewMatrix"] = -1;
   m_shaders.at("star").u_locs["ProjectionMatrix"] = -1;
+  // bounds of the drawn chunk
+  m_shaders.at("star").u_locs["chunk_min"] = -1;
+  m_shaders.at("star").u_locs["chunk_extent"] = -1;
+
+  // Background with the baked far stars
+  m_shaders.emplace("skybox", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/skybox.vert"},
+                                             {GL_FRAGMENT_SHADER, m_resource_path + "shaders/skybox.frag"}}});
+  m_shaders.at("skybox").u_locs["InverseViewProjection"] = -1;
+  m_shaders.at("skybox").u_locs["sky_texture"] = -1;
+
+  // Orbit rings and trails
+  m_shaders.emplace("orbit", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/orbit.vert"},
+                                            {GL_FRAGMENT_SHADER, m_resource_path + "shaders/vao.frag"}}});
+  m_shaders.at("orbit").u_locs["ViewMatrix"] = -1;
+  m_shaders.at("orbit").u_locs["ProjectionMatrix"] = -1;
+  m_shaders.at("orbit").u_locs["orbit_instances"] = -1;
+
+  m_shaders.emplace("trail", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/trail.vert"},
+                                            {GL_FRAGMENT_SHADER, m_resource_path + "shaders/vao.frag"}}});
+  m_shaders.at("trail").u_locs["ViewMatrix"] = -1;
+  m_shaders.at("trail").u_locs["ProjectionMatrix"] = -1;
+  for (char const* name : {"trail_samples", "trail_head", "trail_length", "num_trails"}) {
+    m_shaders.at("trail").u_locs[name] = -1;
+  }
+
+  // Gpu driven planet shaders, only when the context supports them
+  if (gpu_culling::supported()) {
+    m_shaders.emplace("cull", shader_program{{{GL_COMPUTE_SHADER, m_resource_path + "shaders/cull.comp"}}});
+    for (char const* name : {"frustum_planes", "camera_position", "num_objects", "num_lods"}) {
+      m_shaders.at("cull").u_locs[name] = -1;
+    }
+
+    m_shaders.emplace("planet_indirect", shader_program{{{GL_VERTEX_SHADER,m_resource_path + "shaders/indirect.vert"},
+                                                         {GL_FRAGMENT_SHADER, m_resource_path + "shaders/indirect.frag"}}, vertex_defines});
+    m_shaders.at("planet_indirect").u_locs["ViewMatrix"] = -1;
+    m_shaders.at("planet_indirect").u_locs["ProjectionMatrix"] = -1;
+    m_shaders.at("planet_indirect").u_locs["current_texture"] = -1;
+    for (char const* name : {"light_intensity", "light_color", "light_position", "cam_position"}) {
+      m_shaders.at("planet_indirect").u_locs[name] = -1;
+    }
+  }
 
+  // Bounds of quantized planet vertices, light volumes only read positions
+  if (m_quantized_vertices) {
+    for (char const* name : {"planet", "planet_gbuffer", "deferred_light", "planet_indirect"}) {
+      if (m_shaders.count(name) > 0) {
+        m_shaders.at(name).u_locs["position_min"] = -1;
+        m_shaders.at(name).u_locs["position_extent"] = -1;
+        if (std::string{name} != "deferred_light") {
+          m_shaders.at(name).u_locs["texcoord_min"] = -1;
+          m_shaders.at(name).u_locs["texcoord_extent"] = -1;
+        }
+      }
+    }
+  }
+
+  // Read all shader sources in parallel, they are compiled on the first reload
+  // programs share stages, every file is read once
+  std::set<std::string> paths;
+  for (auto const& pair : m_shaders) {
+    for (auto const& stage : pair.second.shader_paths) {
+      paths.insert(stage.second);
+    }
+  }
+  for (auto const& path : paths) {
+    assets.add(path, [path](){
+      shader_loader::preload(path);
+      return asset_graph::upload_fn{};
+    });
+  }
 }
 
 // load models
-void ApplicationSolar::initializeGeometry() {
-  model planet_model = model_loader::obj(m_resource_path + "models/sphere.obj", model::NORMAL | model::TEXCOORD);
-  
+void ApplicationSolar::initializeGeometry(asset_graph& assets) {
+  // Map the cooked obj on a worker, buffers are created once it arrived
+  std::string path = m_resource_path + "models/sphere.obj";
+  assets.add("sphere.obj", [this, path](){
+    std::shared_ptr<mesh_cache::mesh> planet_model{model_loader::cached_obj(path, m_workers, model::NORMAL | model::TEXCOORD, m_quantized_vertices)};
+    return asset_graph::upload_fn{[this, planet_model](){ this->uploadGeometry(*planet_model); }};
+  });
+}
+
+// upload planet model
+void ApplicationSolar::uploadGeometry(mesh_cache::mesh const& planet_model) {
   // generate vertex array object
   glGenVertexArrays(1, &planet_object.vertex_AO);
   // bind the array for attaching buffers
@@ -259,65 +894,71 @@ void ApplicationSolar::initializeGeometry() {
   glGenBuffers(1, &planet_object.vertex_BO);
   // bind this as an vertex array buffer containing all attributes
   glBindBuffer(GL_ARRAY_BUFFER, planet_object.vertex_BO);
-  // configure currently bound array buffer
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * planet_model.data.size(), planet_model.data.data(), GL_STATIC_DRAW);
-
-  // activate first attribute on gpu
-  glEnableVertexAttribArray(0);
-  // first attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::POSITION]);
-  // activate second attribute on gpu
-  glEnableVertexAttribArray(1);
-  // second attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(1, model::NORMAL.components, model::NORMAL.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::NORMAL]);
-
-  // in_Texture_Coor
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2, model::TEXCOORD.components, model::TEXCOORD.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::TEXCOORD]);
+  // configure currently bound array buffer, straight from the mapped file
+  glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(planet_model.vertex_data_size()), planet_model.vertex_data(), GL_STATIC_DRAW);
+
+  // attribute locations of the planet shaders, the encodings come from the cooked layout
+  std::map<model::attrib_flag_t, GLuint> locations{{model::POSITION, 0}, {model::NORMAL, 1}, {model::TEXCOORD, 2}};
+  for (auto const& attribute : planet_model.layout()) {
+    GLuint location = locations.at(attribute.flag);
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, attribute.components, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE, planet_model.vertex_bytes(), attribute.offset);
+  }
+  // quantized attributes are scaled back by the vertex shader
+  planet_position_min = planet_model.position_min();
+  planet_position_extent = planet_model.position_max() - planet_model.position_min();
+  planet_texcoord_min = planet_model.texcoord_min();
+  planet_texcoord_extent = planet_model.texcoord_max() - planet_model.texcoord_min();
 
    // generate generic buffer
   glGenBuffers(1, &planet_object.element_BO);
   // bind this as an vertex array buffer containing all attributes
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, planet_object.element_BO);
   // configure currently bound array buffer
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * planet_model.indices.size(), planet_model.indices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(planet_model.index_data_size()), planet_model.index_data(), GL_STATIC_DRAW);
 
   // store type of primitive to draw
   planet_object.draw_mode = GL_TRIANGLES;
-  // transfer number of indices to model object 
-  planet_object.num_elements = GLsizei(planet_model.indices.size());
+  // transfer number of indices to model object, the full mesh is the first level of detail
+  planet_object.num_elements = GLsizei(planet_model.lods().front().num_indices);
+  planet_object.index_type = planet_model.index_type();
+
+  // coarser levels follow in the index buffer, their switch distances are updated on every resize
+  planet_levels = planet_model.lods();
+  GLint viewport[4] = {0, 0, 0, 0};
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  updatePlanetLods(unsigned(viewport[3]));
+
+  // buffers for gpu driven rendering, one object slot per planet/moon
+  if (gpu_culling::supported()) {
+    planet_batch = gpu_culling::create(planet_object, planet_lods, GLsizei(geometry_node_Vector.size()));
+    uploadPlanetObjects();
+  }
 }
 
 
 // ------------------Personal scenegraph------------------------------------------------------------------------
-void ApplicationSolar::initializeStars(){
-
-  // Generate Star Array as Vector: One Star: x,y,z,r,g,b 
-
-  std::vector<float> milky_way;
-  int star_count = 10000;
-  for(int i = 0; i < star_count; i++){
-    float x = (float)(std::rand() % 100) + (-50.f);
-    milky_way.push_back(x);
-    float y = (float)(std::rand() % 100) + (-50.f);
-    milky_way.push_back(y);
-    float z = (float)(std::rand() % 100) + (-50.f);
-    milky_way.push_back(z);
-
-    float r = (float)(std::rand() % 255) / 255.f;
-    milky_way.push_back(r);
-    float g = (float)(std::rand() % 255) / 255.f;
-    milky_way.push_back(g);
-    float b = (float)(std::rand() % 255) / 255.f;
-    milky_way.push_back(b);
-
-    if(i == 51 ){
-      /* std::cout<<"STAR POS: "<<x<<", "<<y<<", "<<z<<" \n";
-      std::cout<<"STAR COL: "<<r<<", "<<g<<", "<<b<<" \n";
-      std::cout<<"TESTING COL: "<<std::rand() % 255 / 255<<" \n"; */
+void ApplicationSolar::initializeStars(asset_graph& assets){
+  // Load a real catalog if one is present, otherwise generate a random starfield
+  std::string catalog_path = m_resource_path + "stars/catalog.csv";
+  assets.add("stars", [this, catalog_path](){
+    std::vector<catalog_star> stars;
+    if (std::ifstream{catalog_path}) {
+      // catalog positions are in parsec, 1000pc end up at the far plane
+      stars = star_catalog::parse(catalog_path, 0.05f, 1000.f, m_workers);
     }
-  }
+    else {
+      stars = star_catalog::generate(10000, 50.f, 51u);
+    }
+    // Spatial chunks can be culled and drawn with less stars when far away
+    // Small chunks separate near and far stars well, but at most ~4096 chunks are drawn
+    std::size_t chunk_size = std::max<std::size_t>(256, stars.size() / 4096);
+    std::shared_ptr<starfield> field = std::make_shared<starfield>(star_catalog::build(std::move(stars), chunk_size));
+    return asset_graph::upload_fn{[this, field](){ this->uploadStars(*field); }};
+  });
+}
 
+void ApplicationSolar::uploadStars(starfield& field){
   glGenVertexArrays(1, &star_object.vertex_AO);
   // bind the array for attaching buffers
   glBindVertexArray(star_object.vertex_AO);
@@ -327,66 +968,224 @@ void ApplicationSolar::initializeStars(){
   // bind this as an vertex array buffer containing all attributes
   glBindBuffer(GL_ARRAY_BUFFER, star_object.vertex_BO);
   // configure currently bound array buffer
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * milky_way.size(), milky_way.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(packed_star) * field.stars.size(), field.stars.data(), GL_STATIC_DRAW);
 
-  // glVertexAttribPointer(index, size, dtype, norm, str, ptr)
-  // index: 0 for POSITION and 1 for COLOR of star
-  // size: POSITION contains x,y,z so 3, COLOR contains r,g,b so 3
-  // dtype: GL_FLOAT
-  // norm: GL_FALSE
-  // str: size of each star content(for iterating the milky way) POSITION + COLOR = 3 +3 = 6
-  // ptr: in the milky_way, points to a stars first value of either POSITION or COLOR, so either 0 or 3
-
-  // first attribute is POSITION 0
+  // One star: 3 x 16 bit position inside its chunk + 16 bit rgb565 color = 8 bytes
+  // first attribute is POSITION 0, normalized to [0, 1] and scaled by the chunk bounds in the shader
   glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, GLsizei(sizeof(packed_star)), (GLvoid*)(0));
 
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, GLsizei(sizeof(float) * 6), (GLvoid*)(sizeof(float) * 0) );
-  
-  // second attribute is COLOR 1
+  // second attribute is COLOR 1, integer attribute unpacked in the shader
   glEnableVertexAttribArray(1);
-  // second attribute is 3 floats with no offset & stride
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, GLsizei(sizeof(float) * 6), (GLvoid*)(sizeof(float) * 3) );
-
+  glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, GLsizei(sizeof(packed_star)), (GLvoid*)(sizeof(std::uint16_t) * 3));
 
   // store type of primitive to draw
   star_object.draw_mode = GL_POINTS;
   // transfer number of indices to model object 
-  star_object.num_elements = GLsizei(milky_way.size()/6);
+  star_object.num_elements = GLsizei(field.stars.size());
 
+  // Only the chunks are needed for drawing
+  star_field = std::move(field);
+  star_field.stars.clear();
+  star_field.stars.shrink_to_fit();
 }
+// cube maps for the far stars and an empty vao for the fullscreen triangle
+void ApplicationSolar::initializeSkybox(){
+  glGenVertexArrays(1, &skybox_object.vertex_AO);
+  skybox_object.draw_mode = GL_TRIANGLES;
+  skybox_object.num_elements = 3;
+
+  star_cubemaps[0] = cubemap::create(1024);
+  star_cubemaps[1] = cubemap::create(1024);
+}
+// one unit circle shared by all rings, ring centers, radii and colors are instance data
+void ApplicationSolar::initializeOrbits(){
+  // Bodies circling the root first, their rings never move
+  for (int pass = 0; pass < 2; ++pass) {
+    for (auto planet_geo : geometry_node_Vector) {
+      Node * planet_holder = planet_geo->parent;
+      bool around_root = planet_holder->parent == scene_graph_all.root;
+      // The holders translation is the orbit radius, rotations keep it unchanged
+      float radius = glm::length(glm::fvec3(planet_holder->getLocalTransform()[3]));
+      if (radius <= 0.f || around_root != (pass == 0)) {
+        continue;
+      }
+      glm::fvec4 center = planet_holder->parent->getWorldTransform()[3];
+      float ring[ORBIT_FLOATS] = {center.x, center.y, center.z, radius,
+                                  planet_geo->geo_color.r, planet_geo->geo_color.g, planet_geo->geo_color.b, 1.f};
+      orbits.insert(orbits.end(), ring, ring + ORBIT_FLOATS);
+      orbit_bodies.push_back(planet_geo);
+    }
+    if (pass == 0) {
+      m_orbit_static = orbit_bodies.size();
+    }
+  }
+  if (orbit_bodies.empty()) {
+    return;
+  }
+
+  std::vector<float> circle;
+  for (GLsizei i = 0; i < ORBIT_SEGMENTS; ++i) {
+    float angle = 2.f * glm::pi<float>() * float(i) / float(ORBIT_SEGMENTS);
+    circle.push_back(std::cos(angle));
+    circle.push_back(std::sin(angle));
+  }
+  glGenVertexArrays(1, &orbit_object.vertex_AO);
+  glBindVertexArray(orbit_object.vertex_AO);
+  glGenBuffers(1, &orbit_object.vertex_BO);
+  glBindBuffer(GL_ARRAY_BUFFER, orbit_object.vertex_BO);
+  glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(sizeof(float) * circle.size()), circle.data(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+  orbit_object.draw_mode = GL_LINE_LOOP;
+  orbit_object.num_elements = ORBIT_SEGMENTS;
+
+  // Instance data is read from a buffer texture, attribute divisors would need gl 3.3
+  glGenBuffers(1, &orbit_instance_BO);
+  glBindBuffer(GL_TEXTURE_BUFFER, orbit_instance_BO);
+  glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(sizeof(float) * orbits.size()), orbits.data(), GL_DYNAMIC_DRAW);
+  orbit_instances.target = GL_TEXTURE_BUFFER;
+  glGenTextures(1, &orbit_instances.handle);
+  glBindTexture(GL_TEXTURE_BUFFER, orbit_instances.handle);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, orbit_instance_BO);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  std::vector<glm::fvec4> colors;
+  for (auto body : orbit_bodies) {
+    colors.push_back(glm::fvec4{body->geo_color, 1.f});
+  }
+  planet_trails = trails::create(colors, TRAIL_LENGTH);
+}
+
+// g-buffer matching the default framebuffer
+void ApplicationSolar::initializeDeferred(){
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  planet_gbuffer = deferred::create(viewport[2], viewport[3]);
+}
+
 // ------------------Personal StarInit--------------------------------------------------------------------------
 
 // ------------------Personal TexInit---------------------------------------------------------------------------
 
-void ApplicationSolar::initializeTextures(){
-  // Get pixel_data
-  geometry_node * planet_geo = new geometry_node();
-  for (int i = 0; i < (int)geometry_node_Vector.size(); i++){
-    planet_geo = geometry_node_Vector[i];
-    pixel_data pixel;
-    try
-    {
-      pixel = texture_loader::file(m_resource_path + "textures/" + planet_geo->name + ".png");
+void ApplicationSolar::initializeTextures(asset_graph& assets){
+  // Worker tasks must not call gl, query the limit for resizing here
+  GLint max_size = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+  // Each planet is read by its own task, layer i of the array belongs to geometry node i
+  std::size_t num_planets = geometry_node_Vector.size();
+  std::shared_ptr<std::vector<cooked_texture>> cooked = std::make_shared<std::vector<cooked_texture>>(num_planets);
+  std::shared_ptr<std::vector<pixel_data>> images = std::make_shared<std::vector<pixel_data>>(num_planets);
+  std::vector<asset_graph::task_id> planet_tasks;
+  for (std::size_t i = 0; i < num_planets; i++){
+    std::string path = m_resource_path + "textures/" + geometry_node_Vector[i]->name;
+    planet_tasks.push_back(assets.add(path, [cooked, images, i, path](){
+      // Prefer textures cooked with cook_textures, they only need to be read and uploaded
+      try
+      {
+        (*cooked)[i] = texture_loader::cooked(path + ".ctex");
+      }
+      catch(std::exception const&)
+      {
+        (*images)[i] = loadPlanetImage(path + ".png");
+      }
+      return asset_graph::upload_fn{};
+    }));
+  }
+
+  // Combine all planets into the layers of one array once every planet is read
+  assets.add("planet textures", [this, cooked, images, max_size](){
+    bool all_cooked = true;
+    for (auto const& texture : *cooked){
+      cooked_texture const& first = cooked->front();
+      all_cooked = all_cooked && !texture.levels.empty() && texture.internal_format == first.internal_format
+                && texture.levels.size() == first.levels.size()
+                && texture.levels[0].width == first.levels[0].width && texture.levels[0].height == first.levels[0].height;
     }
-    catch(std::exception e)
-    {
-      std::cout<<"Error loading planet: "<< planet_geo->name << '\n';
+
+    std::shared_ptr<std::vector<pixel_data>> layers = std::make_shared<std::vector<pixel_data>>();
+    if (!all_cooked) {
+      // not all planets are cooked alike, decode images instead
+      for (std::size_t i = 0; i < cooked->size(); i++){
+        if (!(*cooked)[i].levels.empty()) {
+          (*images)[i] = loadPlanetImage(m_resource_path + "textures/" + geometry_node_Vector[i]->name + ".png");
+        }
+      }
+      cooked->clear();
+      *layers = texture_array::prepare(*images, std::size_t(max_size));
     }
+    images->clear();
+    return asset_graph::upload_fn{[this, cooked, layers](){ this->uploadTextures(*cooked, *layers); }};
+  }, planet_tasks);
+}
+
+// read a planet image, missing images stay empty and become white layers
+pixel_data ApplicationSolar::loadPlanetImage(std::string const& path){
+  try
+  {
+    return texture_loader::file(path);
+  }
+  catch(std::exception const&)
+  {
+    std::cout<<"Error loading planet: "<< path << '\n';
+  }
+  return pixel_data{};
+}
 
-    //Initialise Texture
-    texture_object texture;
-    texture.target = GL_TEXTURE_2D;
+void ApplicationSolar::uploadTextures(std::vector<cooked_texture>& cooked, std::vector<pixel_data>& layers){
+  glActiveTexture(GL_TEXTURE0);
+  if (!cooked.empty()) {
+    // Allocate the whole array now, the streamer fills one level of one layer per request
+    planet_textures = texture_array::allocate(cooked.front(), cooked.size());
+    for (std::size_t layer = 0; layer < cooked.size(); layer++){
+      cooked_texture& texture = cooked[layer];
+      for (std::size_t level = 0; level < texture.levels.size(); level++){
+        if (texture.compressed) {
+          m_texture_streamer.enqueue(planet_textures, GLint(level), GLint(layer), texture.internal_format, std::move(texture.levels[level]));
+        }
+        else {
+          texture_level& data = texture.levels[level];
+          m_texture_streamer.enqueue(planet_textures, GLint(level), GLint(layer),
+                                     pixel_data{std::move(data.bytes), texture.channels, texture.channel_type, data.width, data.height});
+        }
+      }
+    }
+  }
+  else {
+    //Initialise Texture, all planets share one array texture
+    pixel_data const& first = layers.front();
+    // Only the base level is allocated, the chain is generated once all layers arrived
+    cooked_texture format{};
+    format.levels.push_back(texture_level{first.width, first.height, std::vector<std::uint8_t>{}});
+    format.internal_format = first.channels == GL_RGBA ? GL_RGBA8 : GL_RGB8;
+    format.channels = first.channels;
+    format.channel_type = first.channel_type;
+    planet_textures = texture_array::allocate(format, layers.size());
+
+    texture_object textures = planet_textures;
+    for (std::size_t layer = 0; layer < layers.size(); layer++){
+      std::function<void()> on_complete{};
+      if (layer + 1 == layers.size()) {
+        // All layers are uploaded, build the mip chain from them
+        on_complete = [textures](){
+          glBindTexture(textures.target, textures.handle);
+          glTexParameteri(textures.target, GL_TEXTURE_MAX_LEVEL, 1000);
+          glGenerateMipmap(textures.target);
+          glTexParameteri(textures.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        };
+      }
+      m_texture_streamer.enqueue(planet_textures, 0, GLint(layer), std::move(layers[layer]), on_complete);
+    }
+  }
 
-    glActiveTexture(GL_TEXTURE0);
-    glGenTextures(1, &texture.handle);
-    glBindTexture(texture.target, texture.handle);
-    //Define Texture Sampling Parameters (mandatory)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    //Define Texture Data and Format
-    glTexImage2D(texture.target, 0, pixel.channels, (GLsizei)pixel.width, (GLsizei)pixel.height, 0, pixel.channels, pixel.channel_type, pixel.ptr());
-    planet_geo->geo_texture = texture;
+  for (int i = 0; i < (int)geometry_node_Vector.size(); i++){
+    geometry_node_Vector[i]->geo_texture = planet_textures;
+    geometry_node_Vector[i]->geo_layer = i;
   }
+  // the geometry may have been uploaded before the layers were known
+  uploadPlanetObjects();
 }
 
 // ------------------Personal TexInit---------------------------------------------------------------------------
@@ -429,6 +1228,7 @@ void ApplicationSolar::initializeSceneGraph(){
   // lightIntensity and lightColor
   light_all->setlightColor(glm::vec3(0.5f, 0.5f, 0.f));
   light_all->lightIntensity = 50.f;
+  light_nodes.push_back(light_all);
 
 
   // Sun Node--------------------------------------------------------
@@ -568,6 +1368,33 @@ void ApplicationSolar::initializeSceneGraph(){
 
 
 ///////////////////////////// callback functions for window events ////////////
+// scripted camera paths for benchmark runs
+void ApplicationSolar::scriptCamera(std::string const& scene, unsigned frame, unsigned num_frames) {
+  // progress of the path in [0, 1), endless runs repeat it every 1000 frames
+  float t = num_frames > 0 ? float(frame) / float(num_frames) : float(frame % 1000) / 1000.f;
+  glm::fvec3 eye{};
+  glm::fvec3 target{};
+  if (scene == "overview") {
+    // whole system from above, nothing moves but the planets
+    eye = glm::fvec3{0.f, 30.f, 30.f};
+  }
+  else if (scene == "orbit") {
+    // one revolution around the sun
+    float angle = 2.f * glm::pi<float>() * t;
+    eye = glm::fvec3{35.f * std::sin(angle), 8.f, 35.f * std::cos(angle)};
+  }
+  else if (scene == "flyby") {
+    // straight through the system, close to the sun and all planets
+    eye = glm::fvec3{0.f, 2.f, 40.f - 80.f * t};
+    target = eye - glm::fvec3{0.f, 0.f, 1.f};
+  }
+  else {
+    throw std::invalid_argument("unknown scene '" + scene + "', expected overview, orbit or flyby");
+  }
+  m_view_transform = glm::inverse(glm::lookAt(eye, target, glm::fvec3{0.f, 1.f, 0.f}));
+  uploadView();
+}
+
 // handle key input
 void ApplicationSolar::keyCallback(int key, int action, int mods) {
   if (key == GLFW_KEY_W  && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
@@ -586,6 +1413,22 @@ void ApplicationSolar::keyCallback(int key, int action, int mods) {
     m_view_transform = glm::translate(m_view_transform, glm::fvec3{1.f, 0.0f, 0.0f});
     uploadView();
   }
+  // toggle gpu driven culling and drawing
+  else if (key == GLFW_KEY_G && action == GLFW_PRESS && planet_batch.capacity > 0) {
+    m_gpu_driven = !m_gpu_driven;
+  }
+  // Toggle culling of planets hidden behind large bodies
+  else if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+    m_occlusion_culling = !m_occlusion_culling;
+  }
+  // Toggle between forward and deferred planet lighting
+  else if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+    m_deferred = !m_deferred;
+  }
+  // Toggle between baked and per frame far stars
+  else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+    m_star_cubemap_mode = !m_star_cubemap_mode;
+  }
 }
 
 //handle delta mouse movement input
@@ -614,6 +1457,12 @@ void ApplicationSolar::resizeCallback(unsigned width, unsigned height) {
   m_view_projection = utils::calculate_projection_matrix(float(width) / float(height));
   // upload new projection matrix
   uploadProjection();
+  // the same error covers more pixels at higher resolutions
+  updatePlanetLods(height);
+  // g-buffer has to match the framebuffer
+  if (planet_gbuffer.framebuffer != 0) {
+    deferred::resize(planet_gbuffer, GLsizei(width), GLsizei(height));
+  }
 }
 
 // exe entry point
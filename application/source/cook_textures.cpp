@@ -0,0 +1,79 @@
+// offline tool converting images into cooked textures with mip chains
+// usage: cook_textures [--bc1|--bc3|--bc7] [--srgb] [--kaiser] [--size WxH] <images...>
+// each image is written next to its source with the extension .ctex
+#include "texture_loader.hpp"
+#include "texture_cooker.hpp"
+#include "texture_array.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::string cooked_name(std::string const& file_path) {
+  std::size_t extension = file_path.find_last_of('.');
+  std::size_t separator = file_path.find_last_of("/\\");
+  if (extension == std::string::npos || (separator != std::string::npos && extension < separator)) {
+    return file_path + ".ctex";
+  }
+  return file_path.substr(0, extension) + ".ctex";
+}
+
+int main(int argc, char* argv[]) {
+  texture_cooker::options opts{};
+  std::size_t width = 0;
+  std::size_t height = 0;
+  std::vector<std::string> inputs{};
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{argv[i]};
+    if (arg == "--bc1") opts.compression = texture_cooker::block_format::bc1;
+    else if (arg == "--bc3") opts.compression = texture_cooker::block_format::bc3;
+    else if (arg == "--bc7") opts.compression = texture_cooker::block_format::bc7;
+    else if (arg == "--srgb") opts.srgb = true;
+    else if (arg == "--kaiser") opts.filter = texture_cooker::mip_filter::kaiser;
+    else if (arg == "--size" && i + 1 < argc) {
+      // all layers of a texture array need the same resolution
+      if (std::sscanf(argv[++i], "%zux%zu", &width, &height) != 2) {
+        std::cerr << "invalid size '" << argv[i] << "', expected WxH" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    else if (arg.size() > 1 && arg[0] == '-') {
+      std::cerr << "unknown option " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+    else inputs.push_back(arg);
+  }
+
+  if (inputs.empty()) {
+    std::cerr << "usage: " << argv[0] << " [--bc1|--bc3|--bc7] [--srgb] [--kaiser] [--size WxH] <images...>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int status = EXIT_SUCCESS;
+  for (auto const& input : inputs) {
+    try {
+      pixel_data image = texture_loader::file(input);
+      if (width > 0 && height > 0) {
+        image = texture_array::resize(image, width, height);
+      }
+      cooked_texture texture = texture_cooker::cook(image, opts);
+      std::string output = cooked_name(input);
+      texture_cooker::write(texture, output);
+
+      std::size_t bytes = 0;
+      for (auto const& level : texture.levels) {
+        bytes += level.bytes.size();
+      }
+      std::cout << input << " -> " << output << ": " << texture.levels.size() << " levels, " << bytes << " bytes" << std::endl;
+    }
+    catch (std::exception const& e) {
+      std::cerr << input << ": " << e.what() << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+  return status;
+}
@@ -2,10 +2,15 @@
 #define APPLICATION_HPP
 
 #include "structs.hpp"
+#include "file_watcher.hpp"
+#include "gpu_profiler.hpp"
+#include "gl_state.hpp"
 
 #include <glm/gtc/type_precision.hpp>
 
 #include <map>
+#include <string>
+#include <vector>
 
 struct GLFWwindow;
 // gpu representation of model
@@ -27,6 +32,8 @@ class Application {
   void mouse_callback(GLFWwindow* window, double pos_x, double pos_y);
   // recompile shaders form source files
   void reloadShaders(bool throwing);
+  // recompile shaders whose source files or includes were written since the last call
+  void reloadChangedShaders();
 
 // functiosn which are implemented in derived classes
   // update uniform locations and values
@@ -37,16 +44,30 @@ class Application {
   inline virtual void mouseCallback(double pos_x, double pos_y) {};
   // update framebuffer textures
   inline virtual void resizeCallback(unsigned width, unsigned height) {};
+  // update per frame state before drawing
+  inline virtual void update() {};
+  // move camera along the named path, num_frames is 0 for endless runs
+  inline virtual void scriptCamera(std::string const& scene, unsigned frame, unsigned num_frames) {};
   // draw all objects
   virtual void render() const = 0;
 
  protected:
   void updateUniformLocations();
+  // recompile programs depending on one of the files, keeps programs failing to compile
+  void recompileShaders(std::vector<std::string> const& changed_files);
+  // watch all source files of the current programs
+  void watchShaderSources();
 
   std::string m_resource_path; 
 
   // container for the shader programs
   std::map<std::string, shader_program> m_shaders{};
+  // notifies about edited shader sources
+  file_watcher m_shader_watcher;
+  // gpu time of named passes, scopes are opened while drawing
+  mutable gpu_profiler m_gpu_profiler;
+  // bindings and uniforms, drops calls that would not change anything
+  mutable gl_state m_gl_state;
 
   // resolution when 
   static const glm::uvec2 initial_resolution; 
@@ -55,41 +76,193 @@ class Application {
 
 
 #include "utils.hpp"
+#include "shader_loader.hpp"
 #include "window_handler.hpp"
+#include "command_line.hpp"
+#include "headless.hpp"
+#include "benchmark.hpp"
+#include "cpu_profiler.hpp"
+#include "frame_capture.hpp"
+#include "frame_stats.hpp"
+#include "gl_validation.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <memory>
 
 template<typename T>
 void Application::run(int argc, char* argv[], unsigned ver_major, unsigned ver_minor) {  
 
-    GLFWwindow* window = window_handler::initialize(initial_resolution, ver_major, ver_minor);
+    run_options options = command_line::parse(argc, argv, initial_resolution);
+    PROFILE_THREAD("main");
+
+    // without display render into an offscreen surface
+    GLFWwindow* window = nullptr;
+    headless_context offscreen{};
+    if (options.headless) {
+      offscreen = headless::initialize(options.resolution, ver_major, ver_minor, gl_validation::needs_debug_context(options.validation));
+    }
+    else {
+      window = window_handler::initialize(options.resolution, ver_major, ver_minor, gl_validation::needs_debug_context(options.validation));
+    }
+    gl_validation::set_level(options.validation);
     
-    std::string resource_path = utils::read_resource_path(argc, argv);
-    T* application = new T{resource_path};
+    // reuse linked programs of previous runs
+    shader_loader::set_cache_directory("shader_cache");
+    T* application = new T{options.resource_path};
 
-    window_handler::set_callback_object(window, application);
+    if (window) {
+      window_handler::set_callback_object(window, application);
+    }
 
     // do intial shader load an uniform upload
     application->reloadShaders(true);
+    // projection and framebuffer textures were created for the initial resolution
+    application->resize_callback(options.resolution.x, options.resolution.y);
+
+    // frames are read back asynchronously and written by a worker
+    std::unique_ptr<frame_capture> capture{};
+    if (!options.capture.empty()) {
+      capture.reset(new frame_capture{options.capture, options.capture_format});
+    }
 
     // enable depth testing
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
     
-    // rendering loop
-    while (!glfwWindowShouldClose(window)) {
-      // query input
-      glfwPollEvents();
+    // rolling frame time percentiles, shown in the title and appended to the stats file every second
+    frame_stats stats{};
+    std::ofstream stats_file{};
+    bool stats_json = options.stats.size() >= 5 && options.stats.compare(options.stats.size() - 5, 5, ".json") == 0;
+    if (!options.stats.empty()) {
+      stats_file.open(options.stats);
+      if (!stats_file) {
+        throw std::runtime_error("could not open stats file " + options.stats);
+      }
+      if (!stats_json) {
+        stats_file << frame_stats::csv_header() << std::endl;
+      }
+    }
+
+    // rendering loop, limited runs measure every frame
+    std::vector<double> frame_ms{};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point previous_start = start;
+    std::chrono::steady_clock::time_point last_status = start;
+    for (unsigned frame = 0; options.frames == 0 || frame < options.frames; ++frame) {
+      if (window && glfwWindowShouldClose(window)) {
+        break;
+      }
+      std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+      PROFILE_SCOPE("frame");
+      if (window) {
+        PROFILE_SCOPE("events");
+        // query input
+        glfwPollEvents();
+        // recompile shaders edited since the last frame
+        application->reloadChangedShaders();
+      }
+      if (!options.scene.empty()) {
+        application->scriptCamera(options.scene, frame, options.frames);
+      }
       // clear buffer
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-      // draw geometry
-      application->render();
-      // swap draw buffer to front
-      glfwSwapBuffers(window);
-      // display fps
-      window_handler::show_fps(window);
+      application->m_gpu_profiler.begin_frame();
+      application->m_gl_state.begin_frame();
+      {
+        PROFILE_SCOPE("update");
+        // advance per frame work like streaming
+        application->update();
+      }
+      // update may bind directly, e.g. when streaming textures
+      application->m_gl_state.invalidate();
+      {
+        PROFILE_SCOPE("render");
+        // draw geometry
+        application->render();
+      }
+      application->m_gpu_profiler.end_frame();
+      if (capture) {
+        PROFILE_SCOPE("capture");
+        int width = int(options.resolution.x);
+        int height = int(options.resolution.y);
+        if (window) {
+          glfwGetFramebufferSize(window, &width, &height);
+        }
+        capture->capture(width, height);
+      }
+      gl_validation::check_frame(frame);
+      std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+      if (window) {
+        PROFILE_SCOPE("swap");
+        // swap draw buffer to front
+        glfwSwapBuffers(window);
+      }
+
+      // the first frame has no predecessor to measure the interval to
+      if (frame > 0) {
+        stats.add_frame(std::chrono::duration<double, std::milli>(frame_start - previous_start).count(),
+                        std::chrono::duration<double, std::milli>(submitted - frame_start).count());
+      }
+      previous_start = frame_start;
+      for (double gpu_ms : application->m_gpu_profiler.take_frame_times()) {
+        stats.add_gpu(gpu_ms);
+      }
+      if (frame_start - last_status >= std::chrono::seconds{1}) {
+        frame_stats::summary summary = stats.compute();
+        if (window) {
+          std::ostringstream status{};
+          status << std::fixed << std::setprecision(1) << summary.fps << " fps, p99 " << summary.interval.p99
+                 << " ms, " << summary.hitches << " hitches";
+          window_handler::show_status(window, status.str());
+        }
+        if (stats_file.is_open()) {
+          stats_file << (stats_json ? frame_stats::json(summary) : frame_stats::csv(summary)) << std::endl;
+        }
+        last_status = frame_start;
+      }
+      if (options.frames > 0) {
+        PROFILE_SCOPE("finish");
+        // include the gpu work of this frame in its time
+        glFinish();
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count());
+      }
+    }
+
+    // statistics of the frames after the last full second
+    if (stats_file.is_open()) {
+      frame_stats::summary summary = stats.compute();
+      stats_file << (stats_json ? frame_stats::json(summary) : frame_stats::csv(summary)) << std::endl;
+    }
+
+    if (options.frames > 0) {
+      double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::string renderer{reinterpret_cast<char const*>(glGetString(GL_RENDERER))};
+      benchmark::write_report(options, benchmark::report(options, window ? "glfw" : "egl", renderer, frame_ms, total_seconds,
+                                                           application->m_gpu_profiler, application->m_gl_state));
+    }
+
+    if (capture) {
+      capture->flush();
+      std::cerr << "captured " << capture->frames_written() << " frames to " << options.capture << std::endl;
+      capture.reset();
+    }
+
+    if (!options.trace.empty()) {
+#ifndef FRAMEWORK_PROFILE
+      std::cerr << "built without FRAMEWORK_PROFILE, the trace contains no scopes" << std::endl;
+#endif
+      cpu_profiler::write_chrome_trace(options.trace);
     }
 
     delete application;
-    window_handler::close_and_quit(window, EXIT_SUCCESS);
+    if (window) {
+      window_handler::close_and_quit(window, EXIT_SUCCESS);
+    }
+    headless::close_and_quit(offscreen, EXIT_SUCCESS);
 }
 
 
@@ -0,0 +1,69 @@
+#ifndef ASSET_GRAPH_HPP
+#define ASSET_GRAPH_HPP
+
+#include "mpsc_queue.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// loads assets on worker threads, gl uploads run on the thread calling poll or wait
+// a task starts once the load steps of all its dependencies finished,
+// uploads are executed in an order where dependencies come first
+class asset_graph {
+ public:
+  typedef std::size_t task_id;
+  // runs on the gl thread, may be empty
+  typedef std::function<void()> upload_fn;
+  // runs on a worker, reads and decodes data and returns the step uploading it
+  typedef std::function<upload_fn()> load_fn;
+
+  explicit asset_graph(thread_pool& pool);
+  // waits for running loads, they reference the graph
+  ~asset_graph();
+
+  asset_graph(asset_graph const&) = delete;
+  asset_graph& operator=(asset_graph const&) = delete;
+
+  // add task, dependencies must have been added before
+  task_id add(std::string const& name, load_fn load, std::vector<task_id> const& dependencies = std::vector<task_id>{});
+  // start all tasks without dependencies
+  void run();
+  // execute finished uploads, returns true if all tasks are done
+  // throws if a load failed, dependents of a failed task never run
+  bool poll();
+  // execute uploads until all tasks are done
+  void wait();
+
+ private:
+  struct task {
+    std::string name;
+    load_fn load;
+    std::vector<task_id> dependents;
+    // dependencies whose load has not finished
+    std::atomic<std::size_t> missing;
+  };
+
+  void schedule(task_id id);
+  void execute(task_id id);
+
+  thread_pool& m_pool;
+  std::vector<std::unique_ptr<task>> m_tasks;
+  mpsc_queue<upload_fn> m_uploads;
+  // tasks whose upload was not executed yet, gl thread only
+  std::size_t m_remaining;
+  bool m_started;
+
+  // only used to sleep while no upload is ready
+  std::mutex m_mutex;
+  std::condition_variable m_ready;
+  // loads submitted to the pool but not finished, guarded by m_mutex
+  std::size_t m_in_flight;
+};
+
+#endif
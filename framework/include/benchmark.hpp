@@ -0,0 +1,21 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include "command_line.hpp"
+#include "gl_state.hpp"
+#include "gpu_profiler.hpp"
+
+#include <string>
+#include <vector>
+
+namespace benchmark {
+  // json object with run settings, frame time statistics, gpu time per pass in milliseconds
+  // and the gl calls issued and skipped by the state cache per frame
+  std::string report(run_options const& options, std::string const& backend, std::string const& renderer,
+                     std::vector<double> const& frame_ms, double total_seconds, gpu_profiler const& gpu_timers,
+                     gl_state const& state);
+  // write report to the output file of options or stdout, throws if the file cannot be written
+  void write_report(run_options const& options, std::string const& report);
+}
+
+#endif
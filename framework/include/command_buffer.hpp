@@ -0,0 +1,97 @@
+#ifndef COMMAND_BUFFER_HPP
+#define COMMAND_BUFFER_HPP
+
+#include "gl_state.hpp"
+#include "thread_pool.hpp"
+
+#include <glbinding/gl/types.h>
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// list of draw commands, recording makes no gl calls and works on any thread
+// replaying issues them on the gl thread through a state cache
+class command_buffer {
+ public:
+  command_buffer();
+
+  // drop recorded commands, keeps the allocated memory for the next recording
+  void clear();
+
+  void use_program(gl::GLuint program);
+  void bind_vertex_array(gl::GLuint vertex_array);
+  void bind_texture(unsigned unit, gl::GLenum target, gl::GLuint texture);
+  // uniforms of the program in use at replay
+  void uniform(gl::GLint location, int value);
+  void uniform(gl::GLint location, float value);
+  void uniform(gl::GLint location, glm::fvec3 const& value);
+  void uniform(gl::GLint location, glm::fmat4 const& value);
+  // offset in bytes into the bound index buffer
+  void draw_elements(gl::GLenum mode, gl::GLsizei count, gl::GLenum type, std::size_t offset);
+  void draw_arrays(gl::GLenum mode, gl::GLint first, gl::GLsizei count);
+
+  // issue all commands in order of recording
+  void replay(gl_state& state) const;
+  // number of recorded commands
+  std::size_t size() const;
+
+ private:
+  enum class op : std::uint8_t {
+    use_program, bind_vertex_array, bind_texture,
+    uniform_int, uniform_float, uniform_vec3, uniform_mat4,
+    draw_elements, draw_arrays
+  };
+
+  struct command {
+    op type;
+    gl::GLenum target;
+    gl::GLuint handle;
+    gl::GLint first;
+    gl::GLsizei count;
+    // index of the first uniform value or byte offset of indexed draws
+    std::size_t data;
+  };
+
+  void push(op type, gl::GLenum target, gl::GLuint handle, gl::GLint first, gl::GLsizei count, std::size_t data);
+  // uniform values of all commands, ints are stored bitwise
+  std::size_t push_data(float const* values, std::size_t size);
+
+  std::vector<command> m_commands;
+  std::vector<float> m_data;
+};
+
+// records ranges of a draw list into one command buffer per worker task
+// buffers are replayed in order of their ranges, so the result never depends on thread timing
+class command_recorder {
+ public:
+  // records into a range of range(buffer, first, last)
+  using record_fn = std::function<void(command_buffer&, std::size_t, std::size_t)>;
+
+  // ranges hold at least min_batch items, smaller lists are recorded on the calling thread
+  explicit command_recorder(thread_pool& workers, std::size_t min_batch = 64);
+
+  command_recorder(command_recorder const&) = delete;
+  command_recorder& operator=(command_recorder const&) = delete;
+
+  // split [0, num_items) into ranges and record them in parallel, blocks until all are recorded
+  // record must not make gl calls, its errors are rethrown here
+  void record(std::size_t num_items, record_fn const& record);
+  // replay the buffers of the last record on the gl thread
+  void replay(gl_state& state) const;
+
+  // ranges and commands of the last record
+  std::size_t num_buffers() const;
+  std::size_t num_commands() const;
+
+ private:
+  thread_pool& m_workers;
+  std::size_t m_min_batch;
+  // reused between frames, only the first m_num_buffers are valid
+  std::vector<command_buffer> m_buffers;
+  std::size_t m_num_buffers;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef COMMAND_LINE_HPP
+#define COMMAND_LINE_HPP
+
+#include "gl_validation.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <string>
+
+// settings of one run, given as --name=value options
+struct run_options {
+  // first argument not starting with --
+  std::string resource_path;
+  // render into an offscreen surface instead of a window
+  bool headless = false;
+  // number of frames to render before quitting, 0 runs until the window is closed
+  unsigned frames = 0;
+  glm::uvec2 resolution;
+  // scripted camera path, empty for interactive control
+  std::string scene;
+  // timing report file, empty writes it to stdout
+  std::string output;
+  // directory receiving every rendered frame, empty disables capturing
+  std::string capture;
+  // image format of captured frames, tga or ppm
+  std::string capture_format = "tga";
+  // chrome trace file of all cpu scopes, empty disables the export
+  std::string trace;
+  // error checking of gl calls
+  gl_validation::level validation = gl_validation::default_level();
+  // file receiving frame statistics once per second, json lines for .json and csv otherwise
+  std::string stats;
+};
+
+namespace command_line {
+  // parse options, prints usage and exits on --help or invalid options
+  run_options parse(int argc, char* argv[], glm::uvec2 const& default_resolution);
+  // description of all options
+  std::string usage(std::string const& program);
+}
+
+#endif
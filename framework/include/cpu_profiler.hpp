@@ -0,0 +1,87 @@
+#ifndef CPU_PROFILER_HPP
+#define CPU_PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CPU_PROFILER_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CPU_PROFILER_TSC
+#endif
+
+// records cpu time of nested scopes into one buffer per thread
+// writing needs no lock, recorded scopes are exported as chrome trace events
+// each thread keeps a bounded number of scopes, later ones are only counted
+// the PROFILE_ macros only record with the cmake option FRAMEWORK_PROFILE,
+// otherwise they compile to nothing
+namespace cpu_profiler {
+  // steady clock in nanoseconds
+  inline std::uint64_t now() {
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  // time stamp counter on x86, reading it costs a fraction of now(), steady clock nanoseconds elsewhere
+  // ticks are converted to nanoseconds on export, calibrated against now() over the time since program start
+  inline std::uint64_t ticks() {
+#ifdef CPU_PROFILER_TSC
+    return std::uint64_t(__rdtsc());
+#else
+    return now();
+#endif
+  }
+
+  // append scope to the buffer of the calling thread, name must stay valid until export
+  void record(char const* name, std::uint64_t begin_ticks, std::uint64_t end_ticks);
+  // name shown for the calling thread in the trace
+  void name_thread(std::string const& name);
+  // copy of name valid until the program ends, for names built at runtime
+  char const* intern(std::string const& name);
+
+  // trace event json of all scopes recorded so far, viewable in perfetto or chrome://tracing
+  std::string chrome_trace();
+  // write chrome_trace to file, throws if the file cannot be written
+  void write_chrome_trace(std::string const& path);
+  // number of scopes recorded so far
+  std::size_t num_events();
+
+  // records its lifetime
+  class scope {
+   public:
+    explicit scope(char const* name)
+     :m_name{name}
+     ,m_begin{ticks()}
+    {}
+    ~scope() {
+      record(m_name, m_begin, ticks());
+    }
+
+    scope(scope const&) = delete;
+    scope& operator=(scope const&) = delete;
+
+   private:
+    char const* m_name;
+    std::uint64_t m_begin;
+  };
+}
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef FRAMEWORK_PROFILE
+// time the rest of the enclosing block
+#define PROFILE_SCOPE(name) cpu_profiler::scope PROFILE_CONCAT(profile_scope_, __LINE__){name}
+// time the rest of the enclosing function under its name
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+// name the calling thread in the trace
+#define PROFILE_THREAD(name) cpu_profiler::name_thread(name)
+#else
+#define PROFILE_SCOPE(name) static_cast<void>(0)
+#define PROFILE_FUNCTION() static_cast<void>(0)
+#define PROFILE_THREAD(name) static_cast<void>(0)
+#endif
+
+#endif
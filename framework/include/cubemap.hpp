@@ -0,0 +1,31 @@
+#ifndef CUBEMAP_HPP
+#define CUBEMAP_HPP
+
+#include "structs.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+// cube map texture with a framebuffer to render into its faces
+struct cubemap_target {
+  texture_object texture;
+  GLuint framebuffer = 0;
+  // edge length of a face in pixels
+  GLsizei size = 0;
+};
+
+namespace cubemap {
+  const unsigned NUM_FACES = 6;
+
+  // create color cube map without depth buffer
+  cubemap_target create(GLsizei size, GLenum internal_format = GL_RGBA8);
+  // attach face to framebuffer of target, bind it and set the viewport to the face
+  void bind_face(cubemap_target const& target, unsigned face);
+  // view matrix looking through face from position, in cube map face order
+  glm::fmat4 face_view(unsigned face, glm::fvec3 const& position);
+  // projection covering exactly one face
+  glm::fmat4 face_projection(float near, float far);
+  // free texture and framebuffer
+  void destroy(cubemap_target& target);
+}
+
+#endif
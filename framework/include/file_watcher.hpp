@@ -0,0 +1,37 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// reports modifications of watched files without blocking
+// uses inotify on linux and compares modification times elsewhere
+class file_watcher {
+ public:
+  file_watcher();
+  ~file_watcher();
+
+  file_watcher(file_watcher const&) = delete;
+  file_watcher& operator=(file_watcher const&) = delete;
+
+  // start watching file, repeated calls are ignored
+  void watch(std::string const& file_path);
+  // watched files written since the last call
+  std::vector<std::string> poll();
+
+ private:
+  std::set<std::string> m_files;
+#ifdef __linux__
+  // inotify instance, -1 if unavailable
+  int m_inotify;
+  // watch descriptors of the directories containing watched files
+  std::map<int, std::string> m_directories;
+#else
+  // last seen modification time per file
+  std::map<std::string, long long> m_times;
+#endif
+};
+
+#endif
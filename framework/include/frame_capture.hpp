@@ -0,0 +1,68 @@
+#ifndef FRAME_CAPTURE_HPP
+#define FRAME_CAPTURE_HPP
+
+#include "thread_pool.hpp"
+
+#include <glbinding/gl/types.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// records frames to image files without waiting for the gpu
+// pixels are read into a ring of pixel pack buffers, a buffer is mapped once its fence
+// signaled some frames later and the pixels are encoded on a worker thread
+class frame_capture {
+ public:
+  // write frames as directory/frame_00000.format, format is "tga" or "ppm"
+  frame_capture(std::string const& directory, std::string const& format = "tga", std::size_t buffer_count = 3);
+  // write all pending frames
+  ~frame_capture();
+
+  frame_capture(frame_capture const&) = delete;
+  frame_capture& operator=(frame_capture const&) = delete;
+
+  // start readback of the bound read framebuffer, call after rendering and before swapping
+  void capture(gl::GLsizei width, gl::GLsizei height);
+  // hand finished readbacks to the encoder without blocking
+  void poll();
+  // wait for all readbacks and file writes, throws if a file could not be written
+  void flush();
+
+  // frames written to disk so far
+  std::size_t frames_written() const;
+
+ private:
+  struct pack_buffer {
+    gl::GLuint handle;
+    std::size_t size;
+    // signaled when the gpu copied the frame into the buffer
+    gl::GLsync fence;
+    gl::GLsizei width;
+    gl::GLsizei height;
+    unsigned frame;
+  };
+
+  // map buffer, copy pixels and queue encoding, fence must be signaled
+  void finish_readback(pack_buffer& buffer);
+
+  std::string m_directory;
+  std::string m_format;
+  std::vector<pack_buffer> m_buffers;
+  // buffer receiving the next frame
+  std::size_t m_next;
+  unsigned m_frame;
+
+  // encoding state shared with the worker, guarded by m_mutex
+  mutable std::mutex m_mutex;
+  std::condition_variable m_written;
+  std::size_t m_pending_writes;
+  std::size_t m_frames_written;
+  std::string m_error;
+  // declared last, so the worker stops before the state it uses is destroyed
+  thread_pool m_encoder;
+};
+
+#endif
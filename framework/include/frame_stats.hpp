@@ -0,0 +1,76 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+
+#include <string>
+#include <vector>
+
+// frame times of the last frames in a ring, with percentiles and hitch counts over that window
+class frame_stats {
+ public:
+  // statistics of one series in milliseconds
+  struct percentiles {
+    double p50;
+    double p95;
+    double p99;
+    double max;
+  };
+
+  struct summary {
+    // frames in the window
+    std::size_t frames;
+    double fps;
+    // time between the starts of consecutive frames
+    percentiles interval;
+    // cpu time from the start of a frame until its commands were submitted
+    percentiles cpu;
+    // gpu time measured by timer queries, zero without support
+    percentiles gpu;
+    // frames in the window and since the start taking hitch_factor times the median interval
+    std::size_t hitches;
+    std::size_t total_hitches;
+  };
+
+  // keep window frames, frames longer than hitch_factor times the median count as hitch
+  explicit frame_stats(std::size_t window = 512, double hitch_factor = 2.);
+
+  // add frame, call once per frame
+  void add_frame(double interval_ms, double cpu_ms);
+  // add gpu time of a finished frame, results arrive some frames after add_frame
+  void add_gpu(double gpu_ms);
+
+  // statistics over the current window
+  summary compute() const;
+
+  // column names matching csv
+  static std::string csv_header();
+  // one line of comma separated values without newline
+  static std::string csv(summary const& stats);
+  // one json object without newline
+  static std::string json(summary const& stats);
+  // nearest rank percentile of sorted values, 0 if there are none
+  static double nearest_rank(std::vector<double> const& sorted, double fraction);
+
+ private:
+  struct ring {
+    std::vector<double> values;
+    // slot receiving the next value
+    std::size_t next;
+    std::size_t count;
+  };
+
+  static void push(ring& series, double value);
+  static percentiles evaluate(ring const& series);
+
+  ring m_interval;
+  ring m_cpu;
+  ring m_gpu;
+  // hitch flags of the frames in m_interval
+  std::vector<bool> m_hitch;
+  double m_hitch_factor;
+  // median interval, refreshed every few frames instead of sorting per frame
+  double m_median;
+  std::size_t m_frames_since_median;
+  std::size_t m_total_hitches;
+};
+
+#endif
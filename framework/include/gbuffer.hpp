@@ -0,0 +1,35 @@
+#ifndef GBUFFER_HPP
+#define GBUFFER_HPP
+
+#include "structs.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+// framebuffer with surface attributes for deferred lighting
+struct gbuffer_target {
+  GLuint framebuffer = 0;
+  // rgb surface color
+  texture_object albedo;
+  // xyz surface normal
+  texture_object normal;
+  // window space depth
+  texture_object depth;
+  GLsizei width = 0;
+  GLsizei height = 0;
+};
+
+namespace deferred {
+  // create textures and framebuffer of given resolution
+  gbuffer_target create(GLsizei width, GLsizei height);
+  // reallocate textures, keeps handles
+  void resize(gbuffer_target& target, GLsizei width, GLsizei height);
+  // bind albedo, normal and depth to units first_unit to first_unit + 2
+  void bind_textures(gbuffer_target const& target, GLuint first_unit);
+  // free textures and framebuffer
+  void destroy(gbuffer_target& target);
+
+  // distance at which a point light with 1 / d^2 falloff drops below threshold
+  float light_radius(float intensity, glm::fvec3 const& color, float threshold);
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <glbinding/gl/types.h>
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// shadow copy of bindings and uniform values, calls are only issued when a value changes
+// code changing bindings directly must call invalidate afterwards,
+// uniforms set through the cache must not be set directly
+class gl_state {
+ public:
+  // issued and dropped calls
+  struct counters {
+    std::size_t issued;
+    std::size_t skipped;
+  };
+
+  gl_state();
+
+  void use_program(gl::GLuint program);
+  void bind_vertex_array(gl::GLuint vertex_array);
+  void bind_buffer(gl::GLenum target, gl::GLuint buffer);
+  // selects the unit only if the binding changes
+  void bind_texture(unsigned unit, gl::GLenum target, gl::GLuint texture);
+  void bind_sampler(unsigned unit, gl::GLuint sampler);
+
+  // uniforms of the program in use, cached per program and location
+  void uniform(gl::GLint location, int value);
+  void uniform(gl::GLint location, float value);
+  void uniform(gl::GLint location, glm::fvec2 const& value);
+  void uniform(gl::GLint location, glm::fvec3 const& value);
+  void uniform(gl::GLint location, glm::fmat4 const& value);
+
+  // forget all bindings, values are unknown after other code changed them
+  void invalidate();
+  // forget uniform values, programs lose them when they are relinked
+  void invalidate_uniforms();
+
+  // start counting calls of a new frame
+  void begin_frame();
+  // calls of the previous frame
+  counters last_frame() const;
+  // calls since creation
+  counters total() const;
+
+ private:
+  struct uniform_value {
+    float data[16];
+    unsigned size;
+  };
+
+  // true if value differs from the cached one, stores it
+  bool change_uniform(gl::GLint location, float const* data, unsigned size);
+  // count a call, returns changed
+  bool count(bool changed);
+
+  gl::GLuint m_program;
+  gl::GLuint m_vertex_array;
+  std::map<gl::GLenum, gl::GLuint> m_buffers;
+  unsigned m_active_unit;
+  // bound texture per target of every unit
+  std::vector<std::map<gl::GLenum, gl::GLuint>> m_textures;
+  std::vector<gl::GLuint> m_samplers;
+  // key combines program and location
+  std::unordered_map<std::uint64_t, uniform_value> m_uniforms;
+
+  counters m_frame;
+  counters m_last_frame;
+  counters m_total;
+};
+
+#endif
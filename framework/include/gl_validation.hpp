@@ -0,0 +1,34 @@
+#ifndef GL_VALIDATION_HPP
+#define GL_VALIDATION_HPP
+
+#include <string>
+
+// how thoroughly gl calls are checked for errors, each level includes the ones before
+namespace gl_validation {
+  enum class level {
+    // no checks and no debug output
+    off,
+    // driver reports problems through the asynchronous debug callback
+    debug,
+    // additionally glGetError once per frame
+    frame,
+    // glGetError after every call, throws with the failing call and its parameters
+    call
+  };
+
+  // level from its name, throws invalid_argument for unknown names
+  level parse(std::string const& name);
+  std::string name(level validation);
+  // call for debug builds, off for release builds
+  level default_level();
+  // true if the context needs the debug flag for this level
+  bool needs_debug_context(level validation);
+
+  // install checks in the current context
+  void set_level(level validation);
+  level current_level();
+  // report all errors raised since the last check, does nothing below level frame
+  void check_frame(unsigned frame);
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef GPU_CULLING_HPP
+#define GPU_CULLING_HPP
+
+#include "structs.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <vector>
+
+// per object data mirrored in shader storage buffer, std430 layout
+// uploaded once, transforms change every frame and live in their own buffer
+struct culling_object_data {
+  // rgb color, w is free for material data like a texture layer
+  glm::fvec4 color;
+  // xyz: bounding sphere center in model space, w: radius
+  glm::fvec4 bounds;
+};
+
+// range of shared index buffer used by one level of detail
+struct lod_level {
+  GLuint first_index;
+  GLuint num_elements;
+  // used while camera distance / object radius is below this value
+  float max_distance;
+  float padding;
+};
+
+// gpu buffers for culling and indirect drawing of one mesh
+struct indirect_batch {
+  // shader storage buffer with culling_object_data
+  GLuint object_BO = 0;
+  // shader storage buffer with one world transform per object
+  GLuint transform_BO = 0;
+  // DrawElementsIndirectCommand per object, written by compute pass
+  GLuint command_BO = 0;
+  // instanced vertex attribute holding the object index
+  GLuint id_BO = 0;
+  // shader storage buffer with lod_level entries
+  GLuint lod_BO = 0;
+  // number of lod levels in lod_BO
+  GLuint num_lods = 0;
+  // maximal number of objects
+  GLsizei capacity = 0;
+  // copy of transform_BO, only changed transforms are uploaded
+  std::vector<glm::fmat4> transforms{};
+};
+
+namespace gpu_culling {
+  // location of the per instance object index attribute
+  const GLuint OBJECT_ID_LOCATION = 3;
+
+  // check if context supports compute shaders and multi draw indirect
+  bool supported();
+  // create buffers for given mesh, attaches object index attribute to mesh VAO
+  indirect_batch create(model_object const& mesh, std::vector<lod_level> const& lods, GLsizei capacity);
+  // replace lod ranges
+  void update_lods(indirect_batch& batch, std::vector<lod_level> const& lods);
+  // level cull.comp picks at camera distance / object radius, for drawing without the compute pass
+  std::size_t select_lod(std::vector<lod_level> const& lods, float relative_distance);
+  // upload colors and bounds of the objects
+  void update(indirect_batch const& batch, std::vector<culling_object_data> const& objects);
+  // upload the range of transforms which differs from the last call
+  void update_transforms(indirect_batch& batch, std::vector<glm::fmat4> const& transforms);
+  // frustum cull first objects and write draw commands, cull program must be bound
+  // its locations of frustum_planes, camera_position, num_objects and num_lods are used
+  void cull(indirect_batch const& batch, GLsizei num_objects, shader_program const& cull_program, glm::fmat4 const& view_projection, glm::fvec3 const& camera_position);
+  // draw commands of first objects with one call, draw program must be bound
+  void draw(indirect_batch const& batch, GLsizei num_objects, model_object const& mesh);
+  // free buffers
+  void destroy(indirect_batch& batch);
+
+  // extract normalized frustum planes from view projection matrix
+  std::vector<glm::fvec4> frustum_planes(glm::fmat4 const& view_projection);
+}
+
+#endif
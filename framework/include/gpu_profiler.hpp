@@ -0,0 +1,104 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+
+#include <glbinding/gl/types.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// measures gpu time of named passes with timestamp queries
+// queries of a frame are read back frame_latency frames later, so reading never stalls
+class gpu_profiler {
+ public:
+  // accumulated time of one pass, nested passes are named parent/child
+  struct pass_timing {
+    std::string name;
+    unsigned depth;
+    double last_ms;
+    double average_ms;
+    double max_ms;
+    std::size_t samples;
+  };
+
+  // times a pass from construction to destruction
+  class scope {
+   public:
+    scope(gpu_profiler& profiler, std::string const& name);
+    ~scope();
+
+    scope(scope const&) = delete;
+    scope& operator=(scope const&) = delete;
+
+   private:
+    gpu_profiler& m_profiler;
+  };
+
+  // needs a current context, without timer queries all calls do nothing
+  explicit gpu_profiler(std::size_t frame_latency = 4);
+  // free queries
+  ~gpu_profiler();
+
+  gpu_profiler(gpu_profiler const&) = delete;
+  gpu_profiler& operator=(gpu_profiler const&) = delete;
+
+  // true if timestamp queries are available
+  static bool supported();
+
+  // collect finished frames and open the pass of the whole frame
+  void begin_frame();
+  // close the pass of the whole frame
+  void end_frame();
+  // open pass nested into the currently open one
+  void begin(std::string const& name);
+  // close the innermost open pass
+  void end();
+
+  // all passes measured so far in order of their first appearance
+  std::vector<pass_timing> results() const;
+  // table of results for logging
+  std::string report() const;
+  // json array of results for export
+  std::string json() const;
+  // frames whose queries were not finished when their slot was reused
+  std::size_t dropped_frames() const;
+  // gpu time of every frame collected since the last call, oldest first
+  std::vector<double> take_frame_times();
+
+ private:
+  struct timer {
+    std::string name;
+    unsigned depth;
+    // name of the enclosing pass, empty for the frame
+    std::string parent;
+    // indices into the queries of the frame
+    std::size_t begin_query;
+    std::size_t end_query;
+  };
+
+  struct frame_queries {
+    std::vector<gl::GLuint> queries;
+    std::size_t used;
+    std::vector<timer> timers;
+    bool pending;
+  };
+
+  // issue timestamp into the next free query of the current frame
+  std::size_t timestamp();
+  // add results of frame if its last query is available
+  bool collect(frame_queries& frame);
+  // result entry of timer, new passes are placed after the last one with the same parent
+  pass_timing& result(timer const& t);
+
+  bool m_supported;
+  std::vector<frame_queries> m_frames;
+  std::size_t m_current;
+  // open timers of the current frame
+  std::vector<std::size_t> m_open;
+  std::vector<pass_timing> m_results;
+  std::map<std::string, std::size_t> m_result_index;
+  std::vector<double> m_frame_times;
+  std::size_t m_dropped;
+};
+
+#endif
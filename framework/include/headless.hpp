@@ -0,0 +1,25 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include <glm/gtc/type_precision.hpp>
+
+// gl context without window or display, rendering goes to an offscreen pbuffer
+// uses egl, on machines without gpu mesa's llvmpipe renders on the cpu
+struct headless_context {
+  // egl handles
+  void* display = nullptr;
+  void* surface = nullptr;
+  void* context = nullptr;
+  glm::uvec2 resolution;
+};
+
+namespace headless {
+  // false if the framework was built without egl
+  bool supported();
+  // create context and make it current, throws if no egl display or config is available
+  headless_context initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor, bool debug_context);
+  // free context and quit with status
+  void close_and_quit(headless_context& context, int status);
+}
+
+#endif
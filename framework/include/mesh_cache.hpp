@@ -0,0 +1,135 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include "mesh_simplifier.hpp"
+#include "model.hpp"
+#include "obj_parser.hpp"
+#include "vertex_format.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// binary meshes cooked from obj files, see model_loader::cached_obj
+namespace mesh_cache {
+  // container layout: header, one attribute_entry per attribute, one lod_entry per level of detail, vertex data, indices
+  const char MAGIC[4] = {'C', 'M', 'S', 'H'};
+  const std::uint32_t VERSION = 4;
+
+  // size and modification time of the source, compared before the slower hash
+  struct stamp {
+    std::uint64_t size;
+    // nanoseconds since the epoch, whole seconds on windows
+    std::int64_t time;
+  };
+
+  struct header {
+    char magic[4];
+    std::uint32_t version;
+    // source_hash and stamp of the obj file
+    std::uint64_t source_hash;
+    stamp source;
+    // attributes requested from the loader and attributes contained in the vertices
+    std::uint32_t import_attribs;
+    std::uint32_t attributes;
+    std::uint32_t vertex_bytes;
+    std::uint32_t num_attributes;
+    std::uint32_t num_lods;
+    std::uint32_t padding;
+    std::uint64_t vertex_num;
+    std::uint64_t index_num;
+    // gl enum of the indices and whether vertex_format::quantize encoded the vertices
+    std::uint32_t index_type;
+    std::uint32_t quantized;
+    // byte offsets from file start, 16 byte aligned
+    std::uint64_t vertex_offset;
+    std::uint64_t index_offset;
+    // axis aligned bounds of the positions and texture coordinates
+    float position_min[3];
+    float position_max[3];
+    float texcoord_min[2];
+    float texcoord_max[2];
+  };
+
+  // model::attribute of the vertex layout
+  struct attribute_entry {
+    std::uint32_t flag;
+    std::uint32_t offset;
+    std::uint32_t size;
+    std::uint32_t components;
+    std::uint32_t type;
+    std::uint32_t normalized;
+  };
+
+  // mesh_simplifier::level
+  struct lod_entry {
+    std::uint64_t first_index;
+    std::uint64_t num_indices;
+    float error;
+    std::uint32_t padding;
+  };
+
+  // vertices and indices ready for upload, either in a mapped file or in memory
+  class mesh {
+   public:
+    // map cooked file, throws if it is no cooked mesh of this version
+    explicit mesh(std::string const& file_name);
+    // keep the packed mesh, used where no cooked file can be written
+    mesh(packed_mesh&& source, std::uint64_t source_hash, stamp const& source_stamp, model::attrib_flag_t import_attribs);
+
+    mesh(mesh const&) = delete;
+    mesh& operator=(mesh const&) = delete;
+
+    // vertex data of vertex_data_size() bytes
+    void const* vertex_data() const;
+    std::size_t vertex_data_size() const;
+    // indices of index_type
+    void const* index_data() const;
+    std::size_t index_data_size() const;
+    std::size_t num_indices() const;
+    GLenum index_type() const;
+    std::size_t vertex_num() const;
+    // encoding and offset of each attribute
+    std::vector<model::attribute> const& layout() const;
+    // index ranges of the levels of detail, finest first
+    std::vector<mesh_simplifier::level> const& lods() const;
+    model::attrib_flag_t attributes() const;
+    GLsizei vertex_bytes() const;
+    bool quantized() const;
+
+    glm::fvec3 position_min() const;
+    glm::fvec3 position_max() const;
+    glm::fvec2 texcoord_min() const;
+    glm::fvec2 texcoord_max() const;
+    std::uint64_t source_hash() const;
+    stamp source_stamp() const;
+    model::attrib_flag_t import_attribs() const;
+
+   private:
+    // only one of them holds the data
+    std::unique_ptr<obj_parser::mapped_file> m_file;
+    packed_mesh m_packed;
+
+    header m_header;
+    void const* m_vertices;
+    void const* m_indices;
+    std::vector<model::attribute> m_layout;
+    std::vector<mesh_simplifier::level> m_lods;
+  };
+
+  // utils::hash of the file bytes
+  std::uint64_t source_hash(char const* begin, char const* end);
+  // stamp of a file, zero if it does not exist
+  stamp source_stamp(std::string const& file_name);
+  bool operator==(stamp const& a, stamp const& b);
+
+  // write container for a mesh packed from a source with the given hash and stamp
+  void write(packed_mesh const& source, std::uint64_t source_hash, stamp const& source_stamp, model::attrib_flag_t import_attribs, std::string const& file_name);
+  // replace the stamp of a container whose source was touched without changing its hash
+  void restamp(std::string const& file_name, stamp const& source_stamp);
+}
+
+#endif
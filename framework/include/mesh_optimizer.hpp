@@ -0,0 +1,57 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include "model.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// reorders indexed triangle meshes for the gpu, see model_loader::cached_obj
+namespace mesh_optimizer {
+  // post transform cache efficiency of an index buffer, simulated with a fifo cache
+  struct cache_stats {
+    // cache misses per triangle, between 0.5 and 3
+    float acmr;
+    // cache misses per referenced vertex, 1 is optimal
+    float atvr;
+  };
+
+  struct options {
+    options()
+     :cache_size{16}
+     ,overdraw_threshold{1.05f}
+     ,weld{true}
+    {}
+
+    // simulated fifo entries
+    std::size_t cache_size;
+    // allowed acmr increase for splitting the mesh into clusters sorted against overdraw
+    float overdraw_threshold;
+    // merge vertices with identical bytes
+    bool weld;
+  };
+
+  struct report {
+    cache_stats before;
+    cache_stats after;
+    std::size_t welded_vertices;
+    std::size_t clusters;
+  };
+
+  cache_stats analyze(std::vector<GLuint> const& indices, std::size_t vertex_num, std::size_t cache_size);
+
+  // merge bitwise equal vertices, returns number of removed vertices
+  std::size_t weld(model& mesh);
+  // tipsify triangle order for the post transform cache (Sander et al. 2007)
+  void optimize_cache(std::vector<GLuint>& indices, std::size_t vertex_num, std::size_t cache_size);
+  // split into clusters whose acmr stays within threshold of the cache order, and draw outward facing clusters first
+  // returns the number of clusters
+  std::size_t optimize_overdraw(model& mesh, std::size_t cache_size, float threshold);
+  // store vertices in order of first use, unreferenced ones are dropped
+  void optimize_fetch(model& mesh);
+
+  // all of the above in order, with the cache efficiency before and after
+  report optimize(model& mesh, options const& opts = options{});
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include "model.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// quadric error edge collapses for levels of detail, see model_loader::cached_obj
+namespace mesh_simplifier {
+  struct options {
+    options()
+     :ratio{0.5f}
+     ,min_triangles{64}
+     ,max_levels{6}
+     ,max_error{0.05f}
+     ,lock_border{false}
+    {}
+
+    // triangles of each level relative to the level before
+    float ratio;
+    // no level is simplified below this triangle count
+    std::size_t min_triangles;
+    // levels including the full mesh
+    std::size_t max_levels;
+    // largest deviation of the last level from the full mesh, relative to the mesh extent
+    float max_error;
+    // keep open boundaries in place instead of letting vertices slide along them
+    bool lock_border;
+  };
+
+  // index range of one level in lod_chain::indices
+  struct level {
+    std::size_t first_index;
+    std::size_t num_indices;
+    // deviation from the full mesh in model units, 0 for the full mesh
+    float error;
+  };
+
+  // levels share the vertices of the mesh, finest level first
+  struct lod_chain {
+    std::vector<GLuint> indices;
+    std::vector<level> levels;
+  };
+
+  // collapse edges until at most target_triangles remain or the next collapse would move the surface by more
+  // than target_error, relative to the mesh extent. vertices are not changed, only indices of the remaining ones returned.
+  // uv seams and other attribute discontinuities only collapse along themselves, open boundaries slide along themselves
+  std::vector<GLuint> simplify(model const& mesh, std::vector<GLuint> const& indices, std::size_t target_triangles,
+                               float target_error, float* result_error = nullptr, bool lock_border = false);
+
+  // simplify each level from the one before until one of the limits in opts is reached,
+  // every level is reordered for the vertex cache
+  lod_chain build_chain(model const& mesh, options const& opts = options{});
+}
+
+#endif
@@ -16,11 +16,13 @@ struct model {
   // type holding info about a vertex/model attribute
   struct attribute {
 
-    attribute(attrib_flag_t f, GLsizei s, GLsizei c, GLenum t)
+    attribute(attrib_flag_t f, GLsizei s, GLsizei c, GLenum t, bool n = false)
      :flag{f}
      ,size{s}
      ,components{c}
      ,type{t}
+     ,normalized{n}
+     ,offset{nullptr}
     {}
 
     // conversion to flag type for use as enum
@@ -36,6 +38,8 @@ struct model {
     GLint components;
     // Gl type
     GLenum type;
+    // integer components are mapped to [0, 1] or [-1, 1]
+    bool normalized;
     // offset from element beginning
     GLvoid* offset;
   };
@@ -50,6 +54,15 @@ struct model {
   static attribute const& BITANGENT;
   // is not a vertex attribute, so not stored in VERTEX_ATTRIBS
   static attribute const  INDEX;
+  // quantized encodings with the same flags, see vertex_format::quantize
+  // position normalized to the mesh bounds
+  static attribute const  POSITION_UNORM16;
+  // octahedral projection of the unit normal
+  static attribute const  NORMAL_OCT16;
+  // texture coordinates normalized to their bounds
+  static attribute const  TEXCOORD_UNORM16;
+  // for meshes with less than 65536 vertices
+  static attribute const  INDEX_SHORT;
   
   model();
   model(std::vector<GLfloat> const& databuff, attrib_flag_t attribs, std::vector<GLuint> const& trianglebuff = std::vector<GLuint>{});
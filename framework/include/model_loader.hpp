@@ -2,12 +2,27 @@
 #define MODEL_LOADER_HPP
 
 #include "model.hpp"
+#include "mesh_cache.hpp"
+#include "thread_pool.hpp"
 
 #include "tiny_obj_loader.h"
 
+#include <memory>
+
 namespace model_loader {
 
-model obj(std::string const& path, model::attrib_flag_t import_attribs = model::POSITION | model::NORMAL | model::TEXCOORD);
+// memory mapped file parsed in parallel on the pool by obj_parser
+model obj(std::string const& path, thread_pool& pool, model::attrib_flag_t import_attribs = model::POSITION | model::NORMAL | model::TEXCOORD);
+// same through the bundled tinyobjloader, slower but kept for comparison
+model obj_tinyobj(std::string const& path, model::attrib_flag_t import_attribs = model::POSITION | model::NORMAL | model::TEXCOORD);
+// same through a cooked binary next to the obj, written on first load and whenever the obj content changed
+// cooking welds and reorders the mesh with mesh_optimizer and prints the cache efficiency before and after,
+// then appends the levels of detail of mesh_simplifier::build_chain to the indices
+// quantized meshes are encoded by vertex_format::quantize, otherwise vertices stay floats
+// the result keeps the cooked file mapped, or the packed mesh where the binary could not be written
+std::unique_ptr<mesh_cache::mesh> cached_obj(std::string const& path, thread_pool& pool, model::attrib_flag_t import_attribs = model::POSITION | model::NORMAL | model::TEXCOORD, bool quantize = false);
+// name of the cooked binary of an obj file
+std::string cooked_path(std::string const& path);
 
 }
 
@@ -0,0 +1,70 @@
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <utility>
+
+// unbounded lock-free queue, many threads may push, one thread pops
+template<typename T>
+class mpsc_queue {
+ public:
+  mpsc_queue()
+   :m_head{new node{}}
+   ,m_tail{m_head.load()}
+  {}
+  // free remaining elements
+  ~mpsc_queue() {
+    T value;
+    while (pop(value)) {}
+    delete m_tail;
+  }
+
+  mpsc_queue(mpsc_queue const&) = delete;
+  mpsc_queue& operator=(mpsc_queue const&) = delete;
+
+  // callable from any thread
+  void push(T value) {
+    node* element = new node{};
+    element->value = std::move(value);
+    // link after the previous head, consumer sees element once next is stored
+    node* previous = m_head.exchange(element, std::memory_order_acq_rel);
+    previous->next.store(element, std::memory_order_release);
+  }
+
+  // consumer thread only, false if empty or the newest push is not linked yet
+  bool pop(T& value) {
+    node* tail = m_tail;
+    node* next = tail->next.load(std::memory_order_acquire);
+    if (!next) {
+      return false;
+    }
+    // next becomes the new empty front node
+    value = std::move(next->value);
+    m_tail = next;
+    delete tail;
+    return true;
+  }
+
+  // consumer thread only
+  bool empty() const {
+    return m_tail->next.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  struct node {
+    node()
+     :next{nullptr}
+     ,value{}
+    {}
+
+    std::atomic<node*> next;
+    T value;
+  };
+
+  // last pushed node, shared by producers
+  std::atomic<node*> m_head;
+  // already consumed front node, owned by consumer
+  node* m_tail;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef OBJ_PARSER_HPP
+#define OBJ_PARSER_HPP
+
+#include "model.hpp"
+#include "thread_pool.hpp"
+
+#include <string>
+#include <vector>
+
+namespace obj_parser {
+  // file mapped read only into memory, read into a buffer where mapping is unavailable
+  class mapped_file {
+   public:
+    // throws if the file cannot be opened
+    explicit mapped_file(std::string const& path);
+    ~mapped_file();
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    char const* begin() const;
+    char const* end() const;
+
+   private:
+    char const* m_data;
+    std::size_t m_size;
+    // fallback storage
+    std::vector<char> m_buffer;
+    bool m_mapped;
+  };
+
+  // parse obj text on the pool and the calling thread
+  // the text is split into line aligned chunks parsed in parallel, vertices are written interleaved
+  // polygons become triangle fans, corners with equal indices share a vertex within an object or group
+  // like tinyobjloader, missing normals are generated and missing texcoords are dropped from the attributes
+  model parse(char const* begin, char const* end, model::attrib_flag_t import_attribs, thread_pool& pool);
+  // map and parse file
+  model load(std::string const& path, model::attrib_flag_t import_attribs, thread_pool& pool);
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef OCCLUSION_CULLER_HPP
+#define OCCLUSION_CULLER_HPP
+
+#include "thread_pool.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <vector>
+
+// software depth buffer of a few large occluders, rasterized on worker threads
+// bounding spheres are tested against a max depth pyramid of it
+// results only depend on the submitted occluders, never on thread timing
+class occlusion_culler {
+ public:
+  // resolution of the depth buffer, width must be a multiple of 4
+  occlusion_culler(thread_pool& workers, std::size_t width = 256, std::size_t height = 128);
+
+  occlusion_culler(occlusion_culler const&) = delete;
+  occlusion_culler& operator=(occlusion_culler const&) = delete;
+
+  // clear depth buffer and occluders, view_projection maps world to clip space
+  void begin(glm::fmat4 const& view_projection);
+  // add counter clockwise triangle list, three vertices per triangle
+  // vertices must lie inside the occluding object, otherwise visible objects get culled
+  void add_occluder(glm::fmat4 const& model_matrix, std::vector<glm::fvec3> const& triangles);
+  // rasterize all occluders and build the depth pyramid
+  void finish();
+  // false if sphere lies completely behind the occluders
+  bool visible(glm::fvec3 const& center, float radius) const;
+
+  // triangles rasterized by the last finish
+  std::size_t num_triangles() const;
+  // depth buffer, row major from the bottom left, 1 is the far plane
+  std::vector<float> const& depth() const;
+
+  // triangle list of a sphere with given tessellation inscribed into the unit sphere
+  static std::vector<glm::fvec3> inscribed_sphere(unsigned rings, unsigned segments);
+
+ private:
+  // triangle in pixel coordinates with window depth
+  struct screen_triangle {
+    glm::fvec3 v[3];
+    // first and last pixel row touched
+    int min_y;
+    int max_y;
+  };
+
+  // rasterize all triangles overlapping rows [first_row, last_row)
+  void rasterize_band(int first_row, int last_row);
+  void build_pyramid();
+
+  thread_pool& m_workers;
+  int m_width;
+  int m_height;
+  glm::fmat4 m_view_projection;
+  std::vector<screen_triangle> m_triangles;
+  // level 0 is the depth buffer, each texel of level i + 1 holds the max of 2x2 texels of level i
+  std::vector<std::vector<float>> m_levels;
+  std::vector<glm::ivec2> m_level_sizes;
+};
+
+#endif
@@ -44,4 +44,46 @@ struct pixel_data {
   GLenum channel_type; 
 };
 
+// one level of a mip chain, raw pixels or compressed blocks
+struct texture_level {
+  texture_level()
+   :width{0}
+   ,height{0}
+   ,bytes()
+  {}
+
+  texture_level(std::size_t w, std::size_t h, std::vector<std::uint8_t> dat)
+   :width{w}
+   ,height{h}
+   ,bytes(dat)
+  {}
+
+  std::size_t width;
+  std::size_t height;
+  std::vector<std::uint8_t> bytes;
+};
+
+// texture with precomputed mip chain in its final gpu format
+struct cooked_texture {
+  cooked_texture()
+   :levels()
+   ,internal_format{GL_NONE}
+   ,channels{GL_NONE}
+   ,channel_type{GL_NONE}
+   ,compressed{false}
+  {}
+
+  // level 0 is full resolution
+  std::vector<texture_level> levels;
+
+  // sized or compressed format
+  GLenum internal_format;
+  // channel format of uncompressed levels
+  GLenum channels;
+  // pixel format of uncompressed levels
+  GLenum channel_type;
+  // levels contain compressed blocks
+  bool compressed;
+};
+
 #endif
\ No newline at end of file
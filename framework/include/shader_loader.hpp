@@ -3,15 +3,29 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <glbinding/gl/enum.h>
 using namespace gl;
 
 namespace shader_loader {
-  // compile shader
-  unsigned shader(std::string const& file_path, GLenum shader_type);
-  // create program from given list of stages
-  unsigned program(std::map<GLenum, std::string> const&);
+  // compile shader, #include "file" directives are expanded relative to the including file
+  // defines are inserted after the version directive
+  unsigned shader(std::string const& file_path, GLenum shader_type, std::vector<std::string> const& defines = std::vector<std::string>{});
+  // create program from given list of stages, linked binaries are cached if a cache directory is set
+  unsigned program(std::map<GLenum, std::string> const&, std::vector<std::string> const& defines = std::vector<std::string>{});
+  // read shader source and its includes ahead of compilation, thread safe
+  // sources stay cached until refreshed or invalidated
+  void preload(std::string const& file_path);
+  // files the source was expanded from by its last compilation, starting with itself
+  std::vector<std::string> dependencies(std::string const& file_path);
+  // reread all cached files, returns those whose content changed
+  std::vector<std::string> refresh();
+  // drop cached content, next compilation reads the file again
+  void invalidate(std::string const& file_path);
+  // store program binaries in directory, keyed by sources, defines and driver
+  // an empty directory disables the cache
+  void set_cache_directory(std::string const& directory);
 }
 
 #endif
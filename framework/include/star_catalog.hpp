@@ -0,0 +1,69 @@
+#ifndef STAR_CATALOG_HPP
+#define STAR_CATALOG_HPP
+
+#include <glbinding/gl/types.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include "thread_pool.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// star as read from a catalog
+struct catalog_star {
+  glm::fvec3 position;
+  // apparent magnitude, smaller is brighter
+  float magnitude;
+  glm::fvec3 color;
+};
+
+// gpu representation of a star, 8 bytes
+struct packed_star {
+  // position normalized to the bounds of its chunk
+  std::uint16_t position[3];
+  // rgb565
+  std::uint16_t color;
+};
+
+// range of spatially close stars, ordered from bright to faint
+struct star_chunk {
+  // bounds used to dequantize positions
+  glm::fvec3 min;
+  glm::fvec3 extent;
+  // offset of first star in starfield::stars
+  GLint first;
+  // number of stars brighter than the upper end of each magnitude bin
+  std::array<GLsizei, 16> counts;
+};
+
+// stars packed for drawing chunk by chunk
+struct starfield {
+  std::vector<packed_star> stars;
+  std::vector<star_chunk> chunks;
+  // magnitude bins of star_chunk::counts
+  float min_magnitude;
+  float magnitude_step;
+};
+
+namespace star_catalog {
+  // parse csv catalog with header naming x, y, z and mag columns, a ci column holds the b-v color index
+  // positions are scaled, stars farther than max_distance and the sun itself are skipped, lines are parsed on the pool
+  std::vector<catalog_star> parse(std::string const& file_path, float scale, float max_distance, thread_pool& pool);
+  // random stars inside a cube with given half size
+  std::vector<catalog_star> generate(std::size_t count, float half_size, unsigned seed);
+  // split into chunks of at most chunk_size stars and quantize
+  starfield build(std::vector<catalog_star> stars, std::size_t chunk_size);
+  // stars of chunk not fainter than magnitude, they form a prefix of the chunk
+  GLsizei visible_count(starfield const& field, star_chunk const& chunk, float max_magnitude);
+  // true if chunk bounds intersect the volume of the frustum planes
+  bool in_frustum(std::vector<glm::fvec4> const& planes, star_chunk const& chunk);
+  // approximate rgb of a black body with given b-v color index
+  glm::fvec3 color_index_to_rgb(float bv);
+}
+
+#endif
@@ -2,6 +2,8 @@
 #define STRUCTS_HPP
 
 #include <map>
+#include <string>
+#include <vector>
 #include <glbinding/gl/gl.h>
 // use gl definitions from glbinding 
 using namespace gl;
@@ -18,6 +20,8 @@ struct model_object {
   GLenum draw_mode = GL_NONE;
   // indices number, if EBO exists
   GLsizei num_elements = 0;
+  // type of the indices in the EBO
+  GLenum index_type = GL_UNSIGNED_INT;
 };
 
 // gpu representation of texture
@@ -30,13 +34,16 @@ struct texture_object {
 
 // shader handle and uniform storage
 struct shader_program {
-  shader_program(std::map<GLenum, std::string> paths)
+  shader_program(std::map<GLenum, std::string> paths, std::vector<std::string> defs = std::vector<std::string>{})
    :shader_paths{paths}
+   ,defines{defs}
    ,handle{0}
    {}
 
   // paths to shader sources
   std::map<GLenum, std::string> shader_paths;
+  // preprocessor definitions inserted into all stages
+  std::vector<std::string> defines;
   // object handle
   GLuint handle;
   // uniform locations mapped to name
@@ -0,0 +1,23 @@
+#ifndef TEXTURE_ARRAY_HPP
+#define TEXTURE_ARRAY_HPP
+
+#include "pixel_data.hpp"
+#include "structs.hpp"
+
+#include <vector>
+
+namespace texture_array {
+  // scale 8 bit image to given resolution with bilinear filtering
+  pixel_data resize(pixel_data const& image, std::size_t width, std::size_t height);
+  // convert 8 bit image to given channel format, missing alpha is opaque
+  pixel_data convert(pixel_data const& image, GLenum channels);
+  // layers for one GL_TEXTURE_2D_ARRAY, layer i holds image i
+  // layers are resized to the most common resolution and converted to a shared format
+  // missing images become white, no gl calls, resolution is clamped to max_size
+  std::vector<pixel_data> prepare(std::vector<pixel_data> const& images, std::size_t max_size);
+  // allocate all levels of format for given number of layers without uploading data
+  // used to stream contents later, levels of format only need their resolution
+  texture_object allocate(cooked_texture const& format, std::size_t num_layers);
+}
+
+#endif
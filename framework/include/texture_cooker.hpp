@@ -0,0 +1,66 @@
+#ifndef TEXTURE_COOKER_HPP
+#define TEXTURE_COOKER_HPP
+
+#include "pixel_data.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// offline conversion of images into cooked textures, see texture_loader::cooked
+namespace texture_cooker {
+  // container layout: header, one level_entry per level, level payloads
+  const char MAGIC[4] = {'C', 'T', 'E', 'X'};
+  const std::uint32_t VERSION = 1;
+
+  struct header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t num_levels;
+    // gl enums of cooked_texture
+    std::uint32_t internal_format;
+    std::uint32_t channels;
+    std::uint32_t channel_type;
+    std::uint32_t compressed;
+    std::uint32_t reserved;
+  };
+
+  struct level_entry {
+    std::uint32_t width;
+    std::uint32_t height;
+    // byte offset from file start
+    std::uint64_t offset;
+    std::uint64_t size;
+  };
+
+  // filter used for mip level reduction
+  enum class mip_filter { box, kaiser };
+  // block compression of the payload
+  enum class block_format { none, bc1, bc3, bc7 };
+
+  struct options {
+    options()
+     :filter{mip_filter::box}
+     ,compression{block_format::none}
+     ,srgb{false}
+    {}
+
+    mip_filter filter;
+    block_format compression;
+    // color channels are srgb encoded, filtering happens in linear space
+    bool srgb;
+  };
+
+  // halve resolution of 8 bit image
+  pixel_data downsample(pixel_data const& level, mip_filter filter, bool srgb);
+  // given image followed by all reduced levels down to 1x1
+  std::vector<pixel_data> mip_chain(pixel_data const& image, mip_filter filter, bool srgb);
+  // compress rgba image into 4x4 blocks
+  std::vector<std::uint8_t> compress(pixel_data const& level, block_format format);
+  // create mip chain and payload in final format
+  cooked_texture cook(pixel_data const& image, options const& opts);
+  // write cooked texture container
+  void write(cooked_texture const& texture, std::string const& file_name);
+}
+
+#endif
@@ -6,7 +6,10 @@
 #include <string>
 
 namespace texture_loader {
+  // decode image file in its own channel format
   pixel_data file(std::string const& file_name);
+  // read texture container written by texture_cooker::write
+  cooked_texture cooked(std::string const& file_name);
 }
 
 #endif
\ No newline at end of file
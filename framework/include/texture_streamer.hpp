@@ -0,0 +1,80 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include "pixel_data.hpp"
+#include "structs.hpp"
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+// uploads texture data through a pool of pixel unpack buffers, spread over frames
+class texture_streamer {
+ public:
+  // pool of buffer_count staging buffers, at most frame_budget bytes are staged per update
+  texture_streamer(std::size_t buffer_count = 4, std::size_t buffer_bytes = 1 << 22, std::size_t frame_budget = 1 << 23);
+  // free staging buffers
+  ~texture_streamer();
+
+  texture_streamer(texture_streamer const&) = delete;
+  texture_streamer& operator=(texture_streamer const&) = delete;
+
+  // queue upload of 8 bit image into level of texture, layer is ignored for 2d textures
+  // storage must already be allocated, on_complete runs after the last tile was issued
+  void enqueue(texture_object const& texture, GLint level, GLint layer, pixel_data image,
+               std::function<void()> on_complete = std::function<void()>{});
+  // queue upload of block compressed level
+  void enqueue(texture_object const& texture, GLint level, GLint layer, GLenum internal_format, texture_level data,
+               std::function<void()> on_complete = std::function<void()>{});
+
+  // stage and issue tiles within the frame budget, call once per frame
+  void update();
+  // issue all queued uploads now
+  void flush();
+
+  // true if nothing is queued
+  bool idle() const;
+  // bytes waiting to be staged
+  std::size_t pending_bytes() const;
+
+ private:
+  struct request {
+    texture_object texture;
+    GLint level;
+    GLint layer;
+    std::size_t width;
+    std::size_t height;
+    // pixel data of uncompressed requests
+    GLenum channels;
+    GLenum channel_type;
+    // block format of compressed requests
+    GLenum internal_format;
+    bool compressed;
+    std::vector<std::uint8_t> bytes;
+    // bytes of one row of texels or blocks
+    std::size_t row_bytes;
+    // texel rows covered by one row_bytes
+    std::size_t row_height;
+    // first texel row not yet issued
+    std::size_t next_row;
+    std::function<void()> on_complete;
+  };
+
+  struct staging_buffer {
+    GLuint handle;
+    std::size_t size;
+    // signaled when the gpu finished reading the buffer
+    GLsync fence;
+  };
+
+  // returns free staging buffer of at least given size or nullptr
+  staging_buffer* acquire(std::size_t bytes);
+  // stage and issue next tile of front request, returns staged bytes
+  std::size_t upload_tile(staging_buffer& buffer, request& req);
+
+  std::vector<staging_buffer> m_buffers;
+  std::deque<request> m_requests;
+  std::size_t m_frame_budget;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads executing submitted tasks in order of submission
+class thread_pool {
+ public:
+  // one worker per hardware thread if num_threads is 0
+  explicit thread_pool(std::size_t num_threads = 0);
+  // finish queued tasks and join workers
+  ~thread_pool();
+
+  thread_pool(thread_pool const&) = delete;
+  thread_pool& operator=(thread_pool const&) = delete;
+
+  // queue task for execution on a worker, tasks must not throw
+  void submit(std::function<void()> task);
+  // number of workers
+  std::size_t size() const;
+  // run task for every index in [0, num_tasks) on the workers and the calling thread and wait for all
+  // the caller works on indices instead of blocking, so tasks may call this too. errors are rethrown here
+  void parallel_for(std::size_t num_tasks, std::function<void(std::size_t)> const& task);
+
+ private:
+  void work();
+
+  std::vector<std::thread> m_threads;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stop;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef TRAIL_BUFFER_HPP
+#define TRAIL_BUFFER_HPP
+
+#include "structs.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <vector>
+
+// motion trails of many objects in one gpu ring buffer
+// samples are stored slot major, sample slot of trail t lies at slot * num_trails + t
+// so the newest sample of all trails is one contiguous range
+struct trail_buffer {
+  // samples followed by one color per trail, fetched as rgba32f texels
+  GLuint buffer = 0;
+  // buffer texture view of buffer
+  texture_object texture;
+  // empty vertex array, positions are fetched in the vertex shader
+  GLuint vertex_AO = 0;
+  GLsizei num_trails = 0;
+  // samples per trail
+  GLsizei length = 0;
+  // slot of the newest sample
+  GLsizei head = 0;
+  // number of written samples, at most length
+  GLsizei filled = 0;
+};
+
+namespace trails {
+  // allocate length samples for every color, colors are uploaded once
+  trail_buffer create(std::vector<glm::fvec4> const& colors, GLsizei length);
+  // write the newest position of all trails into the next slot with one sub range update
+  void push(trail_buffer& trails, std::vector<glm::fvec4> const& positions);
+  // one line strip per trail with one instanced call, trail program must be bound
+  // its locations of trail_samples, trail_head, trail_length and num_trails are used
+  // the buffer texture is bound to given unit
+  void draw(trail_buffer const& trails, shader_program const& trail_program, GLuint texture_unit);
+  // forget all samples, e.g. after objects jumped
+  void clear(trail_buffer& trails);
+  // free buffer, texture and vertex array
+  void destroy(trail_buffer& trails);
+}
+
+#endif
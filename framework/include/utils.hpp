@@ -7,7 +7,9 @@ using namespace gl;
 
 #include <glm/gtc/type_precision.hpp>
 
+#include <cstdint>
 #include <map>
+#include <string>
 #include <vector>
 
 struct pixel_data;
@@ -30,6 +32,18 @@ namespace utils {
 
   // read file and write content to string
   std::string read_file(std::string const& name);
+  // unique name next to path, caches are written there and moved onto path with replace_file
+  std::string temporary_path(std::string const& path);
+  // move a completely written temporary onto path, readers see the old or the new file but never a partial one
+  // the temporary is removed if this fails
+  bool replace_file(std::string const& temporary, std::string const& path);
+
+  // text as quoted json string, control characters become spaces
+  std::string json_string(std::string const& text);
+
+  // 64 bit fnv-1a hash of bytes, continues from given hash
+  std::uint64_t hash(void const* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull);
+  std::uint64_t hash(std::string const& data, std::uint64_t hash = 14695981039346656037ull);
 
   // return path to resources depending on cmdline args
   std::string read_resource_path(int argc, char* argv[]);
@@ -0,0 +1,46 @@
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#include "mesh_simplifier.hpp"
+#include "model.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// vertex and index bytes in the layout uploaded to the gpu
+struct packed_mesh {
+  packed_mesh();
+
+  std::vector<std::uint8_t> vertices;
+  std::vector<std::uint8_t> indices;
+  // encoding of each attribute, offset is relative to the vertex start
+  std::vector<model::attribute> layout;
+  GLsizei vertex_bytes;
+  std::size_t vertex_num;
+  std::size_t index_num;
+  GLenum index_type;
+  bool quantized;
+  // bounds used to dequantize positions and texture coordinates
+  glm::fvec3 position_min;
+  glm::fvec3 position_max;
+  glm::fvec2 texcoord_min;
+  glm::fvec2 texcoord_max;
+  // index ranges of the levels of detail, finest first, pack and quantize put all indices into one
+  std::vector<mesh_simplifier::level> lods;
+};
+
+namespace vertex_format {
+  // float attributes and 32 bit indices as in the model
+  packed_mesh pack(model const& source);
+  // 16 bit positions and texture coordinates normalized to their bounds, 16 bit octahedral normals
+  // and 16 bit indices for less than 65536 vertices, other attributes stay floats
+  packed_mesh quantize(model const& source);
+
+  // unit vector to [-1, 1]^2
+  glm::fvec2 encode_octahedral(glm::fvec3 const& normal);
+  glm::fvec3 decode_octahedral(glm::fvec2 const& encoded);
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <glm/gtc/type_precision.hpp>
 
+#include <string>
+
 //dont load gl bindings from glfw
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -12,14 +14,14 @@ class Application;
 struct GLFWwindow;
 
 namespace window_handler { 
-  // create window and set callbacks
-  GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor);
+  // create window and set callbacks, debug_context enables the driver's debug output
+  GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor, bool debug_context);
   // load shader programs and update uniform locations
   void set_callback_object(GLFWwindow* window, Application* app);
   // free resources
   void close_and_quit(GLFWwindow* window, int status);
-    // calculate fps and show in window title
-  void show_fps(GLFWwindow* window);
+  // show status text after the name in the window title
+  void show_status(GLFWwindow* window, std::string const& status);
 }
 
 #endif
\ No newline at end of file
@@ -12,7 +12,12 @@ using namespace gl;
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
-static void update_shader_programs(std::map<std::string, shader_program>& shaders, bool throwing);
+#include <algorithm>
+#include <iostream>
+
+static bool update_shader_program(shader_program& program, bool throwing);
+static void update_uniform_locations(shader_program& program);
+static bool depends_on(shader_program const& program, std::vector<std::string> const& files);
 
 const glm::uvec2 Application::initial_resolution = {640u, 480u};
 const float Application::initial_aspect_ratio = float(initial_resolution.x) / float(initial_resolution.y);
@@ -20,6 +25,9 @@ const float Application::initial_aspect_ratio = float(initial_resolution.x) / fl
 Application::Application(std::string const& resource_path)
  :m_resource_path{resource_path}
  ,m_shaders{}
+ ,m_shader_watcher{}
+ ,m_gpu_profiler{}
+ ,m_gl_state{}
 {}
 
 Application::~Application() {
@@ -31,19 +39,62 @@ Application::~Application() {
 
 void Application::reloadShaders(bool throwing) {
   // recompile shaders from source files
-  update_shader_programs(m_shaders, throwing);
+  for (auto& pair : m_shaders) {
+    update_shader_program(pair.second, throwing);
+  }
   // after shader programs are recompiled, uniform locations may change
   updateUniformLocations();
+  // relinked programs lost their values, new ones may reuse old handles
+  m_gl_state.invalidate();
+  m_gl_state.invalidate_uniforms();
   // upload values to new locations
   uploadUniforms();
+  watchShaderSources();
+}
+
+void Application::reloadChangedShaders() {
+  std::vector<std::string> changed_files = m_shader_watcher.poll();
+  // cached sources are outdated
+  for (auto const& file : changed_files) {
+    shader_loader::invalidate(file);
+  }
+  recompileShaders(changed_files);
 }
 
 // update shader uniform locations
 void Application::updateUniformLocations() {
   for (auto& pair : m_shaders) {
-    for (auto& uniform : pair.second.u_locs) {
-      // store uniform location in map
-      uniform.second = utils::glGetUniformLocation(pair.second.handle, uniform.first.c_str());
+    update_uniform_locations(pair.second);
+  }
+}
+
+void Application::recompileShaders(std::vector<std::string> const& changed_files) {
+  if (changed_files.empty()) {
+    return;
+  }
+  bool recompiled = false;
+  for (auto& pair : m_shaders) {
+    if (depends_on(pair.second, changed_files) && update_shader_program(pair.second, false)) {
+      // uniform names stay, only their locations are queried again
+      update_uniform_locations(pair.second);
+      recompiled = true;
+    }
+  }
+  if (recompiled) {
+    m_gl_state.invalidate();
+    m_gl_state.invalidate_uniforms();
+    uploadUniforms();
+  }
+  // edits may have added includes
+  watchShaderSources();
+}
+
+void Application::watchShaderSources() {
+  for (auto const& pair : m_shaders) {
+    for (auto const& stage : pair.second.shader_paths) {
+      for (auto const& file : shader_loader::dependencies(stage.second)) {
+        m_shader_watcher.watch(file);
+      }
     }
   }
 }
@@ -56,7 +107,14 @@ void Application::key_callback(GLFWwindow* m_window, int key, int action, int mo
     glfwSetWindowShouldClose(m_window, 1);
   }
   else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-    reloadShaders(false);
+    // only programs with edited sources are recompiled
+    recompileShaders(shader_loader::refresh());
+  }
+  else if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+    // log gpu time of all passes and the calls saved by the state cache
+    gl_state::counters calls = m_gl_state.last_frame();
+    std::cout << m_gpu_profiler.report() << "gl calls: " << calls.issued << " issued, "
+              << calls.skipped << " skipped" << std::endl;
   }
   // else pass input to derived class
   else {
@@ -80,31 +138,47 @@ void Application::resize_callback(unsigned width, unsigned height) {
   resizeCallback(width, height);
 }
 ///////////////////////////// local helper functions //////////////////////////
-// update uniform locations
-static void update_shader_programs(std::map<std::string, shader_program>& shaders, bool throwing) {
+// recompile program, returns false if compiling failed and throwing is disabled
+static bool update_shader_program(shader_program& program, bool throwing) {
   // actual functionality in lambda to allow update with and without throwing
   auto update_lambda = [](shader_program& program){
     // throws exception when compiling was unsuccessfull
-    GLuint new_program = shader_loader::program(program.shader_paths);
+    GLuint new_program = shader_loader::program(program.shader_paths, program.defines);
     // free old shader program
     glDeleteProgram(program.handle);
     // save new shader program
     program.handle = new_program;
   };
 
-  // reload all shader programs
-  for (auto& pair : shaders) {
-    if (throwing) {
-      update_lambda(pair.second);
+  if (throwing) {
+    update_lambda(program);
+  }
+  else {
+    try {
+     update_lambda(program);
     }
-    else {
-      try {
-       update_lambda(pair.second);
-      }
-      catch(std::exception&) {
-        // dont crash, allow another try
-      }
+    catch(std::exception&) {
+      // dont crash, allow another try
+      return false;
     }
   }
+  return true;
 }
 
+static void update_uniform_locations(shader_program& program) {
+  for (auto& uniform : program.u_locs) {
+    // store uniform location in map
+    uniform.second = utils::glGetUniformLocation(program.handle, uniform.first.c_str());
+  }
+}
+
+static bool depends_on(shader_program const& program, std::vector<std::string> const& files) {
+  for (auto const& stage : program.shader_paths) {
+    for (auto const& dependency : shader_loader::dependencies(stage.second)) {
+      if (std::find(files.begin(), files.end(), dependency) != files.end()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,117 @@
+#include "asset_graph.hpp"
+
+#include "cpu_profiler.hpp"
+
+#include <stdexcept>
+
+asset_graph::asset_graph(thread_pool& pool)
+ :m_pool(pool)
+ ,m_tasks{}
+ ,m_uploads{}
+ ,m_remaining{0}
+ ,m_started{false}
+ ,m_mutex{}
+ ,m_ready{}
+ ,m_in_flight{0}
+{}
+
+asset_graph::~asset_graph() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+  m_ready.wait(lock, [this]{ return m_in_flight == 0; });
+}
+
+asset_graph::task_id asset_graph::add(std::string const& name, load_fn load, std::vector<task_id> const& dependencies) {
+  if (m_started) {
+    throw std::logic_error("asset_graph: tasks must be added before run");
+  }
+  task_id id = m_tasks.size();
+  std::unique_ptr<task> new_task{new task{}};
+  new_task->name = name;
+  new_task->load = std::move(load);
+  new_task->missing.store(dependencies.size());
+  for (task_id dependency : dependencies) {
+    if (dependency >= id) {
+      throw std::invalid_argument("asset_graph: unknown dependency of " + name);
+    }
+    m_tasks[dependency]->dependents.push_back(id);
+  }
+  m_tasks.push_back(std::move(new_task));
+  ++m_remaining;
+  return id;
+}
+
+void asset_graph::run() {
+  if (m_started) {
+    throw std::logic_error("asset_graph: already running");
+  }
+  m_started = true;
+  // collect roots first, finished roots already start their dependents
+  std::vector<task_id> roots{};
+  for (task_id id = 0; id < m_tasks.size(); ++id) {
+    if (m_tasks[id]->missing.load() == 0) {
+      roots.push_back(id);
+    }
+  }
+  for (task_id id : roots) {
+    schedule(id);
+  }
+}
+
+bool asset_graph::poll() {
+  upload_fn upload{};
+  while (m_uploads.pop(upload)) {
+    --m_remaining;
+    if (upload) {
+      PROFILE_SCOPE("asset upload");
+      upload();
+    }
+  }
+  return m_remaining == 0;
+}
+
+void asset_graph::wait() {
+  if (!m_started) {
+    run();
+  }
+  while (!poll()) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_ready.wait(lock, [this]{ return !m_uploads.empty(); });
+  }
+}
+
+void asset_graph::schedule(task_id id) {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_in_flight;
+  }
+  m_pool.submit([this, id]{ execute(id); });
+}
+
+void asset_graph::execute(task_id id) {
+  task& current = *m_tasks[id];
+  bool failed = false;
+  upload_fn upload{};
+  try {
+    PROFILE_SCOPE(cpu_profiler::intern(current.name));
+    upload = current.load();
+  }
+  catch (std::exception const& e) {
+    // report on the gl thread
+    std::string message = "asset_graph: loading " + current.name + " failed: " + e.what();
+    upload = [message]{ throw std::runtime_error(message); };
+    failed = true;
+  }
+  // queue upload before starting dependents so it is executed before theirs
+  m_uploads.push(std::move(upload));
+
+  for (task_id dependent : current.dependents) {
+    // last finished dependency starts the task
+    if (!failed && m_tasks[dependent]->missing.fetch_sub(1) == 1) {
+      schedule(dependent);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock{m_mutex};
+  --m_in_flight;
+  m_ready.notify_all();
+}
@@ -0,0 +1,61 @@
+#include "benchmark.hpp"
+
+#include "frame_stats.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace benchmark {
+
+std::string report(run_options const& options, std::string const& backend, std::string const& renderer,
+                   std::vector<double> const& frame_ms, double total_seconds, gpu_profiler const& gpu_timers,
+                   gl_state const& state) {
+  std::vector<double> sorted{frame_ms};
+  std::sort(sorted.begin(), sorted.end());
+  double mean = sorted.empty() ? 0. : std::accumulate(sorted.begin(), sorted.end(), 0.) / double(sorted.size());
+  gl_state::counters calls = state.total();
+  double frames = std::max(double(frame_ms.size()), 1.);
+
+  std::ostringstream json{};
+  json << "{\n"
+       << "  \"backend\": " << utils::json_string(backend) << ",\n"
+       << "  \"renderer\": " << utils::json_string(renderer) << ",\n"
+       << "  \"resolution\": [" << options.resolution.x << ", " << options.resolution.y << "],\n"
+       << "  \"scene\": " << utils::json_string(options.scene) << ",\n"
+       << "  \"frames\": " << frame_ms.size() << ",\n"
+       << "  \"total_s\": " << total_seconds << ",\n"
+       << "  \"fps\": " << (total_seconds > 0. ? double(frame_ms.size()) / total_seconds : 0.) << ",\n"
+       << "  \"frame_ms\": {"
+       << "\"mean\": " << mean
+       << ", \"min\": " << (sorted.empty() ? 0. : sorted.front())
+       << ", \"p50\": " << frame_stats::nearest_rank(sorted, 0.5)
+       << ", \"p95\": " << frame_stats::nearest_rank(sorted, 0.95)
+       << ", \"p99\": " << frame_stats::nearest_rank(sorted, 0.99)
+       << ", \"max\": " << (sorted.empty() ? 0. : sorted.back()) << "},\n"
+       << "  \"gpu_ms\": " << gpu_timers.json() << ",\n"
+       << "  \"gpu_dropped_frames\": " << gpu_timers.dropped_frames() << ",\n"
+       << "  \"gl_calls_per_frame\": {"
+       << "\"issued\": " << double(calls.issued) / frames
+       << ", \"skipped\": " << double(calls.skipped) / frames << "}\n"
+       << "}\n";
+  return json.str();
+}
+
+void write_report(run_options const& options, std::string const& report) {
+  if (options.output.empty()) {
+    std::cout << report;
+    return;
+  }
+  std::ofstream file{options.output};
+  file << report;
+  if (!file) {
+    throw std::runtime_error("benchmark: could not write report to " + options.output);
+  }
+}
+
+}
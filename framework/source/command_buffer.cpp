@@ -0,0 +1,162 @@
+#include "command_buffer.hpp"
+#include "cpu_profiler.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+command_buffer::command_buffer()
+ :m_commands{}
+ ,m_data{}
+{}
+
+void command_buffer::clear() {
+  m_commands.clear();
+  m_data.clear();
+}
+
+void command_buffer::use_program(GLuint program) {
+  push(op::use_program, GL_NONE, program, 0, 0, 0);
+}
+
+void command_buffer::bind_vertex_array(GLuint vertex_array) {
+  push(op::bind_vertex_array, GL_NONE, vertex_array, 0, 0, 0);
+}
+
+void command_buffer::bind_texture(unsigned unit, GLenum target, GLuint texture) {
+  push(op::bind_texture, target, texture, GLint(unit), 0, 0);
+}
+
+void command_buffer::uniform(GLint location, int value) {
+  float data = 0.f;
+  std::memcpy(&data, &value, sizeof(value));
+  push(op::uniform_int, GL_NONE, 0, location, 0, push_data(&data, 1));
+}
+
+void command_buffer::uniform(GLint location, float value) {
+  push(op::uniform_float, GL_NONE, 0, location, 0, push_data(&value, 1));
+}
+
+void command_buffer::uniform(GLint location, glm::fvec3 const& value) {
+  push(op::uniform_vec3, GL_NONE, 0, location, 0, push_data(glm::value_ptr(value), 3));
+}
+
+void command_buffer::uniform(GLint location, glm::fmat4 const& value) {
+  push(op::uniform_mat4, GL_NONE, 0, location, 0, push_data(glm::value_ptr(value), 16));
+}
+
+void command_buffer::draw_elements(GLenum mode, GLsizei count, GLenum type, std::size_t offset) {
+  // index type travels in handle, the mode in target
+  push(op::draw_elements, mode, GLuint(type), 0, count, offset);
+}
+
+void command_buffer::draw_arrays(GLenum mode, GLint first, GLsizei count) {
+  push(op::draw_arrays, mode, 0, first, count, 0);
+}
+
+void command_buffer::replay(gl_state& state) const {
+  for (auto const& cmd : m_commands) {
+    float const* data = m_data.data() + cmd.data;
+    switch (cmd.type) {
+      case op::use_program:
+        state.use_program(cmd.handle);
+        break;
+      case op::bind_vertex_array:
+        state.bind_vertex_array(cmd.handle);
+        break;
+      case op::bind_texture:
+        state.bind_texture(unsigned(cmd.first), cmd.target, cmd.handle);
+        break;
+      case op::uniform_int: {
+        int value = 0;
+        std::memcpy(&value, data, sizeof(value));
+        state.uniform(cmd.first, value);
+        break;
+      }
+      case op::uniform_float:
+        state.uniform(cmd.first, data[0]);
+        break;
+      case op::uniform_vec3:
+        state.uniform(cmd.first, glm::make_vec3(data));
+        break;
+      case op::uniform_mat4:
+        state.uniform(cmd.first, glm::make_mat4(data));
+        break;
+      case op::draw_elements:
+        glDrawElements(cmd.target, cmd.count, GLenum(cmd.handle), reinterpret_cast<void const*>(cmd.data));
+        break;
+      case op::draw_arrays:
+        glDrawArrays(cmd.target, cmd.first, cmd.count);
+        break;
+    }
+  }
+}
+
+std::size_t command_buffer::size() const {
+  return m_commands.size();
+}
+
+void command_buffer::push(op type, GLenum target, GLuint handle, GLint first, GLsizei count, std::size_t data) {
+  m_commands.push_back(command{type, target, handle, first, count, data});
+}
+
+std::size_t command_buffer::push_data(float const* values, std::size_t size) {
+  std::size_t index = m_data.size();
+  m_data.insert(m_data.end(), values, values + size);
+  return index;
+}
+
+command_recorder::command_recorder(thread_pool& workers, std::size_t min_batch)
+ :m_workers(workers)
+ ,m_min_batch{std::max<std::size_t>(min_batch, 1)}
+ ,m_buffers{}
+ ,m_num_buffers{0}
+{}
+
+void command_recorder::record(std::size_t num_items, record_fn const& record) {
+  PROFILE_SCOPE("command_recorder::record");
+  std::size_t num_ranges = std::min((num_items + m_min_batch - 1) / m_min_batch, std::max<std::size_t>(m_workers.size(), 1));
+  if (m_buffers.size() < num_ranges) {
+    m_buffers.resize(num_ranges);
+  }
+  m_num_buffers = num_ranges;
+  for (std::size_t i = 0; i < num_ranges; ++i) {
+    m_buffers[i].clear();
+  }
+  if (num_ranges <= 1) {
+    // not worth waking a worker
+    if (num_ranges == 1) {
+      record(m_buffers[0], 0, num_items);
+    }
+    return;
+  }
+
+  m_workers.parallel_for(num_ranges, [this, num_items, num_ranges, &record](std::size_t i){
+    PROFILE_SCOPE("command_recorder::record_range");
+    record(m_buffers[i], i * num_items / num_ranges, (i + 1) * num_items / num_ranges);
+  });
+}
+
+void command_recorder::replay(gl_state& state) const {
+  PROFILE_SCOPE("command_recorder::replay");
+  for (std::size_t i = 0; i < m_num_buffers; ++i) {
+    m_buffers[i].replay(state);
+  }
+}
+
+std::size_t command_recorder::num_buffers() const {
+  return m_num_buffers;
+}
+
+std::size_t command_recorder::num_commands() const {
+  std::size_t commands = 0;
+  for (std::size_t i = 0; i < m_num_buffers; ++i) {
+    commands += m_buffers[i].size();
+  }
+  return commands;
+}
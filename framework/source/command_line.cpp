@@ -0,0 +1,132 @@
+#include "command_line.hpp"
+
+#include "utils.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+static unsigned parse_unsigned(std::string const& name, std::string const& value);
+
+namespace command_line {
+
+run_options parse(int argc, char* argv[], glm::uvec2 const& default_resolution) {
+  run_options options{};
+  options.resource_path = utils::read_resource_path(argc, argv);
+  options.resolution = default_resolution;
+  bool frames_given = false;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string argument{argv[i]};
+      if (argument.compare(0, 2, "--") != 0) {
+        continue;
+      }
+      std::size_t split = argument.find('=');
+      std::string name = argument.substr(2, split == std::string::npos ? std::string::npos : split - 2);
+      std::string value = split == std::string::npos ? std::string{} : argument.substr(split + 1);
+
+      if (name == "help") {
+        std::cout << usage(argv[0]);
+        std::exit(EXIT_SUCCESS);
+      }
+      else if (name == "headless") {
+        options.headless = true;
+      }
+      else if (name == "frames") {
+        options.frames = parse_unsigned(name, value);
+        frames_given = true;
+      }
+      else if (name == "resolution") {
+        std::size_t x = value.find('x');
+        if (x == std::string::npos) {
+          throw std::invalid_argument("--resolution expects WIDTHxHEIGHT");
+        }
+        options.resolution = glm::uvec2{parse_unsigned(name, value.substr(0, x)), parse_unsigned(name, value.substr(x + 1))};
+        if (options.resolution.x == 0 || options.resolution.y == 0) {
+          throw std::invalid_argument("--resolution must not be empty");
+        }
+      }
+      else if (name == "scene") {
+        options.scene = value;
+      }
+      else if (name == "output") {
+        options.output = value;
+      }
+      else if (name == "capture") {
+        if (value.empty()) {
+          throw std::invalid_argument("--capture expects a directory");
+        }
+        options.capture = value;
+      }
+      else if (name == "capture-format") {
+        if (value != "tga" && value != "ppm") {
+          throw std::invalid_argument("--capture-format expects tga or ppm");
+        }
+        options.capture_format = value;
+      }
+      else if (name == "trace") {
+        if (value.empty()) {
+          throw std::invalid_argument("--trace expects a file");
+        }
+        options.trace = value;
+      }
+      else if (name == "gl-validation") {
+        options.validation = gl_validation::parse(value);
+      }
+      else if (name == "stats") {
+        if (value.empty()) {
+          throw std::invalid_argument("--stats expects a file");
+        }
+        options.stats = value;
+      }
+      else {
+        throw std::invalid_argument("unknown option --" + name);
+      }
+    }
+  }
+  catch (std::invalid_argument const& error) {
+    std::cerr << error.what() << "\n" << usage(argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // without a window there is nobody to close it
+  if (options.headless && !frames_given) {
+    options.frames = 100;
+  }
+  return options;
+}
+
+std::string usage(std::string const& program) {
+  return "usage: " + program + " [resource_path] [options]\n"
+         "  --headless            render offscreen without a window or display\n"
+         "  --frames=N            quit after N frames and report frame timings, 100 if headless\n"
+         "  --resolution=WxH      framebuffer size\n"
+         "  --scene=NAME          scripted camera path instead of interactive control\n"
+         "  --output=FILE         write the timing report to FILE instead of stdout\n"
+         "  --capture=DIR         write every frame as an image into DIR\n"
+         "  --capture-format=FMT  image format of captured frames, tga or ppm\n"
+         "  --trace=FILE          write cpu scopes as chrome trace to FILE, needs FRAMEWORK_PROFILE\n"
+         "  --gl-validation=LEVEL off, debug (async driver messages), frame (glGetError per frame)\n"
+         "                        or call (glGetError per call), call in debug and off in release builds\n"
+         "  --stats=FILE          append frame time percentiles every second, json lines if FILE ends with .json\n"
+         "  --help                show this message\n";
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static unsigned parse_unsigned(std::string const& name, std::string const& value) {
+  std::size_t end = 0;
+  unsigned long number = 0;
+  try {
+    number = std::stoul(value, &end);
+  }
+  catch (std::exception const&) {
+    end = 0;
+  }
+  if (value.empty() || end != value.size() || value[0] == '-') {
+    throw std::invalid_argument("--" + name + " expects a positive number, got '" + value + "'");
+  }
+  return unsigned(number);
+}
@@ -0,0 +1,202 @@
+#include "cpu_profiler.hpp"
+
+#include "utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// scopes per block, a thread allocates a new block when its current one is full
+static const std::size_t BLOCK_EVENTS = 4096;
+// blocks per thread, about 6 MB, later scopes of the thread are counted as dropped
+static const std::size_t MAX_BLOCKS = 64;
+
+namespace {
+  struct event {
+    char const* name;
+    std::uint64_t begin_ticks;
+    std::uint64_t end_ticks;
+  };
+
+  // written by its thread only, count and next publish the writes to the exporting thread
+  struct event_block {
+    event events[BLOCK_EVENTS];
+    std::atomic<std::size_t> count;
+    std::atomic<event_block*> next;
+  };
+
+  struct thread_buffer {
+    unsigned id;
+    // guarded by the registry mutex
+    std::string name;
+    event_block* first;
+    // written by the owning thread only
+    std::atomic<std::size_t> dropped;
+    // owning thread only
+    event_block* current;
+    std::size_t num_blocks;
+  };
+
+  // buffers outlive their threads, so scopes of finished workers are still exported
+  struct registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<thread_buffer>> buffers;
+    std::set<std::string> names;
+  };
+}
+
+static registry& global_registry();
+static event_block* new_block();
+static thread_buffer& local_buffer();
+
+// registered on first use, trivially constructed so access needs no guard
+static thread_local thread_buffer* t_buffer = nullptr;
+// clocks at program start, ticks are calibrated against the time passed since then
+static const std::uint64_t START_NS = cpu_profiler::now();
+static const std::uint64_t START_TICKS = cpu_profiler::ticks();
+
+namespace cpu_profiler {
+
+void record(char const* name, std::uint64_t begin_ticks, std::uint64_t end_ticks) {
+  thread_buffer& buffer = t_buffer ? *t_buffer : local_buffer();
+  event_block* block = buffer.current;
+  std::size_t count = block->count.load(std::memory_order_relaxed);
+  if (count == BLOCK_EVENTS) {
+    // bounded memory for long runs, the trace keeps the earliest scopes
+    if (buffer.num_blocks == MAX_BLOCKS) {
+      buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return;
+    }
+    event_block* next = new_block();
+    block->next.store(next, std::memory_order_release);
+    buffer.current = next;
+    ++buffer.num_blocks;
+    block = next;
+    count = 0;
+  }
+  block->events[count] = event{name, begin_ticks, end_ticks};
+  // event is visible to the exporter once the count includes it
+  block->count.store(count + 1, std::memory_order_release);
+}
+
+void name_thread(std::string const& name) {
+  thread_buffer& buffer = local_buffer();
+  std::lock_guard<std::mutex> lock{global_registry().mutex};
+  buffer.name = name;
+}
+
+char const* intern(std::string const& name) {
+  registry& reg = global_registry();
+  std::lock_guard<std::mutex> lock{reg.mutex};
+  // set nodes never move, the pointer stays valid
+  return reg.names.insert(name).first->c_str();
+}
+
+std::string chrome_trace() {
+  registry& reg = global_registry();
+  std::lock_guard<std::mutex> lock{reg.mutex};
+
+  // the counter rate follows from the time passed since program start
+  double ns_per_tick = 1.0;
+  std::uint64_t elapsed_ticks = ticks() - START_TICKS;
+  if (elapsed_ticks > 0) {
+    ns_per_tick = double(now() - START_NS) / double(elapsed_ticks);
+  }
+
+  // timestamps relative to the earliest scope, outer scopes are recorded after their children
+  std::uint64_t start = std::numeric_limits<std::uint64_t>::max();
+  for (auto const& buffer : reg.buffers) {
+    for (event_block const* block = buffer->first; block; block = block->next.load(std::memory_order_acquire)) {
+      std::size_t count = block->count.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < count; ++i) {
+        start = std::min(start, block->events[i].begin_ticks);
+      }
+    }
+  }
+
+  std::ostringstream json{};
+  json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  for (auto const& buffer : reg.buffers) {
+    json << (first ? "\n" : ",\n")
+         << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->id
+         << ", \"args\": {\"name\": " << utils::json_string(buffer->name) << "}}";
+    first = false;
+    for (event_block const* block = buffer->first; block; block = block->next.load(std::memory_order_acquire)) {
+      std::size_t count = block->count.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < count; ++i) {
+        event const& e = block->events[i];
+        // complete events with microsecond timestamps
+        json << ",\n{\"name\": " << utils::json_string(e.name) << ", \"ph\": \"X\", \"pid\": 0, \"tid\": " << buffer->id
+             << ", \"ts\": " << double(e.begin_ticks - start) * ns_per_tick * 1e-3
+             << ", \"dur\": " << double(e.end_ticks - e.begin_ticks) * ns_per_tick * 1e-3 << "}";
+      }
+    }
+  }
+  std::size_t dropped = 0;
+  for (auto const& buffer : reg.buffers) {
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  }
+  json << "\n], \"otherData\": {\"dropped_events\": " << dropped << "}}\n";
+  return json.str();
+}
+
+void write_chrome_trace(std::string const& path) {
+  std::ofstream file{path};
+  file << chrome_trace();
+  if (!file) {
+    throw std::runtime_error("cpu_profiler: could not write trace to " + path);
+  }
+}
+
+std::size_t num_events() {
+  registry& reg = global_registry();
+  std::lock_guard<std::mutex> lock{reg.mutex};
+  std::size_t events = 0;
+  for (auto const& buffer : reg.buffers) {
+    for (event_block const* block = buffer->first; block; block = block->next.load(std::memory_order_acquire)) {
+      events += block->count.load(std::memory_order_acquire);
+    }
+  }
+  return events;
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static registry& global_registry() {
+  // never destroyed, threads may still record while static objects are destroyed at exit
+  static registry* reg = new registry{};
+  return *reg;
+}
+
+static event_block* new_block() {
+  event_block* block = new event_block;
+  block->count.store(0, std::memory_order_relaxed);
+  block->next.store(nullptr, std::memory_order_relaxed);
+  return block;
+}
+
+static thread_buffer& local_buffer() {
+  if (!t_buffer) {
+    registry& reg = global_registry();
+    std::unique_ptr<thread_buffer> buffer{new thread_buffer{}};
+    buffer->first = new_block();
+    buffer->current = buffer->first;
+    buffer->num_blocks = 1;
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    buffer->id = unsigned(reg.buffers.size());
+    buffer->name = "thread " + std::to_string(buffer->id);
+    t_buffer = buffer.get();
+    reg.buffers.push_back(std::move(buffer));
+  }
+  return *t_buffer;
+}
@@ -0,0 +1,69 @@
+#include "cubemap.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stdexcept>
+
+namespace cubemap {
+
+cubemap_target create(GLsizei size, GLenum internal_format) {
+  cubemap_target target{};
+  target.size = size;
+  target.texture.target = GL_TEXTURE_CUBE_MAP;
+  glGenTextures(1, &target.texture.handle);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, target.texture.handle);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // no seams at face borders
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  for (unsigned face = 0; face < NUM_FACES; ++face) {
+    glTexImage2D(GLenum(unsigned(GL_TEXTURE_CUBE_MAP_POSITIVE_X) + face), 0, GLint(internal_format), size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  }
+
+  glGenFramebuffers(1, &target.framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, target.texture.handle, 0);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    destroy(target);
+    throw std::runtime_error("cubemap: framebuffer incomplete");
+  }
+  return target;
+}
+
+void bind_face(cubemap_target const& target, unsigned face) {
+  glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GLenum(unsigned(GL_TEXTURE_CUBE_MAP_POSITIVE_X) + face), target.texture.handle, 0);
+  glViewport(0, 0, target.size, target.size);
+}
+
+glm::fmat4 face_view(unsigned face, glm::fvec3 const& position) {
+  // +x, -x, +y, -y, +z, -z with the up vectors of the cube map convention
+  static const glm::fvec3 directions[NUM_FACES] = {
+    {1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}
+  };
+  static const glm::fvec3 ups[NUM_FACES] = {
+    {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}, {0.f, -1.f, 0.f}, {0.f, -1.f, 0.f}
+  };
+  return glm::lookAt(position, position + directions[face], ups[face]);
+}
+
+glm::fmat4 face_projection(float near, float far) {
+  return glm::perspective(glm::half_pi<float>(), 1.f, near, far);
+}
+
+void destroy(cubemap_target& target) {
+  glDeleteFramebuffers(1, &target.framebuffer);
+  glDeleteTextures(1, &target.texture.handle);
+  target = cubemap_target{};
+}
+
+}
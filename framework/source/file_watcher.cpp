@@ -0,0 +1,108 @@
+#include "file_watcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+
+#ifndef __linux__
+static long long modification_time(std::string const& file_path);
+#endif
+
+file_watcher::file_watcher()
+ :m_files{}
+#ifdef __linux__
+ ,m_inotify{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}
+ ,m_directories{}
+#else
+ ,m_times{}
+#endif
+{}
+
+file_watcher::~file_watcher() {
+#ifdef __linux__
+  if (m_inotify >= 0) {
+    close(m_inotify);
+  }
+#endif
+}
+
+void file_watcher::watch(std::string const& file_path) {
+  if (!m_files.insert(file_path).second) {
+    return;
+  }
+#ifdef __linux__
+  if (m_inotify < 0) {
+    return;
+  }
+  // editors often replace files instead of writing them, so watch the directory
+  std::string directory = file_path.substr(0, file_path.find_last_of('/') + 1);
+  for (auto const& watched : m_directories) {
+    if (watched.second == directory) {
+      return;
+    }
+  }
+  int descriptor = inotify_add_watch(m_inotify, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (descriptor >= 0) {
+    m_directories[descriptor] = directory;
+  }
+#else
+  m_times[file_path] = modification_time(file_path);
+#endif
+}
+
+std::vector<std::string> file_watcher::poll() {
+  std::vector<std::string> changed{};
+#ifdef __linux__
+  if (m_inotify < 0) {
+    return changed;
+  }
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+    // nonblocking descriptor fails once all events are read
+    if (length <= 0) {
+      break;
+    }
+    for (char* position = buffer; position < buffer + length;) {
+      inotify_event const* event = reinterpret_cast<inotify_event const*>(position);
+      position += sizeof(inotify_event) + event->len;
+
+      auto directory = m_directories.find(event->wd);
+      if (directory == m_directories.end() || event->len == 0) {
+        continue;
+      }
+      std::string file_path = directory->second + event->name;
+      if (m_files.count(file_path) > 0 && std::find(changed.begin(), changed.end(), file_path) == changed.end()) {
+        changed.push_back(file_path);
+      }
+    }
+  }
+#else
+  for (auto& time : m_times) {
+    long long current = modification_time(time.first);
+    if (current != time.second) {
+      time.second = current;
+      changed.push_back(time.first);
+    }
+  }
+#endif
+  return changed;
+}
+
+///////////////////////////// local helper functions //////////////////////////
+#ifndef __linux__
+static long long modification_time(std::string const& file_path) {
+  struct stat info;
+  if (stat(file_path.c_str(), &info) != 0) {
+    return -1;
+  }
+  return static_cast<long long>(info.st_mtime);
+}
+#endif
@@ -0,0 +1,240 @@
+#include "frame_capture.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// encoded frames waiting for the worker before capture blocks
+static const std::size_t MAX_PENDING_WRITES = 8;
+
+static void write_tga(std::string const& path, std::size_t width, std::size_t height, std::vector<std::uint8_t> const& bgra);
+static void write_ppm(std::string const& path, std::size_t width, std::size_t height, std::vector<std::uint8_t> const& bgra);
+
+frame_capture::frame_capture(std::string const& directory, std::string const& format, std::size_t buffer_count)
+ :m_directory{directory}
+ ,m_format{format}
+ ,m_buffers(buffer_count)
+ ,m_next{0}
+ ,m_frame{0}
+ ,m_mutex{}
+ ,m_written{}
+ ,m_pending_writes{0}
+ ,m_frames_written{0}
+ ,m_error{}
+ ,m_encoder{1}
+{
+  if (m_format != "tga" && m_format != "ppm") {
+    throw std::invalid_argument("frame_capture: unsupported format '" + m_format + "'");
+  }
+  if (m_buffers.empty()) {
+    throw std::invalid_argument("frame_capture: at least one pack buffer is required");
+  }
+#ifdef _WIN32
+  _mkdir(m_directory.c_str());
+#else
+  mkdir(m_directory.c_str(), 0755);
+#endif
+  for (auto& buffer : m_buffers) {
+    glGenBuffers(1, &buffer.handle);
+    buffer.size = 0;
+    buffer.fence = nullptr;
+    buffer.width = 0;
+    buffer.height = 0;
+    buffer.frame = 0;
+  }
+}
+
+frame_capture::~frame_capture() {
+  try {
+    flush();
+  }
+  catch (std::exception const&) {
+    // errors were reported by flush if the owner called it
+  }
+  for (auto& buffer : m_buffers) {
+    glDeleteBuffers(1, &buffer.handle);
+  }
+}
+
+void frame_capture::capture(GLsizei width, GLsizei height) {
+  poll();
+  pack_buffer& buffer = m_buffers[m_next];
+  if (buffer.fence) {
+    // gpu is more than buffer_count frames behind, wait instead of dropping the frame
+    glClientWaitSync(buffer.fence, SyncObjectMask::GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+    finish_readback(buffer);
+  }
+
+  std::size_t bytes = std::size_t(width) * std::size_t(height) * 4;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.handle);
+  if (buffer.size != bytes) {
+    buffer.size = bytes;
+    glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(buffer.size), NULL, GL_STREAM_READ);
+  }
+  // bgra matches the native framebuffer layout, the copy returns without waiting for rendering
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, UnusedMask::GL_UNUSED_BIT);
+  buffer.width = width;
+  buffer.height = height;
+  buffer.frame = m_frame++;
+
+  m_next = (m_next + 1) % m_buffers.size();
+}
+
+void frame_capture::poll() {
+  // oldest readback first, so frames reach the encoder in order
+  for (std::size_t i = 0; i < m_buffers.size(); ++i) {
+    pack_buffer& buffer = m_buffers[(m_next + i) % m_buffers.size()];
+    if (!buffer.fence) {
+      continue;
+    }
+    GLenum state = glClientWaitSync(buffer.fence, SyncObjectMask::GL_NONE_BIT, 0);
+    if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) {
+      break;
+    }
+    finish_readback(buffer);
+  }
+}
+
+void frame_capture::flush() {
+  for (std::size_t i = 0; i < m_buffers.size(); ++i) {
+    pack_buffer& buffer = m_buffers[(m_next + i) % m_buffers.size()];
+    if (buffer.fence) {
+      glClientWaitSync(buffer.fence, SyncObjectMask::GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+      finish_readback(buffer);
+    }
+  }
+  std::unique_lock<std::mutex> lock{m_mutex};
+  m_written.wait(lock, [this] { return m_pending_writes == 0; });
+  if (!m_error.empty()) {
+    std::string error = m_error;
+    m_error.clear();
+    throw std::runtime_error(error);
+  }
+}
+
+std::size_t frame_capture::frames_written() const {
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_frames_written;
+}
+
+void frame_capture::finish_readback(pack_buffer& buffer) {
+  glDeleteSync(buffer.fence);
+  buffer.fence = nullptr;
+
+  // copy out so the buffer can take the next frame right away
+  std::shared_ptr<std::vector<std::uint8_t>> pixels = std::make_shared<std::vector<std::uint8_t>>(buffer.size);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.handle);
+  void const* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(buffer.size), GL_MAP_READ_BIT);
+  if (mapped) {
+    std::memcpy(pixels->data(), mapped, buffer.size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (!mapped) {
+    throw std::runtime_error("frame_capture: could not map pack buffer");
+  }
+
+  char name[32];
+  std::snprintf(name, sizeof(name), "frame_%05u.", buffer.frame);
+  std::string path = m_directory + "/" + name + m_format;
+  std::size_t width = std::size_t(buffer.width);
+  std::size_t height = std::size_t(buffer.height);
+  bool tga = m_format == "tga";
+  {
+    // encoder fell behind, bound the memory held by queued frames
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_written.wait(lock, [this] { return m_pending_writes < MAX_PENDING_WRITES; });
+    ++m_pending_writes;
+  }
+  m_encoder.submit([this, path, width, height, tga, pixels] {
+    std::string error{};
+    try {
+      if (tga) {
+        write_tga(path, width, height, *pixels);
+      }
+      else {
+        write_ppm(path, width, height, *pixels);
+      }
+    }
+    catch (std::exception const& e) {
+      error = e.what();
+    }
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (error.empty()) {
+      ++m_frames_written;
+    }
+    else if (m_error.empty()) {
+      m_error = error;
+    }
+    --m_pending_writes;
+    m_written.notify_all();
+  });
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static void write_tga(std::string const& path, std::size_t width, std::size_t height, std::vector<std::uint8_t> const& bgra) {
+  std::ofstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error("frame_capture: could not open '" + path + "'");
+  }
+  // uncompressed true color, rows bottom to top like gl
+  std::uint8_t header[18] = {};
+  header[2] = 2;
+  header[12] = std::uint8_t(width & 0xff);
+  header[13] = std::uint8_t(width >> 8);
+  header[14] = std::uint8_t(height & 0xff);
+  header[15] = std::uint8_t(height >> 8);
+  header[16] = 24;
+  file.write(reinterpret_cast<char const*>(header), sizeof(header));
+
+  // drop alpha, the default framebuffer does not need to store it
+  std::vector<std::uint8_t> bgr(width * height * 3);
+  for (std::size_t i = 0; i < width * height; ++i) {
+    bgr[i * 3 + 0] = bgra[i * 4 + 0];
+    bgr[i * 3 + 1] = bgra[i * 4 + 1];
+    bgr[i * 3 + 2] = bgra[i * 4 + 2];
+  }
+  file.write(reinterpret_cast<char const*>(bgr.data()), std::streamsize(bgr.size()));
+  if (!file) {
+    throw std::runtime_error("frame_capture: could not write '" + path + "'");
+  }
+}
+
+static void write_ppm(std::string const& path, std::size_t width, std::size_t height, std::vector<std::uint8_t> const& bgra) {
+  std::ofstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error("frame_capture: could not open '" + path + "'");
+  }
+  file << "P6\n" << width << " " << height << "\n255\n";
+
+  // rgb rows from top to bottom
+  std::vector<std::uint8_t> rgb(width * height * 3);
+  for (std::size_t y = 0; y < height; ++y) {
+    std::uint8_t const* src = &bgra[(height - 1 - y) * width * 4];
+    std::uint8_t* dst = &rgb[y * width * 3];
+    for (std::size_t x = 0; x < width; ++x) {
+      dst[x * 3 + 0] = src[x * 4 + 2];
+      dst[x * 3 + 1] = src[x * 4 + 1];
+      dst[x * 3 + 2] = src[x * 4 + 0];
+    }
+  }
+  file.write(reinterpret_cast<char const*>(rgb.data()), std::streamsize(rgb.size()));
+  if (!file) {
+    throw std::runtime_error("frame_capture: could not write '" + path + "'");
+  }
+}
@@ -0,0 +1,113 @@
+#include "frame_stats.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+// frames between refreshes of the median used for hitch detection
+static const std::size_t MEDIAN_REFRESH = 32;
+
+frame_stats::frame_stats(std::size_t window, double hitch_factor)
+ :m_interval{std::vector<double>(window), 0, 0}
+ ,m_cpu{std::vector<double>(window), 0, 0}
+ ,m_gpu{std::vector<double>(window), 0, 0}
+ ,m_hitch(window, false)
+ ,m_hitch_factor{hitch_factor}
+ ,m_median{0.}
+ ,m_frames_since_median{0}
+ ,m_total_hitches{0}
+{
+  if (window == 0) {
+    throw std::invalid_argument("frame_stats: window must hold at least one frame");
+  }
+}
+
+void frame_stats::add_frame(double interval_ms, double cpu_ms) {
+  // no median yet during the first frames, nothing counts as hitch
+  bool hitch = m_median > 0. && interval_ms > m_hitch_factor * m_median;
+  m_hitch[m_interval.next] = hitch;
+  m_total_hitches += hitch ? 1 : 0;
+  push(m_interval, interval_ms);
+  push(m_cpu, cpu_ms);
+
+  if (++m_frames_since_median >= MEDIAN_REFRESH || m_median == 0.) {
+    std::vector<double> values{m_interval.values.begin(), m_interval.values.begin() + std::ptrdiff_t(m_interval.count)};
+    std::nth_element(values.begin(), values.begin() + std::ptrdiff_t(values.size() / 2), values.end());
+    m_median = values[values.size() / 2];
+    m_frames_since_median = 0;
+  }
+}
+
+void frame_stats::add_gpu(double gpu_ms) {
+  push(m_gpu, gpu_ms);
+}
+
+frame_stats::summary frame_stats::compute() const {
+  summary stats{};
+  stats.frames = m_interval.count;
+  double total_ms = 0.;
+  for (std::size_t i = 0; i < m_interval.count; ++i) {
+    total_ms += m_interval.values[i];
+    stats.hitches += m_hitch[i] ? 1 : 0;
+  }
+  stats.fps = total_ms > 0. ? double(m_interval.count) * 1000. / total_ms : 0.;
+  stats.interval = evaluate(m_interval);
+  stats.cpu = evaluate(m_cpu);
+  stats.gpu = evaluate(m_gpu);
+  stats.total_hitches = m_total_hitches;
+  return stats;
+}
+
+std::string frame_stats::csv_header() {
+  std::string header{"frames,fps"};
+  for (char const* series : {"interval", "cpu", "gpu"}) {
+    for (char const* statistic : {"p50", "p95", "p99", "max"}) {
+      header += std::string{","} + series + "_" + statistic;
+    }
+  }
+  return header + ",hitches,total_hitches";
+}
+
+std::string frame_stats::csv(summary const& stats) {
+  std::ostringstream line{};
+  line << stats.frames << "," << stats.fps;
+  for (percentiles const* series : {&stats.interval, &stats.cpu, &stats.gpu}) {
+    line << "," << series->p50 << "," << series->p95 << "," << series->p99 << "," << series->max;
+  }
+  line << "," << stats.hitches << "," << stats.total_hitches;
+  return line.str();
+}
+
+std::string frame_stats::json(summary const& stats) {
+  std::ostringstream object{};
+  object << "{\"frames\": " << stats.frames << ", \"fps\": " << stats.fps;
+  char const* names[] = {"interval", "cpu", "gpu"};
+  percentiles const* series[] = {&stats.interval, &stats.cpu, &stats.gpu};
+  for (std::size_t i = 0; i < 3; ++i) {
+    object << ", \"" << names[i] << "_ms\": {\"p50\": " << series[i]->p50 << ", \"p95\": " << series[i]->p95
+           << ", \"p99\": " << series[i]->p99 << ", \"max\": " << series[i]->max << "}";
+  }
+  object << ", \"hitches\": " << stats.hitches << ", \"total_hitches\": " << stats.total_hitches << "}";
+  return object.str();
+}
+
+void frame_stats::push(ring& series, double value) {
+  series.values[series.next] = value;
+  series.next = (series.next + 1) % series.values.size();
+  series.count = std::min(series.count + 1, series.values.size());
+}
+
+frame_stats::percentiles frame_stats::evaluate(ring const& series) {
+  std::vector<double> sorted{series.values.begin(), series.values.begin() + std::ptrdiff_t(series.count)};
+  std::sort(sorted.begin(), sorted.end());
+  return percentiles{nearest_rank(sorted, 0.5), nearest_rank(sorted, 0.95), nearest_rank(sorted, 0.99),
+                     sorted.empty() ? 0. : sorted.back()};
+}
+
+double frame_stats::nearest_rank(std::vector<double> const& sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0.;
+  }
+  std::size_t rank = std::size_t(fraction * double(sorted.size()));
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
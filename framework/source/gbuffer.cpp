@@ -0,0 +1,87 @@
+#include "gbuffer.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+static void allocate(gbuffer_target& target);
+
+namespace deferred {
+
+gbuffer_target create(GLsizei width, GLsizei height) {
+  gbuffer_target target{};
+  target.width = width;
+  target.height = height;
+  for (texture_object* texture : {&target.albedo, &target.normal, &target.depth}) {
+    texture->target = GL_TEXTURE_2D;
+    glGenTextures(1, &texture->handle);
+    glBindTexture(GL_TEXTURE_2D, texture->handle);
+    // texels are fetched one to one, no filtering between surfaces
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  allocate(target);
+
+  glGenFramebuffers(1, &target.framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.albedo.handle, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, target.normal.handle, 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, target.depth.handle, 0);
+  GLenum buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+  glDrawBuffers(2, buffers);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    destroy(target);
+    throw std::runtime_error("deferred: g-buffer framebuffer incomplete");
+  }
+  return target;
+}
+
+void resize(gbuffer_target& target, GLsizei width, GLsizei height) {
+  target.width = width;
+  target.height = height;
+  allocate(target);
+}
+
+void bind_textures(gbuffer_target const& target, GLuint first_unit) {
+  GLuint unit = first_unit;
+  for (texture_object const* texture : {&target.albedo, &target.normal, &target.depth}) {
+    glActiveTexture(GLenum(unsigned(GL_TEXTURE0) + unit++));
+    glBindTexture(GL_TEXTURE_2D, texture->handle);
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void destroy(gbuffer_target& target) {
+  glDeleteFramebuffers(1, &target.framebuffer);
+  for (texture_object* texture : {&target.albedo, &target.normal, &target.depth}) {
+    glDeleteTextures(1, &texture->handle);
+  }
+  target = gbuffer_target{};
+}
+
+float light_radius(float intensity, glm::fvec3 const& color, float threshold) {
+  float brightest = std::max(color.r, std::max(color.g, color.b));
+  return std::sqrt(std::max(intensity * brightest, 0.f) / threshold);
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static void allocate(gbuffer_target& target) {
+  // formats every gl 3 implementation can render to, including software rasterizers
+  glBindTexture(GL_TEXTURE_2D, target.albedo.handle);
+  glTexImage2D(GL_TEXTURE_2D, 0, GLint(GL_RGBA8), target.width, target.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glBindTexture(GL_TEXTURE_2D, target.normal.handle);
+  glTexImage2D(GL_TEXTURE_2D, 0, GLint(GL_RGBA16F), target.width, target.height, 0, GL_RGBA, GL_FLOAT, NULL);
+  glBindTexture(GL_TEXTURE_2D, target.depth.handle);
+  glTexImage2D(GL_TEXTURE_2D, 0, GLint(GL_DEPTH_COMPONENT24), target.width, target.height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
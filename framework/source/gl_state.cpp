@@ -0,0 +1,159 @@
+#include "gl_state.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+// binding value which never matches, forces the next call
+static const GLuint UNKNOWN = ~0u;
+
+gl_state::gl_state()
+ :m_program{UNKNOWN}
+ ,m_vertex_array{UNKNOWN}
+ ,m_buffers{}
+ ,m_active_unit{UNKNOWN}
+ ,m_textures{}
+ ,m_samplers{}
+ ,m_uniforms{}
+ ,m_frame{0, 0}
+ ,m_last_frame{0, 0}
+ ,m_total{0, 0}
+{}
+
+void gl_state::use_program(GLuint program) {
+  if (count(m_program != program)) {
+    glUseProgram(program);
+    m_program = program;
+  }
+}
+
+void gl_state::bind_vertex_array(GLuint vertex_array) {
+  if (count(m_vertex_array != vertex_array)) {
+    glBindVertexArray(vertex_array);
+    m_vertex_array = vertex_array;
+    // index buffer binding belongs to the vertex array
+    m_buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+  }
+}
+
+void gl_state::bind_buffer(GLenum target, GLuint buffer) {
+  auto bound = m_buffers.find(target);
+  if (count(bound == m_buffers.end() || bound->second != buffer)) {
+    glBindBuffer(target, buffer);
+    m_buffers[target] = buffer;
+  }
+}
+
+void gl_state::bind_texture(unsigned unit, GLenum target, GLuint texture) {
+  if (m_textures.size() <= unit) {
+    m_textures.resize(unit + 1);
+  }
+  auto bound = m_textures[unit].find(target);
+  if (!count(bound == m_textures[unit].end() || bound->second != texture)) {
+    return;
+  }
+  if (m_active_unit != unit) {
+    glActiveTexture(GLenum(unsigned(GL_TEXTURE0) + unit));
+    m_active_unit = unit;
+  }
+  glBindTexture(target, texture);
+  m_textures[unit][target] = texture;
+}
+
+void gl_state::bind_sampler(unsigned unit, GLuint sampler) {
+  if (m_samplers.size() <= unit) {
+    m_samplers.resize(unit + 1, UNKNOWN);
+  }
+  if (count(m_samplers[unit] != sampler)) {
+    glBindSampler(unit, sampler);
+    m_samplers[unit] = sampler;
+  }
+}
+
+void gl_state::uniform(GLint location, int value) {
+  // ints are stored bitwise, the comparison only needs equal bytes
+  float data = 0.f;
+  std::memcpy(&data, &value, sizeof(value));
+  if (change_uniform(location, &data, 1)) {
+    glUniform1i(location, value);
+  }
+}
+
+void gl_state::uniform(GLint location, float value) {
+  if (change_uniform(location, &value, 1)) {
+    glUniform1f(location, value);
+  }
+}
+
+void gl_state::uniform(GLint location, glm::fvec2 const& value) {
+  if (change_uniform(location, glm::value_ptr(value), 2)) {
+    glUniform2fv(location, 1, glm::value_ptr(value));
+  }
+}
+
+void gl_state::uniform(GLint location, glm::fvec3 const& value) {
+  if (change_uniform(location, glm::value_ptr(value), 3)) {
+    glUniform3fv(location, 1, glm::value_ptr(value));
+  }
+}
+
+void gl_state::uniform(GLint location, glm::fmat4 const& value) {
+  if (change_uniform(location, glm::value_ptr(value), 16)) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+  }
+}
+
+void gl_state::invalidate() {
+  m_program = UNKNOWN;
+  m_vertex_array = UNKNOWN;
+  m_buffers.clear();
+  m_active_unit = UNKNOWN;
+  m_textures.clear();
+  m_samplers.clear();
+}
+
+void gl_state::invalidate_uniforms() {
+  m_uniforms.clear();
+}
+
+void gl_state::begin_frame() {
+  m_last_frame = m_frame;
+  m_frame = counters{0, 0};
+}
+
+gl_state::counters gl_state::last_frame() const {
+  return m_last_frame;
+}
+
+gl_state::counters gl_state::total() const {
+  return m_total;
+}
+
+bool gl_state::change_uniform(GLint location, float const* data, unsigned size) {
+  // inactive uniforms are ignored by gl as well
+  if (location < 0 || m_program == UNKNOWN) {
+    if (location >= 0) {
+      count(true);
+    }
+    return location >= 0;
+  }
+  std::uint64_t key = (std::uint64_t(m_program) << 32) | std::uint64_t(std::uint32_t(location));
+  uniform_value& cached = m_uniforms[key];
+  bool changed = cached.size != size || std::memcmp(cached.data, data, sizeof(float) * size) != 0;
+  if (changed) {
+    std::copy(data, data + size, cached.data);
+    cached.size = size;
+  }
+  return count(changed);
+}
+
+bool gl_state::count(bool changed) {
+  ++(changed ? m_frame.issued : m_frame.skipped);
+  ++(changed ? m_total.issued : m_total.skipped);
+  return changed;
+}
@@ -0,0 +1,183 @@
+#include "gl_validation.hpp"
+
+#include <glbinding/gl/gl.h>
+// load glbinding extensions
+#include <glbinding/Binding.h>
+// load meta info extension
+#include <glbinding/Meta.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+static bool debug_output_supported();
+static void watch_gl_errors(bool activate);
+static void GL_APIENTRY openglCallbackFunction(
+  GLenum source,
+  GLenum type,
+  GLuint id,
+  GLenum severity,
+  GLsizei length,
+  const GLchar* message,
+  const void* userParam
+);
+
+static gl_validation::level s_level = gl_validation::level::off;
+
+namespace gl_validation {
+
+level parse(std::string const& name) {
+  if (name == "off") return level::off;
+  else if (name == "debug") return level::debug;
+  else if (name == "frame") return level::frame;
+  else if (name == "call") return level::call;
+  throw std::invalid_argument("gl_validation: unknown level '" + name + "', expected off, debug, frame or call");
+}
+
+std::string name(level validation) {
+  switch (validation) {
+    case level::off: return "off";
+    case level::debug: return "debug";
+    case level::frame: return "frame";
+    case level::call: return "call";
+  }
+  return "unknown";
+}
+
+level default_level() {
+#ifdef NDEBUG
+  return level::off;
+#else
+  return level::call;
+#endif
+}
+
+bool needs_debug_context(level validation) {
+  return validation != level::off;
+}
+
+void set_level(level validation) {
+  s_level = validation;
+  // per call checks already name the failing call, debug messages then arrive in order with it
+  watch_gl_errors(validation == level::call);
+
+  if (!debug_output_supported()) {
+    if (validation != level::off) {
+      std::cerr << "gl_validation: debug output not supported, only glGetError checks are active" << std::endl;
+    }
+    return;
+  }
+  if (validation == level::off) {
+    glDisable(GL_DEBUG_OUTPUT);
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    return;
+  }
+  glEnable(GL_DEBUG_OUTPUT);
+  // synchronous output stalls the driver, only used together with per call checks
+  if (validation == level::call) {
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  }
+  else {
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  }
+  glDebugMessageCallback(openglCallbackFunction, nullptr);
+  glDebugMessageControl(
+    GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, true
+  );
+}
+
+level current_level() {
+  return s_level;
+}
+
+void check_frame(unsigned frame) {
+  if (s_level != level::frame) {
+    return;
+  }
+  // errors are flags, several different ones may be pending
+  for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError()) {
+    std::cerr << "OpenGL Error in frame " << frame << ": " << glbinding::Meta::getString(error) << std::endl;
+  }
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static bool debug_output_supported() {
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  // debug output is core since 4.3
+  if (major > 4 || (major == 4 && minor >= 3)) {
+    return true;
+  }
+  GLint num_extensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+  for (GLint i = 0; i < num_extensions; ++i) {
+    char const* extension = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+    if (extension && std::strcmp(extension, "GL_KHR_debug") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void GL_APIENTRY openglCallbackFunction(
+  GLenum source,
+  GLenum type,
+  GLuint id,
+  GLenum severity,
+  GLsizei length,
+  const GLchar* message,
+  const void* userParam
+){
+  (void)source; (void)type; (void)id; 
+  (void)severity; (void)length; (void)userParam;
+  if (severity == GL_DEBUG_SEVERITY_NOTIFICATION || type == GL_DEBUG_TYPE_PERFORMANCE) {
+    return;
+  }
+  // asynchronous output may call from driver threads
+  static std::mutex output_mutex;
+  std::lock_guard<std::mutex> lock{output_mutex};
+  std::cerr << glbinding::Meta::getString(severity) << " - " << glbinding::Meta::getString(type) << ": ";
+  std::cerr << message << std::endl;
+}
+
+static void watch_gl_errors(bool activate) {
+  if(activate) {
+    // add callback after each function call
+    glbinding::setCallbackMaskExcept(glbinding::CallbackMask::After | glbinding::CallbackMask::ParametersAndReturnValue, {"glGetError", "glBegin", "glVertex3f", "glColor3f"});
+    glbinding::setAfterCallback(
+      [](glbinding::FunctionCall const& call) {
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR) {
+          // print name
+          std::cerr <<  "OpenGL Error: " << call.function->name() << "(";
+          // parameters
+          for (unsigned i = 0; i < call.parameters.size(); ++i)
+          {
+            std::cerr << call.parameters[i]->asString();
+            if (i < call.parameters.size() - 1)
+              std::cerr << ", ";
+          }
+          std::cerr << ")";
+          // return value
+          if(call.returnValue) {
+            std::cerr << " -> " << call.returnValue->asString();
+          }
+          // error
+          std::cerr  << " - " << glbinding::Meta::getString(error) << std::endl;
+          // throw exception to allow for backtrace
+          throw std::runtime_error("OpenGl error: " + std::string(call.function->name()));
+        }
+      }
+    );
+  }
+  else {
+    glbinding::setCallbackMask(glbinding::CallbackMask::None);
+  }
+}
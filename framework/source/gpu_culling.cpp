@@ -0,0 +1,174 @@
+#include "gpu_culling.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// size of one DrawElementsIndirectCommand in bytes
+static const std::size_t COMMAND_BYTES = sizeof(GLuint) * 5;
+// must match local_size_x in cull.comp
+static const GLuint WORKGROUP_SIZE = 64;
+
+namespace gpu_culling {
+
+bool supported() {
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  // compute shaders, ssbos and multi draw indirect are core since 4.3
+  return major > 4 || (major == 4 && minor >= 3);
+}
+
+indirect_batch create(model_object const& mesh, std::vector<lod_level> const& lods, GLsizei capacity) {
+  indirect_batch batch{};
+  batch.capacity = capacity;
+
+  glGenBuffers(1, &batch.object_BO);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.object_BO);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(culling_object_data) * std::size_t(capacity), NULL, GL_STATIC_DRAW);
+
+  glGenBuffers(1, &batch.transform_BO);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.transform_BO);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::fmat4) * std::size_t(capacity), NULL, GL_DYNAMIC_DRAW);
+
+  glGenBuffers(1, &batch.command_BO);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.command_BO);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, COMMAND_BYTES * std::size_t(capacity), NULL, GL_DYNAMIC_COPY);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+  glGenBuffers(1, &batch.lod_BO);
+  update_lods(batch, lods);
+
+  // object index of instance n is n, base instance of each command selects object
+  std::vector<GLuint> ids(std::size_t(capacity), 0);
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    ids[i] = GLuint(i);
+  }
+  glGenBuffers(1, &batch.id_BO);
+
+  // attach id attribute to mesh vertex array
+  glBindVertexArray(mesh.vertex_AO);
+  glBindBuffer(GL_ARRAY_BUFFER, batch.id_BO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint) * ids.size(), ids.data(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(OBJECT_ID_LOCATION);
+  glVertexAttribIPointer(OBJECT_ID_LOCATION, 1, GL_UNSIGNED_INT, 0, NULL);
+  // advance once per instance instead of per vertex
+  glVertexAttribDivisor(OBJECT_ID_LOCATION, 1);
+  glBindVertexArray(0);
+
+  return batch;
+}
+
+void update_lods(indirect_batch& batch, std::vector<lod_level> const& lods) {
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.lod_BO);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(lod_level) * lods.size(), lods.data(), GL_STATIC_DRAW);
+  batch.num_lods = GLuint(lods.size());
+}
+
+std::size_t select_lod(std::vector<lod_level> const& lods, float relative_distance) {
+  for (std::size_t i = 0; i < lods.size(); ++i) {
+    if (relative_distance < lods[i].max_distance) {
+      return i;
+    }
+  }
+  return lods.size() - 1;
+}
+
+void update(indirect_batch const& batch, std::vector<culling_object_data> const& objects) {
+  if (objects.size() > std::size_t(batch.capacity)) {
+    throw std::out_of_range("gpu_culling: " + std::to_string(objects.size()) + " objects exceed capacity");
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.object_BO);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(culling_object_data) * objects.size(), objects.data());
+}
+
+void update_transforms(indirect_batch& batch, std::vector<glm::fmat4> const& transforms) {
+  if (transforms.size() > std::size_t(batch.capacity)) {
+    throw std::out_of_range("gpu_culling: " + std::to_string(transforms.size()) + " transforms exceed capacity");
+  }
+  // objects beyond the last upload count as changed
+  std::size_t known = std::min(batch.transforms.size(), transforms.size());
+  std::size_t first = 0;
+  while (first < known && transforms[first] == batch.transforms[first]) {
+    ++first;
+  }
+  std::size_t last = transforms.size();
+  while (last > first && last <= known && transforms[last - 1] == batch.transforms[last - 1]) {
+    --last;
+  }
+  batch.transforms = transforms;
+  if (first == last) {
+    return;
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.transform_BO);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, GLintptr(sizeof(glm::fmat4) * first), sizeof(glm::fmat4) * (last - first), &transforms[first]);
+}
+
+void cull(indirect_batch const& batch, GLsizei num_objects, shader_program const& cull_program, glm::fmat4 const& view_projection, glm::fvec3 const& camera_position) {
+  std::vector<glm::fvec4> planes = frustum_planes(view_projection);
+
+  glUniform4fv(cull_program.u_locs.at("frustum_planes"), GLsizei(planes.size()), glm::value_ptr(planes[0]));
+  glUniform3fv(cull_program.u_locs.at("camera_position"), 1, glm::value_ptr(camera_position));
+  glUniform1ui(cull_program.u_locs.at("num_objects"), GLuint(num_objects));
+  glUniform1ui(cull_program.u_locs.at("num_lods"), batch.num_lods);
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, batch.object_BO);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batch.command_BO);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, batch.lod_BO);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, batch.transform_BO);
+
+  GLuint num_groups = (GLuint(num_objects) + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+  glDispatchCompute(num_groups, 1, 1);
+  // commands are read by the indirect draw, transforms by the vertex shader
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void draw(indirect_batch const& batch, GLsizei num_objects, model_object const& mesh) {
+  // vertex shader reads colors and transforms of the objects
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, batch.object_BO);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, batch.transform_BO);
+  glBindVertexArray(mesh.vertex_AO);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.command_BO);
+  // culled objects have an instance count of 0
+  glMultiDrawElementsIndirect(mesh.draw_mode, mesh.index_type, NULL, num_objects, 0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void destroy(indirect_batch& batch) {
+  glDeleteBuffers(1, &batch.object_BO);
+  glDeleteBuffers(1, &batch.transform_BO);
+  glDeleteBuffers(1, &batch.command_BO);
+  glDeleteBuffers(1, &batch.id_BO);
+  glDeleteBuffers(1, &batch.lod_BO);
+  batch = indirect_batch{};
+}
+
+std::vector<glm::fvec4> frustum_planes(glm::fmat4 const& view_projection) {
+  // rows of the matrix, glm is column major
+  glm::fvec4 rows[4];
+  for (int i = 0; i < 4; ++i) {
+    rows[i] = glm::fvec4{view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]};
+  }
+  // left, right, bottom, top, near, far
+  std::vector<glm::fvec4> planes{
+    rows[3] + rows[0], rows[3] - rows[0],
+    rows[3] + rows[1], rows[3] - rows[1],
+    rows[3] + rows[2], rows[3] - rows[2]
+  };
+  // normalize so plane distances are euclidean
+  for (auto& plane : planes) {
+    plane /= glm::length(glm::fvec3{plane});
+  }
+  return planes;
+}
+
+}
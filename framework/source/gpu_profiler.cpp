@@ -0,0 +1,222 @@
+#include "gpu_profiler.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+gpu_profiler::scope::scope(gpu_profiler& profiler, std::string const& name)
+ :m_profiler(profiler)
+{
+  m_profiler.begin(name);
+}
+
+gpu_profiler::scope::~scope() {
+  m_profiler.end();
+}
+
+gpu_profiler::gpu_profiler(std::size_t frame_latency)
+ :m_supported{supported()}
+ ,m_frames(std::max<std::size_t>(frame_latency, 1))
+ ,m_current{0}
+ ,m_open{}
+ ,m_results{}
+ ,m_result_index{}
+ ,m_frame_times{}
+ ,m_dropped{0}
+{
+  for (auto& frame : m_frames) {
+    frame.used = 0;
+    frame.pending = false;
+  }
+}
+
+gpu_profiler::~gpu_profiler() {
+  for (auto& frame : m_frames) {
+    if (!frame.queries.empty()) {
+      glDeleteQueries(GLsizei(frame.queries.size()), frame.queries.data());
+    }
+  }
+}
+
+bool gpu_profiler::supported() {
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  // timestamp queries are core since 3.3
+  return major > 3 || (major == 3 && minor >= 3);
+}
+
+void gpu_profiler::begin_frame() {
+  if (!m_supported) {
+    return;
+  }
+  m_current = (m_current + 1) % m_frames.size();
+  frame_queries& frame = m_frames[m_current];
+  // slot is reused, its results are lost if the gpu has not finished them yet
+  if (frame.pending && !collect(frame)) {
+    ++m_dropped;
+  }
+  frame.used = 0;
+  frame.timers.clear();
+  frame.pending = false;
+  m_open.clear();
+  begin("frame");
+}
+
+void gpu_profiler::end_frame() {
+  if (!m_supported) {
+    return;
+  }
+  // passes left open by an exception end with the frame
+  while (!m_open.empty()) {
+    end();
+  }
+  frame_queries& frame = m_frames[m_current];
+  frame.pending = !frame.timers.empty();
+
+  // read all older frames which are done, the current one is always still in flight
+  for (std::size_t i = 1; i < m_frames.size(); ++i) {
+    frame_queries& older = m_frames[(m_current + i) % m_frames.size()];
+    if (older.pending && collect(older)) {
+      older.pending = false;
+    }
+  }
+}
+
+void gpu_profiler::begin(std::string const& name) {
+  if (!m_supported) {
+    return;
+  }
+  frame_queries& frame = m_frames[m_current];
+  timer t{};
+  t.depth = unsigned(m_open.size());
+  t.parent = m_open.empty() ? std::string{} : frame.timers[m_open.back()].name;
+  // passes directly inside the frame keep their plain name
+  t.name = t.depth <= 1 ? name : t.parent + "/" + name;
+  t.begin_query = timestamp();
+  t.end_query = t.begin_query;
+  m_open.push_back(frame.timers.size());
+  frame.timers.push_back(t);
+}
+
+void gpu_profiler::end() {
+  if (!m_supported || m_open.empty()) {
+    return;
+  }
+  std::size_t index = m_open.back();
+  m_open.pop_back();
+  std::size_t query = timestamp();
+  m_frames[m_current].timers[index].end_query = query;
+}
+
+std::vector<gpu_profiler::pass_timing> gpu_profiler::results() const {
+  return m_results;
+}
+
+std::string gpu_profiler::report() const {
+  std::ostringstream table{};
+  if (!m_supported) {
+    table << "gpu timers: timestamp queries not supported\n";
+    return table.str();
+  }
+  table << std::fixed << std::setprecision(3)
+        << std::left << std::setw(32) << "pass" << std::right
+        << std::setw(10) << "last ms" << std::setw(10) << "avg ms" << std::setw(10) << "max ms" << "\n";
+  for (auto const& pass : m_results) {
+    // indent by nesting, only the last part of the name is shown
+    std::string label = std::string(pass.depth * 2, ' ') + pass.name.substr(pass.name.rfind('/') + 1);
+    table << std::left << std::setw(32) << label << std::right
+          << std::setw(10) << pass.last_ms << std::setw(10) << pass.average_ms << std::setw(10) << pass.max_ms << "\n";
+  }
+  if (m_dropped > 0) {
+    table << m_dropped << " frames dropped, increase the frame latency\n";
+  }
+  return table.str();
+}
+
+std::string gpu_profiler::json() const {
+  std::ostringstream json{};
+  json << "[";
+  for (std::size_t i = 0; i < m_results.size(); ++i) {
+    pass_timing const& pass = m_results[i];
+    // pass names are chosen in code and need no escaping
+    json << (i > 0 ? ", " : "") << "{\"name\": \"" << pass.name << "\""
+         << ", \"mean\": " << pass.average_ms << ", \"max\": " << pass.max_ms
+         << ", \"samples\": " << pass.samples << "}";
+  }
+  json << "]";
+  return json.str();
+}
+
+std::size_t gpu_profiler::dropped_frames() const {
+  return m_dropped;
+}
+
+std::vector<double> gpu_profiler::take_frame_times() {
+  std::vector<double> frame_times{};
+  frame_times.swap(m_frame_times);
+  return frame_times;
+}
+
+std::size_t gpu_profiler::timestamp() {
+  frame_queries& frame = m_frames[m_current];
+  if (frame.used == frame.queries.size()) {
+    // more passes than ever before in this slot, grow its pool
+    std::size_t count = std::max<std::size_t>(frame.queries.size(), 16);
+    frame.queries.resize(frame.queries.size() + count);
+    glGenQueries(GLsizei(count), &frame.queries[frame.queries.size() - count]);
+  }
+  glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+  return frame.used++;
+}
+
+bool gpu_profiler::collect(frame_queries& frame) {
+  // queries finish in order, the last one being available implies all others are
+  GLint available = 0;
+  glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return false;
+  }
+  std::vector<GLuint64> stamps(frame.used);
+  for (std::size_t i = 0; i < frame.used; ++i) {
+    glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &stamps[i]);
+  }
+  for (auto const& t : frame.timers) {
+    double ms = double(stamps[t.end_query] - stamps[t.begin_query]) * 1e-6;
+    pass_timing& pass = result(t);
+    if (t.depth == 0) {
+      m_frame_times.push_back(ms);
+    }
+    pass.last_ms = ms;
+    pass.max_ms = std::max(pass.max_ms, ms);
+    pass.average_ms += (ms - pass.average_ms) / double(++pass.samples);
+  }
+  return true;
+}
+
+gpu_profiler::pass_timing& gpu_profiler::result(timer const& t) {
+  auto found = m_result_index.find(t.name);
+  if (found != m_result_index.end()) {
+    return m_results[found->second];
+  }
+  // keep children below their parent, so the report reads as a tree
+  std::size_t position = m_results.size();
+  auto parent = m_result_index.find(t.parent);
+  if (parent != m_result_index.end()) {
+    position = parent->second + 1;
+    while (position < m_results.size() && m_results[position].depth > m_results[parent->second].depth) {
+      ++position;
+    }
+  }
+  m_results.insert(m_results.begin() + std::ptrdiff_t(position), pass_timing{t.name, t.depth, 0., 0., 0., 0});
+  for (std::size_t i = position; i < m_results.size(); ++i) {
+    m_result_index[m_results[i].name] = i;
+  }
+  return m_results[position];
+}
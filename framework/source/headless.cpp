@@ -0,0 +1,116 @@
+#include "headless.hpp"
+
+#include <glbinding/gl/gl.h>
+#include <glbinding/Binding.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#ifdef FRAMEWORK_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace headless {
+
+bool supported() {
+#ifdef FRAMEWORK_EGL
+  return true;
+#else
+  return false;
+#endif
+}
+
+headless_context initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor, bool debug_context) {
+#ifdef FRAMEWORK_EGL
+  EGLDisplay display = EGL_NO_DISPLAY;
+  // surfaceless platform needs neither X11 nor a gpu
+  char const* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (client_extensions && std::strstr(client_extensions, "EGL_MESA_platform_surfaceless") && get_platform_display) {
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  EGLint egl_major = 0;
+  EGLint egl_minor = 0;
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, &egl_major, &egl_minor)) {
+    throw std::runtime_error("headless: no egl display available");
+  }
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    eglTerminate(display);
+    throw std::runtime_error("headless: egl display does not support desktop OpenGL");
+  }
+
+  EGLint const config_attributes[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_NONE
+  };
+  EGLConfig config = nullptr;
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(display, config_attributes, &config, 1, &num_configs) || num_configs < 1) {
+    eglTerminate(display);
+    throw std::runtime_error("headless: no egl config with pbuffer and depth buffer");
+  }
+
+  // pbuffer provides a regular default framebuffer, so framebuffer 0 stays valid
+  EGLint const surface_attributes[] = {EGL_WIDTH, EGLint(resolution.x), EGL_HEIGHT, EGLint(resolution.y), EGL_NONE};
+  EGLSurface surface = eglCreatePbufferSurface(display, config, surface_attributes);
+
+  // core profile only exists from 3.2 on
+  bool core = ver_major > 3 || (ver_major == 3 && ver_minor >= 2);
+  EGLint const context_attributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION_KHR, EGLint(ver_major),
+    EGL_CONTEXT_MINOR_VERSION_KHR, EGLint(ver_minor),
+    EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, core ? EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR : EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR,
+    EGL_CONTEXT_FLAGS_KHR, debug_context ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0,
+    EGL_NONE
+  };
+  EGLContext context = surface == EGL_NO_SURFACE ? EGL_NO_CONTEXT : eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+  if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+    eglTerminate(display);
+    throw std::runtime_error("headless: could not create OpenGL " + std::to_string(ver_major) + "." + std::to_string(ver_minor) + " context");
+  }
+
+  // glbinding identifies contexts through glx by default, which knows nothing about egl
+  // functions are resolved through the glvnd dispatch shared by glx and egl
+  glbinding::Binding::initialize(glbinding::ContextHandle(reinterpret_cast<std::uintptr_t>(context)), true, true);
+
+  std::cout << "Created headless OpenGL context with version " << glGetString(GL_VERSION)
+            << " on " << glGetString(GL_RENDERER) << std::endl;
+
+  headless_context result{};
+  result.display = display;
+  result.surface = surface;
+  result.context = context;
+  result.resolution = resolution;
+  return result;
+#else
+  (void)resolution; (void)ver_major; (void)ver_minor; (void)debug_context;
+  throw std::runtime_error("headless: framework was built without egl");
+#endif
+}
+
+void close_and_quit(headless_context& context, int status) {
+#ifdef FRAMEWORK_EGL
+  if (context.display) {
+    eglMakeCurrent(context.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(context.display, context.context);
+    eglDestroySurface(context.display, context.surface);
+    eglTerminate(context.display);
+  }
+#endif
+  context = headless_context{};
+  std::exit(status);
+}
+
+}
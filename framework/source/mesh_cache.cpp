@@ -0,0 +1,284 @@
+#include "mesh_cache.hpp"
+
+#include "cpu_profiler.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+static const std::uint64_t ALIGNMENT = 16;
+
+static std::uint64_t align(std::uint64_t offset);
+static std::size_t index_bytes(GLenum index_type);
+
+namespace mesh_cache {
+
+mesh::mesh(std::string const& file_name)
+ :m_file{new obj_parser::mapped_file{file_name}}
+ ,m_packed{}
+ ,m_header{}
+ ,m_vertices{nullptr}
+ ,m_indices{nullptr}
+ ,m_layout{}
+ ,m_lods{}
+{
+  std::size_t size = std::size_t(m_file->end() - m_file->begin());
+  if (size < sizeof(m_header)) {
+    throw std::logic_error("mesh_cache: truncated container " + file_name);
+  }
+  std::memcpy(&m_header, m_file->begin(), sizeof(m_header));
+  if (std::memcmp(m_header.magic, MAGIC, sizeof(m_header.magic)) != 0 || m_header.version != VERSION) {
+    throw std::logic_error("mesh_cache: " + file_name + " is no cooked mesh of version " + std::to_string(VERSION));
+  }
+
+  std::uint64_t lods_begin = sizeof(m_header) + sizeof(attribute_entry) * std::uint64_t(m_header.num_attributes);
+  std::uint64_t entries_end = lods_begin + sizeof(lod_entry) * std::uint64_t(m_header.num_lods);
+  std::uint64_t vertices_end = m_header.vertex_offset + m_header.vertex_num * m_header.vertex_bytes;
+  std::uint64_t indices_end = m_header.index_offset + m_header.index_num * index_bytes(GLenum(m_header.index_type));
+  if (entries_end > size || vertices_end > size || indices_end > size
+   || m_header.vertex_offset % ALIGNMENT != 0 || m_header.index_offset % ALIGNMENT != 0) {
+    throw std::logic_error("mesh_cache: truncated container " + file_name);
+  }
+  for (std::size_t i = 0; i < m_header.num_attributes; ++i) {
+    attribute_entry entry{};
+    std::memcpy(&entry, m_file->begin() + sizeof(m_header) + sizeof(entry) * i, sizeof(entry));
+    m_layout.push_back(model::attribute{model::attrib_flag_t(entry.flag), GLsizei(entry.size), GLsizei(entry.components),
+                                        GLenum(entry.type), entry.normalized != 0});
+    m_layout.back().offset = reinterpret_cast<GLvoid*>(std::uintptr_t(entry.offset));
+  }
+  for (std::size_t i = 0; i < m_header.num_lods; ++i) {
+    lod_entry entry{};
+    std::memcpy(&entry, m_file->begin() + lods_begin + sizeof(entry) * i, sizeof(entry));
+    if (entry.first_index + entry.num_indices > m_header.index_num) {
+      throw std::logic_error("mesh_cache: level of detail outside of the indices in " + file_name);
+    }
+    m_lods.push_back(mesh_simplifier::level{std::size_t(entry.first_index), std::size_t(entry.num_indices), entry.error});
+  }
+  // the mapping is page aligned and both offsets are aligned
+  m_vertices = m_file->begin() + m_header.vertex_offset;
+  m_indices = m_file->begin() + m_header.index_offset;
+}
+
+mesh::mesh(packed_mesh&& source, std::uint64_t source_hash, stamp const& source_stamp, model::attrib_flag_t import_attribs)
+ :m_file{}
+ ,m_packed{std::move(source)}
+ ,m_header{}
+ ,m_vertices{m_packed.vertices.data()}
+ ,m_indices{m_packed.indices.data()}
+ ,m_layout{m_packed.layout}
+ ,m_lods{m_packed.lods}
+{
+  std::memcpy(m_header.magic, MAGIC, sizeof(MAGIC));
+  m_header.version = VERSION;
+  m_header.source_hash = source_hash;
+  m_header.source = source_stamp;
+  m_header.import_attribs = std::uint32_t(import_attribs);
+  for (auto const& attribute : m_layout) {
+    m_header.attributes |= std::uint32_t(attribute.flag);
+  }
+  m_header.vertex_bytes = std::uint32_t(m_packed.vertex_bytes);
+  m_header.num_attributes = std::uint32_t(m_layout.size());
+  m_header.num_lods = std::uint32_t(m_lods.size());
+  m_header.vertex_num = m_packed.vertex_num;
+  m_header.index_num = m_packed.index_num;
+  m_header.index_type = std::uint32_t(m_packed.index_type);
+  m_header.quantized = m_packed.quantized ? 1 : 0;
+  std::copy(&m_packed.position_min[0], &m_packed.position_min[0] + 3, m_header.position_min);
+  std::copy(&m_packed.position_max[0], &m_packed.position_max[0] + 3, m_header.position_max);
+  std::copy(&m_packed.texcoord_min[0], &m_packed.texcoord_min[0] + 2, m_header.texcoord_min);
+  std::copy(&m_packed.texcoord_max[0], &m_packed.texcoord_max[0] + 2, m_header.texcoord_max);
+}
+
+void const* mesh::vertex_data() const {
+  return m_vertices;
+}
+
+std::size_t mesh::vertex_data_size() const {
+  return std::size_t(m_header.vertex_num) * m_header.vertex_bytes;
+}
+
+void const* mesh::index_data() const {
+  return m_indices;
+}
+
+std::size_t mesh::index_data_size() const {
+  return std::size_t(m_header.index_num) * index_bytes(index_type());
+}
+
+std::size_t mesh::num_indices() const {
+  return std::size_t(m_header.index_num);
+}
+
+GLenum mesh::index_type() const {
+  return GLenum(m_header.index_type);
+}
+
+std::size_t mesh::vertex_num() const {
+  return std::size_t(m_header.vertex_num);
+}
+
+std::vector<model::attribute> const& mesh::layout() const {
+  return m_layout;
+}
+
+std::vector<mesh_simplifier::level> const& mesh::lods() const {
+  return m_lods;
+}
+
+model::attrib_flag_t mesh::attributes() const {
+  return model::attrib_flag_t(m_header.attributes);
+}
+
+GLsizei mesh::vertex_bytes() const {
+  return GLsizei(m_header.vertex_bytes);
+}
+
+bool mesh::quantized() const {
+  return m_header.quantized != 0;
+}
+
+glm::fvec3 mesh::position_min() const {
+  return glm::fvec3{m_header.position_min[0], m_header.position_min[1], m_header.position_min[2]};
+}
+
+glm::fvec3 mesh::position_max() const {
+  return glm::fvec3{m_header.position_max[0], m_header.position_max[1], m_header.position_max[2]};
+}
+
+glm::fvec2 mesh::texcoord_min() const {
+  return glm::fvec2{m_header.texcoord_min[0], m_header.texcoord_min[1]};
+}
+
+glm::fvec2 mesh::texcoord_max() const {
+  return glm::fvec2{m_header.texcoord_max[0], m_header.texcoord_max[1]};
+}
+
+std::uint64_t mesh::source_hash() const {
+  return m_header.source_hash;
+}
+
+stamp mesh::source_stamp() const {
+  return m_header.source;
+}
+
+model::attrib_flag_t mesh::import_attribs() const {
+  return model::attrib_flag_t(m_header.import_attribs);
+}
+
+std::uint64_t source_hash(char const* begin, char const* end) {
+  PROFILE_SCOPE("mesh_cache::source_hash");
+  return utils::hash(begin, std::size_t(end - begin));
+}
+
+stamp source_stamp(std::string const& file_name) {
+  struct stat info;
+  if (stat(file_name.c_str(), &info) != 0) {
+    return stamp{0, 0};
+  }
+  // whole seconds miss edits within the second of the last load
+#if defined(_WIN32)
+  std::int64_t nanoseconds = 0;
+  std::int64_t seconds = std::int64_t(info.st_mtime);
+#elif defined(__APPLE__)
+  std::int64_t nanoseconds = std::int64_t(info.st_mtimespec.tv_nsec);
+  std::int64_t seconds = std::int64_t(info.st_mtimespec.tv_sec);
+#else
+  std::int64_t nanoseconds = std::int64_t(info.st_mtim.tv_nsec);
+  std::int64_t seconds = std::int64_t(info.st_mtim.tv_sec);
+#endif
+  return stamp{std::uint64_t(info.st_size), seconds * 1000000000 + nanoseconds};
+}
+
+bool operator==(stamp const& a, stamp const& b) {
+  return a.size == b.size && a.time == b.time;
+}
+
+void write(packed_mesh const& source, std::uint64_t source_hash, stamp const& source_stamp, model::attrib_flag_t import_attribs, std::string const& file_name) {
+  PROFILE_SCOPE("mesh_cache::write");
+  header head{};
+  std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+  head.version = VERSION;
+  head.source_hash = source_hash;
+  head.source = source_stamp;
+  head.import_attribs = std::uint32_t(import_attribs);
+  head.vertex_bytes = std::uint32_t(source.vertex_bytes);
+  head.num_attributes = std::uint32_t(source.layout.size());
+  head.num_lods = std::uint32_t(source.lods.size());
+  head.vertex_num = source.vertex_num;
+  head.index_num = source.index_num;
+  head.index_type = std::uint32_t(source.index_type);
+  head.quantized = source.quantized ? 1 : 0;
+  std::copy(&source.position_min[0], &source.position_min[0] + 3, head.position_min);
+  std::copy(&source.position_max[0], &source.position_max[0] + 3, head.position_max);
+  std::copy(&source.texcoord_min[0], &source.texcoord_min[0] + 2, head.texcoord_min);
+  std::copy(&source.texcoord_max[0], &source.texcoord_max[0] + 2, head.texcoord_max);
+
+  std::vector<attribute_entry> entries{};
+  for (auto const& attribute : source.layout) {
+    head.attributes |= std::uint32_t(attribute.flag);
+    entries.push_back(attribute_entry{std::uint32_t(attribute.flag), std::uint32_t(reinterpret_cast<std::uintptr_t>(attribute.offset)),
+                                      std::uint32_t(attribute.size), std::uint32_t(attribute.components),
+                                      std::uint32_t(attribute.type), attribute.normalized ? 1u : 0u});
+  }
+  std::vector<lod_entry> lods{};
+  for (auto const& level : source.lods) {
+    lods.push_back(lod_entry{level.first_index, level.num_indices, level.error, 0});
+  }
+  std::uint64_t written = sizeof(head) + sizeof(attribute_entry) * entries.size() + sizeof(lod_entry) * lods.size();
+  head.vertex_offset = align(written);
+  head.index_offset = align(head.vertex_offset + source.vertices.size());
+
+  // written next to the container and moved over it when complete, a crash never leaves a partial mesh
+  std::string temporary = utils::temporary_path(file_name);
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    // zero bytes up to the aligned offsets
+    char const padding[ALIGNMENT] = {};
+    file.write(reinterpret_cast<char const*>(&head), sizeof(head));
+    file.write(reinterpret_cast<char const*>(entries.data()), std::streamsize(sizeof(attribute_entry) * entries.size()));
+    file.write(reinterpret_cast<char const*>(lods.data()), std::streamsize(sizeof(lod_entry) * lods.size()));
+    file.write(padding, std::streamsize(head.vertex_offset - written));
+    file.write(reinterpret_cast<char const*>(source.vertices.data()), std::streamsize(source.vertices.size()));
+    file.write(padding, std::streamsize(head.index_offset - head.vertex_offset - source.vertices.size()));
+    file.write(reinterpret_cast<char const*>(source.indices.data()), std::streamsize(source.indices.size()));
+    if (!file) {
+      file.close();
+      std::remove(temporary.c_str());
+      throw std::runtime_error("mesh_cache: could not write " + file_name);
+    }
+  }
+  if (!utils::replace_file(temporary, file_name)) {
+    throw std::runtime_error("mesh_cache: could not write " + file_name);
+  }
+}
+
+void restamp(std::string const& file_name, stamp const& source_stamp) {
+  // only the stamp is overwritten, the rest of the container stays valid
+  std::fstream file(file_name, std::ios::binary | std::ios::in | std::ios::out);
+  if (!file) {
+    throw std::runtime_error("mesh_cache: could not open " + file_name);
+  }
+  file.seekp(std::streamoff(offsetof(header, source)));
+  file.write(reinterpret_cast<char const*>(&source_stamp), sizeof(source_stamp));
+  if (!file) {
+    throw std::runtime_error("mesh_cache: could not write " + file_name);
+  }
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static std::uint64_t align(std::uint64_t offset) {
+  return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+static std::size_t index_bytes(GLenum index_type) {
+  return index_type == model::INDEX_SHORT.type ? sizeof(std::uint16_t) : sizeof(GLuint);
+}
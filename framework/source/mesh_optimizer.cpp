@@ -0,0 +1,324 @@
+#include "mesh_optimizer.hpp"
+
+#include "cpu_profiler.hpp"
+#include "utils.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <numeric>
+
+static const GLuint NONE = ~0u;
+
+static GLuint skip_dead_end(std::vector<GLuint> const& live, std::vector<GLuint>& dead_ends, std::size_t& cursor);
+static glm::fvec3 position(model const& mesh, GLuint vertex);
+static void remap_vertices(model& mesh, std::vector<GLuint> const& remap, std::size_t num_vertices);
+
+namespace mesh_optimizer {
+
+cache_stats analyze(std::vector<GLuint> const& indices, std::size_t vertex_num, std::size_t cache_size) {
+  // a vertex is cached while fewer than cache_size vertices were inserted after it
+  std::vector<std::size_t> timestamps(vertex_num, 0);
+  std::size_t time = cache_size + 1;
+  std::size_t misses = 0;
+  for (GLuint index : indices) {
+    if (time - timestamps[index] > cache_size) {
+      timestamps[index] = time++;
+      ++misses;
+    }
+  }
+  std::size_t referenced = std::size_t(std::count_if(timestamps.begin(), timestamps.end(), [](std::size_t t){ return t > 0; }));
+  cache_stats stats{0.f, 0.f};
+  if (indices.size() >= 3) {
+    stats.acmr = float(double(misses) / double(indices.size() / 3));
+    stats.atvr = float(double(misses) / double(referenced));
+  }
+  return stats;
+}
+
+std::size_t weld(model& mesh) {
+  PROFILE_SCOPE("mesh_optimizer::weld");
+  std::size_t stride = std::size_t(mesh.vertex_bytes) / sizeof(GLfloat);
+  std::size_t vertex_bytes = std::size_t(mesh.vertex_bytes);
+  // open addressing table of first vertices with each content
+  std::size_t table_size = 1;
+  while (table_size < mesh.vertex_num * 2) {
+    table_size *= 2;
+  }
+  std::vector<GLuint> table(table_size, NONE);
+  std::vector<GLuint> remap(mesh.vertex_num);
+  std::size_t unique = 0;
+  for (std::size_t v = 0; v < mesh.vertex_num; ++v) {
+    GLfloat const* vertex = &mesh.data[v * stride];
+    std::size_t slot = std::size_t(utils::hash(vertex, vertex_bytes)) & (table_size - 1);
+    while (table[slot] != NONE && std::memcmp(&mesh.data[table[slot] * stride], vertex, vertex_bytes) != 0) {
+      slot = (slot + 1) & (table_size - 1);
+    }
+    if (table[slot] == NONE) {
+      // first occurrences keep their order, so they can be moved down in place
+      table[slot] = GLuint(unique);
+      std::copy(vertex, vertex + stride, &mesh.data[unique * stride]);
+      ++unique;
+    }
+    remap[v] = table[slot];
+  }
+  for (GLuint& index : mesh.indices) {
+    index = remap[index];
+  }
+  std::size_t welded = mesh.vertex_num - unique;
+  mesh.data.resize(unique * stride);
+  mesh.vertex_num = unique;
+  return welded;
+}
+
+void optimize_cache(std::vector<GLuint>& indices, std::size_t vertex_num, std::size_t cache_size) {
+  PROFILE_SCOPE("mesh_optimizer::optimize_cache");
+  std::size_t num_triangles = indices.size() / 3;
+  // triangles around every vertex, live counts those not emitted yet
+  std::vector<GLuint> live(vertex_num, 0);
+  for (std::size_t i = 0; i < num_triangles * 3; ++i) {
+    ++live[indices[i]];
+  }
+  std::vector<GLuint> first_adjacent(vertex_num + 1, 0);
+  std::partial_sum(live.begin(), live.end(), first_adjacent.begin() + 1);
+  std::vector<GLuint> adjacency(num_triangles * 3);
+  std::vector<GLuint> fill(first_adjacent.begin(), first_adjacent.end() - 1);
+  for (std::size_t i = 0; i < num_triangles * 3; ++i) {
+    adjacency[fill[indices[i]]++] = GLuint(i / 3);
+  }
+
+  std::vector<std::size_t> timestamps(vertex_num, 0);
+  std::size_t time = cache_size + 1;
+  std::vector<bool> emitted(num_triangles, false);
+  std::vector<GLuint> dead_ends{};
+  std::vector<GLuint> candidates{};
+  std::vector<GLuint> result{};
+  result.reserve(num_triangles * 3);
+  std::size_t cursor = 0;
+
+  GLuint fanning = skip_dead_end(live, dead_ends, cursor);
+  while (fanning != NONE) {
+    // emit all remaining triangles around the fanning vertex
+    candidates.clear();
+    for (GLuint k = first_adjacent[fanning]; k < first_adjacent[fanning + 1]; ++k) {
+      GLuint triangle = adjacency[k];
+      if (emitted[triangle]) {
+        continue;
+      }
+      for (std::size_t c = 0; c < 3; ++c) {
+        GLuint v = indices[triangle * 3 + c];
+        result.push_back(v);
+        dead_ends.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time - timestamps[v] > cache_size) {
+          timestamps[v] = time++;
+        }
+      }
+      emitted[triangle] = true;
+    }
+
+    // oldest candidate which is still cached after emitting its remaining triangles
+    GLuint next = NONE;
+    std::size_t best_priority = 0;
+    for (GLuint v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      std::size_t priority = 0;
+      if (time - timestamps[v] + 2 * live[v] <= cache_size) {
+        priority = time - timestamps[v];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        next = v;
+      }
+    }
+    fanning = next != NONE ? next : skip_dead_end(live, dead_ends, cursor);
+  }
+  // degenerate leftovers of an index count not divisible by 3 are dropped
+  indices.swap(result);
+}
+
+std::size_t optimize_overdraw(model& mesh, std::size_t cache_size, float threshold) {
+  PROFILE_SCOPE("mesh_optimizer::optimize_overdraw");
+  std::vector<GLuint>& indices = mesh.indices;
+  std::size_t num_triangles = indices.size() / 3;
+  if (num_triangles == 0) {
+    return 0;
+  }
+
+  // cache misses of each triangle, simulated from a cold cache at every reset
+  std::vector<std::size_t> timestamps(mesh.vertex_num, 0);
+  std::size_t time = cache_size + 1;
+  auto misses = [&](std::size_t triangle) {
+    unsigned count = 0;
+    for (std::size_t c = 0; c < 3; ++c) {
+      GLuint v = indices[triangle * 3 + c];
+      if (time - timestamps[v] > cache_size) {
+        timestamps[v] = time++;
+        ++count;
+      }
+    }
+    return count;
+  };
+  auto reset = [&]() {
+    time += cache_size + 1;
+  };
+
+  // hard boundaries where the cache order jumped to an unrelated part of the mesh
+  std::vector<std::size_t> hard{0};
+  for (std::size_t t = 0; t < num_triangles; ++t) {
+    if (misses(t) == 3 && t > 0) {
+      hard.push_back(t);
+    }
+  }
+  hard.push_back(num_triangles);
+
+  // split further as soon as a cluster reached the acmr of its hard cluster within threshold
+  std::vector<std::size_t> clusters{};
+  for (std::size_t h = 0; h + 1 < hard.size(); ++h) {
+    reset();
+    std::size_t cluster_misses = 0;
+    for (std::size_t t = hard[h]; t < hard[h + 1]; ++t) {
+      cluster_misses += misses(t);
+    }
+    float cluster_threshold = threshold * float(cluster_misses) / float(hard[h + 1] - hard[h]);
+
+    reset();
+    clusters.push_back(hard[h]);
+    std::size_t running_misses = 0;
+    std::size_t running_triangles = 0;
+    for (std::size_t t = hard[h]; t + 1 < hard[h + 1]; ++t) {
+      running_misses += misses(t);
+      ++running_triangles;
+      if (float(running_misses) <= cluster_threshold * float(running_triangles)) {
+        clusters.push_back(t + 1);
+        running_misses = 0;
+        running_triangles = 0;
+        reset();
+      }
+    }
+  }
+  clusters.push_back(num_triangles);
+  std::size_t num_clusters = clusters.size() - 1;
+
+  // area weighted centroid and normal of every cluster and the whole mesh
+  std::vector<glm::fvec3> centroids(num_clusters, glm::fvec3{0.f});
+  std::vector<glm::fvec3> normals(num_clusters, glm::fvec3{0.f});
+  std::vector<float> areas(num_clusters, 0.f);
+  glm::fvec3 mesh_centroid{0.f};
+  float mesh_area = 0.f;
+  for (std::size_t c = 0; c < num_clusters; ++c) {
+    for (std::size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+      glm::fvec3 p0 = position(mesh, indices[t * 3]);
+      glm::fvec3 p1 = position(mesh, indices[t * 3 + 1]);
+      glm::fvec3 p2 = position(mesh, indices[t * 3 + 2]);
+      glm::fvec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float area = glm::length(normal);
+      centroids[c] += (p0 + p1 + p2) * (area / 3.f);
+      normals[c] += normal;
+      areas[c] += area;
+    }
+    mesh_centroid += centroids[c];
+    mesh_area += areas[c];
+    if (areas[c] > 0.f) {
+      centroids[c] /= areas[c];
+    }
+  }
+  if (mesh_area > 0.f) {
+    mesh_centroid /= mesh_area;
+  }
+
+  // clusters far out along their normal occlude the others, draw them first
+  std::vector<float> sort_keys(num_clusters, 0.f);
+  for (std::size_t c = 0; c < num_clusters; ++c) {
+    float length = glm::length(normals[c]);
+    if (length > 0.f) {
+      sort_keys[c] = glm::dot(centroids[c] - mesh_centroid, normals[c] / length);
+    }
+  }
+  std::vector<std::size_t> order(num_clusters);
+  std::iota(order.begin(), order.end(), std::size_t(0));
+  std::stable_sort(order.begin(), order.end(), [&sort_keys](std::size_t a, std::size_t b){
+    return sort_keys[a] > sort_keys[b];
+  });
+
+  std::vector<GLuint> result{};
+  result.reserve(num_triangles * 3);
+  for (std::size_t c : order) {
+    result.insert(result.end(), indices.begin() + std::ptrdiff_t(clusters[c] * 3), indices.begin() + std::ptrdiff_t(clusters[c + 1] * 3));
+  }
+  indices.swap(result);
+  return num_clusters;
+}
+
+void optimize_fetch(model& mesh) {
+  PROFILE_SCOPE("mesh_optimizer::optimize_fetch");
+  std::vector<GLuint> remap(mesh.vertex_num, NONE);
+  GLuint next = 0;
+  for (GLuint& index : mesh.indices) {
+    if (remap[index] == NONE) {
+      remap[index] = next++;
+    }
+    index = remap[index];
+  }
+  remap_vertices(mesh, remap, next);
+}
+
+report optimize(model& mesh, options const& opts) {
+  PROFILE_SCOPE("mesh_optimizer::optimize");
+  report result{};
+  result.before = analyze(mesh.indices, mesh.vertex_num, opts.cache_size);
+  if (opts.weld) {
+    result.welded_vertices = weld(mesh);
+  }
+  optimize_cache(mesh.indices, mesh.vertex_num, opts.cache_size);
+  result.clusters = optimize_overdraw(mesh, opts.cache_size, opts.overdraw_threshold);
+  optimize_fetch(mesh);
+  result.after = analyze(mesh.indices, mesh.vertex_num, opts.cache_size);
+  return result;
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// most recently used vertex with remaining triangles, otherwise the next one in input order
+static GLuint skip_dead_end(std::vector<GLuint> const& live, std::vector<GLuint>& dead_ends, std::size_t& cursor) {
+  while (!dead_ends.empty()) {
+    GLuint vertex = dead_ends.back();
+    dead_ends.pop_back();
+    if (live[vertex] > 0) {
+      return vertex;
+    }
+  }
+  for (; cursor < live.size(); ++cursor) {
+    if (live[cursor] > 0) {
+      return GLuint(cursor);
+    }
+  }
+  return NONE;
+}
+
+static glm::fvec3 position(model const& mesh, GLuint vertex) {
+  std::size_t stride = std::size_t(mesh.vertex_bytes) / sizeof(GLfloat);
+  std::size_t offset = reinterpret_cast<std::uintptr_t>(mesh.offsets.at(model::POSITION)) / sizeof(GLfloat);
+  GLfloat const* p = &mesh.data[vertex * stride + offset];
+  return glm::fvec3{p[0], p[1], p[2]};
+}
+
+// move vertex i to remap[i], vertices mapped to NONE are dropped
+static void remap_vertices(model& mesh, std::vector<GLuint> const& remap, std::size_t num_vertices) {
+  std::size_t stride = std::size_t(mesh.vertex_bytes) / sizeof(GLfloat);
+  std::vector<GLfloat> data(num_vertices * stride);
+  for (std::size_t v = 0; v < mesh.vertex_num; ++v) {
+    if (remap[v] != NONE) {
+      std::copy(&mesh.data[v * stride], &mesh.data[v * stride] + stride, &data[remap[v] * stride]);
+    }
+  }
+  mesh.data.swap(data);
+  mesh.vertex_num = num_vertices;
+}
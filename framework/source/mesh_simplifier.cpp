@@ -0,0 +1,493 @@
+#include "mesh_simplifier.hpp"
+
+#include "cpu_profiler.hpp"
+#include "mesh_optimizer.hpp"
+#include "utils.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+static const GLuint NONE = ~0u;
+// weight of the planes through boundaries and seams, relative to the surface planes
+static const double BOUNDARY_WEIGHT = 10.0;
+// larger rotations of a triangle normal count as a flip, cosine of about 75 degrees
+static const float MAX_ROTATION = 0.25f;
+
+// how a vertex may be collapsed onto a neighbour
+enum class vertex_kind : std::uint8_t {
+  // interior vertex, onto any neighbour
+  manifold,
+  // on an open boundary, only along it
+  border,
+  // one of the two vertices at a seam position, both move along the seam together
+  seam,
+  // corners, ends of seams, non-manifold vertices and those shared by more than two sides of a seam stay
+  locked
+};
+
+// plane distance quadric, a is symmetric
+struct quadric {
+  double a00, a11, a22, a01, a02, a12;
+  double b0, b1, b2;
+  double c;
+  // summed area of the planes, errors are averaged by it
+  double weight;
+};
+
+// triangles around every vertex
+struct adjacency {
+  std::vector<GLuint> first;
+  std::vector<GLuint> triangles;
+};
+
+struct collapse {
+  GLuint from;
+  GLuint to;
+  double cost;
+};
+
+static std::vector<glm::fvec3> positions(model const& mesh);
+static float extent(std::vector<glm::fvec3> const& points);
+static std::vector<GLuint> position_groups(std::vector<glm::fvec3> const& points, std::vector<GLuint> const& indices, std::vector<GLuint>& next_wedge);
+static void build_adjacency(std::vector<GLuint> const& indices, std::size_t vertex_num, adjacency& adjacent);
+static bool has_edge(std::vector<GLuint> const& indices, adjacency const& adjacent, GLuint from, GLuint to);
+static bool has_position_edge(std::vector<GLuint> const& indices, adjacency const& adjacent, std::vector<GLuint> const& group,
+                              std::vector<GLuint> const& next_wedge, GLuint from, GLuint to);
+static void add_plane(quadric& q, glm::dvec3 const& normal, double distance, double weight);
+static void add(quadric& q, quadric const& other);
+static double evaluate(quadric const& q, glm::fvec3 const& point);
+
+namespace mesh_simplifier {
+
+std::vector<GLuint> simplify(model const& mesh, std::vector<GLuint> const& indices, std::size_t target_triangles,
+                             float target_error, float* result_error, bool lock_border) {
+  PROFILE_SCOPE("mesh_simplifier::simplify");
+  std::size_t vertex_num = mesh.vertex_num;
+  std::vector<glm::fvec3> points = positions(mesh);
+  float mesh_extent = extent(points);
+  double error_limit = double(target_error) * double(mesh_extent) * double(target_error) * double(mesh_extent);
+
+  std::vector<GLuint> result(indices.begin(), indices.begin() + std::ptrdiff_t(indices.size() / 3 * 3));
+  std::size_t num_triangles = result.size() / 3;
+  adjacency adjacent{};
+  build_adjacency(result, vertex_num, adjacent);
+
+  // vertices at one position are wedges of it, the first one stands for the position
+  std::vector<GLuint> next_wedge(vertex_num, NONE);
+  std::vector<GLuint> group = position_groups(points, result, next_wedge);
+  std::vector<GLuint> group_size(vertex_num, 0);
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    if (group[v] != NONE) {
+      ++group_size[group[v]];
+    }
+  }
+
+  // a position edge without its reverse lies on an open boundary, an attribute edge without
+  // its reverse on a boundary or a seam, also where a seam ends at a single vertex
+  std::vector<GLuint> border_out(vertex_num, 0);
+  std::vector<GLuint> border_in(vertex_num, 0);
+  std::vector<GLuint> open_edges(vertex_num, 0);
+  std::vector<bool> open(result.size(), false);
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    GLuint a = result[i];
+    GLuint b = result[i - i % 3 + (i + 1) % 3];
+    if (!has_position_edge(result, adjacent, group, next_wedge, group[b], group[a])) {
+      ++border_out[group[a]];
+      ++border_in[group[b]];
+    }
+    if (!has_edge(result, adjacent, b, a)) {
+      ++open_edges[a];
+      ++open_edges[b];
+      open[i] = true;
+    }
+  }
+  std::vector<vertex_kind> kinds(vertex_num, vertex_kind::locked);
+  for (std::size_t v = 0; v < vertex_num; ++v) {
+    GLuint g = group[v];
+    if (g == NONE) {
+      continue;
+    }
+    bool border = border_out[g] + border_in[g] > 0;
+    if (group_size[g] == 1 && open_edges[v] == 0) {
+      kinds[v] = vertex_kind::manifold;
+    }
+    // vertices with more than one boundary passing through are corners
+    else if (group_size[g] == 1 && border_out[g] == 1 && border_in[g] == 1 && open_edges[v] == 2 && !lock_border) {
+      kinds[v] = vertex_kind::border;
+    }
+    else if (group_size[g] == 2 && !border) {
+      kinds[v] = vertex_kind::seam;
+    }
+  }
+
+  // area weighted planes of the triangles around every position, boundaries and seams add planes
+  // perpendicular to the surface so they keep their course
+  std::vector<quadric> quadrics(vertex_num, quadric{});
+  for (std::size_t t = 0; t < num_triangles; ++t) {
+    GLuint const* triangle = &result[t * 3];
+    glm::dvec3 p0{points[triangle[0]]};
+    glm::dvec3 normal = glm::cross(glm::dvec3{points[triangle[1]]} - p0, glm::dvec3{points[triangle[2]]} - p0);
+    double area = glm::length(normal);
+    if (area == 0.0) {
+      continue;
+    }
+    normal /= area;
+    for (std::size_t c = 0; c < 3; ++c) {
+      add_plane(quadrics[group[triangle[c]]], normal, -glm::dot(normal, p0), area * 0.5);
+    }
+    for (std::size_t c = 0; c < 3; ++c) {
+      if (!open[t * 3 + c]) {
+        continue;
+      }
+      GLuint a = triangle[c];
+      GLuint b = triangle[(c + 1) % 3];
+      glm::dvec3 edge = glm::dvec3{points[b]} - glm::dvec3{points[a]};
+      glm::dvec3 perpendicular = glm::cross(edge, normal);
+      double length = glm::length(perpendicular);
+      if (length == 0.0) {
+        continue;
+      }
+      perpendicular /= length;
+      double distance = -glm::dot(perpendicular, glm::dvec3{points[a]});
+      add_plane(quadrics[group[a]], perpendicular, distance, glm::dot(edge, edge) * BOUNDARY_WEIGHT);
+      add_plane(quadrics[group[b]], perpendicular, distance, glm::dot(edge, edge) * BOUNDARY_WEIGHT);
+    }
+  }
+
+  // seam vertices need a seam edge on both sides, the other wedge of from collapses onto the other wedge of to
+  auto allowed = [&](GLuint from, GLuint to) {
+    if (group[from] == group[to]) {
+      return false;
+    }
+    switch (kinds[from]) {
+      case vertex_kind::manifold:
+        return true;
+      case vertex_kind::border:
+        return !has_position_edge(result, adjacent, group, next_wedge, group[to], group[from])
+            || !has_position_edge(result, adjacent, group, next_wedge, group[from], group[to]);
+      case vertex_kind::seam:
+        return group_size[group[to]] == 2 && (has_edge(result, adjacent, next_wedge[from], next_wedge[to])
+                                           || has_edge(result, adjacent, next_wedge[to], next_wedge[from]));
+      default:
+        return false;
+    }
+  };
+  auto cost = [&](GLuint from, GLuint to) {
+    quadric merged = quadrics[group[to]];
+    add(merged, quadrics[group[from]]);
+    return evaluate(merged, points[to]);
+  };
+
+  double max_cost = 0.0;
+  while (num_triangles > target_triangles) {
+    // cheaper direction of every edge, edges shared by two triangles are visited once
+    std::vector<collapse> candidates{};
+    for (std::size_t t = 0; t < num_triangles; ++t) {
+      for (std::size_t c = 0; c < 3; ++c) {
+        GLuint a = result[t * 3 + c];
+        GLuint b = result[t * 3 + (c + 1) % 3];
+        if (a > b && has_edge(result, adjacent, b, a)) {
+          continue;
+        }
+        collapse best{NONE, NONE, std::numeric_limits<double>::max()};
+        if (allowed(a, b)) {
+          best = collapse{a, b, cost(a, b)};
+        }
+        if (allowed(b, a)) {
+          double reverse = cost(b, a);
+          if (reverse < best.cost) {
+            best = collapse{b, a, reverse};
+          }
+        }
+        if (best.from != NONE && best.cost <= error_limit) {
+          candidates.push_back(best);
+        }
+      }
+    }
+    if (candidates.empty()) {
+      break;
+    }
+    std::sort(candidates.begin(), candidates.end(), [](collapse const& a, collapse const& b){
+      return a.cost < b.cost;
+    });
+
+    // every collapse removes about two triangles, only the cheapest of those needed are taken in one pass
+    std::size_t goal = num_triangles - target_triangles;
+    std::size_t limit_index = std::min(candidates.size(), std::max<std::size_t>(goal / 2, 1)) - 1;
+    double pass_limit = candidates[limit_index].cost * 1.5;
+
+    std::vector<GLuint> remap(vertex_num);
+    std::iota(remap.begin(), remap.end(), GLuint(0));
+    // positions whose triangles changed in this pass, the costs around them are outdated
+    std::vector<bool> locked(vertex_num, false);
+    std::size_t removed = 0;
+    std::size_t collapses = 0;
+    for (collapse const& candidate : candidates) {
+      if (removed >= goal || (candidate.cost > pass_limit && collapses > 0)) {
+        break;
+      }
+      GLuint from_group = group[candidate.from];
+      GLuint to_group = group[candidate.to];
+      if (locked[from_group] || locked[to_group]) {
+        continue;
+      }
+      GLuint wedges[2] = {candidate.from, NONE};
+      GLuint targets[2] = {candidate.to, NONE};
+      if (kinds[candidate.from] == vertex_kind::seam) {
+        wedges[1] = next_wedge[candidate.from];
+        targets[1] = next_wedge[candidate.to];
+      }
+
+      // triangles with both ends degenerate, the others may not flip
+      bool flips = false;
+      std::size_t degenerate = 0;
+      glm::fvec3 target = points[candidate.to];
+      for (std::size_t w = 0; w < 2 && wedges[w] != NONE && !flips; ++w) {
+        for (GLuint k = adjacent.first[wedges[w]]; k < adjacent.first[wedges[w] + 1]; ++k) {
+          GLuint const* triangle = &result[adjacent.triangles[k] * 3];
+          if (group[triangle[0]] == to_group || group[triangle[1]] == to_group || group[triangle[2]] == to_group) {
+            ++degenerate;
+            continue;
+          }
+          glm::fvec3 before[3] = {points[triangle[0]], points[triangle[1]], points[triangle[2]]};
+          glm::fvec3 after[3] = {before[0], before[1], before[2]};
+          for (std::size_t c = 0; c < 3; ++c) {
+            if (triangle[c] == wedges[w]) {
+              after[c] = target;
+            }
+          }
+          glm::fvec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+          glm::fvec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+          if (glm::dot(normal_before, normal_after) < MAX_ROTATION * glm::length(normal_before) * glm::length(normal_after)) {
+            flips = true;
+            break;
+          }
+        }
+      }
+      if (flips) {
+        continue;
+      }
+
+      for (std::size_t w = 0; w < 2 && wedges[w] != NONE; ++w) {
+        remap[wedges[w]] = targets[w];
+        for (GLuint k = adjacent.first[wedges[w]]; k < adjacent.first[wedges[w] + 1]; ++k) {
+          for (std::size_t c = 0; c < 3; ++c) {
+            locked[group[result[adjacent.triangles[k] * 3 + c]]] = true;
+          }
+        }
+      }
+      locked[to_group] = true;
+      add(quadrics[to_group], quadrics[from_group]);
+      max_cost = std::max(max_cost, candidate.cost);
+      removed += degenerate;
+      ++collapses;
+    }
+    if (collapses == 0) {
+      break;
+    }
+
+    // triangles with two corners at one position are gone
+    std::vector<GLuint> remaining{};
+    remaining.reserve(result.size());
+    for (std::size_t t = 0; t < num_triangles; ++t) {
+      GLuint a = remap[result[t * 3]];
+      GLuint b = remap[result[t * 3 + 1]];
+      GLuint c = remap[result[t * 3 + 2]];
+      if (group[a] != group[b] && group[b] != group[c] && group[c] != group[a]) {
+        remaining.push_back(a);
+        remaining.push_back(b);
+        remaining.push_back(c);
+      }
+    }
+    result.swap(remaining);
+    num_triangles = result.size() / 3;
+    build_adjacency(result, vertex_num, adjacent);
+  }
+
+  if (result_error != nullptr) {
+    *result_error = mesh_extent > 0.f ? float(std::sqrt(max_cost)) / mesh_extent : 0.f;
+  }
+  return result;
+}
+
+lod_chain build_chain(model const& mesh, options const& opts) {
+  PROFILE_SCOPE("mesh_simplifier::build_chain");
+  lod_chain chain{};
+  chain.indices = mesh.indices;
+  chain.levels.push_back(level{0, mesh.indices.size(), 0.f});
+  float mesh_extent = extent(positions(mesh));
+
+  std::vector<GLuint> current = mesh.indices;
+  float error = 0.f;
+  while (chain.levels.size() < opts.max_levels && error < opts.max_error) {
+    std::size_t num_triangles = current.size() / 3;
+    std::size_t target = std::size_t(float(num_triangles) * opts.ratio);
+    if (target < opts.min_triangles) {
+      break;
+    }
+    float level_error = 0.f;
+    std::vector<GLuint> simplified = simplify(mesh, current, target, opts.max_error - error, &level_error, opts.lock_border);
+    // the error budget or locked vertices stopped it before a noticeable reduction
+    if (simplified.size() / 3 > num_triangles - num_triangles / 10) {
+      break;
+    }
+    // every level is simplified from the one before, so their errors add up
+    error += level_error;
+    mesh_optimizer::optimize_cache(simplified, mesh.vertex_num, mesh_optimizer::options{}.cache_size);
+    chain.levels.push_back(level{chain.indices.size(), simplified.size(), error * mesh_extent});
+    chain.indices.insert(chain.indices.end(), simplified.begin(), simplified.end());
+    current.swap(simplified);
+  }
+  return chain;
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static std::vector<glm::fvec3> positions(model const& mesh) {
+  std::size_t stride = std::size_t(mesh.vertex_bytes) / sizeof(GLfloat);
+  std::size_t offset = reinterpret_cast<std::uintptr_t>(mesh.offsets.at(model::POSITION)) / sizeof(GLfloat);
+  std::vector<glm::fvec3> points(mesh.vertex_num);
+  for (std::size_t v = 0; v < mesh.vertex_num; ++v) {
+    GLfloat const* p = &mesh.data[v * stride + offset];
+    points[v] = glm::fvec3{p[0], p[1], p[2]};
+  }
+  return points;
+}
+
+// largest side of the bounding box
+static float extent(std::vector<glm::fvec3> const& points) {
+  if (points.empty()) {
+    return 0.f;
+  }
+  glm::fvec3 lower = points.front();
+  glm::fvec3 upper = points.front();
+  for (glm::fvec3 const& point : points) {
+    lower = glm::min(lower, point);
+    upper = glm::max(upper, point);
+  }
+  glm::fvec3 size = upper - lower;
+  return std::max(size.x, std::max(size.y, size.z));
+}
+
+// first referenced vertex with the same position bits, NONE for unreferenced vertices,
+// next_wedge links the vertices of a position in a ring
+static std::vector<GLuint> position_groups(std::vector<glm::fvec3> const& points, std::vector<GLuint> const& indices, std::vector<GLuint>& next_wedge) {
+  std::size_t table_size = 1;
+  while (table_size < points.size() * 2) {
+    table_size *= 2;
+  }
+  std::vector<GLuint> table(table_size, NONE);
+  std::vector<GLuint> group(points.size(), NONE);
+  for (GLuint index : indices) {
+    if (group[index] != NONE) {
+      continue;
+    }
+    std::size_t slot = std::size_t(utils::hash(&points[index], sizeof(glm::fvec3))) & (table_size - 1);
+    while (table[slot] != NONE && std::memcmp(&points[table[slot]], &points[index], sizeof(glm::fvec3)) != 0) {
+      slot = (slot + 1) & (table_size - 1);
+    }
+    if (table[slot] == NONE) {
+      table[slot] = index;
+      next_wedge[index] = index;
+    }
+    else {
+      // insert behind the first wedge
+      GLuint first = table[slot];
+      next_wedge[index] = next_wedge[first];
+      next_wedge[first] = index;
+    }
+    group[index] = table[slot];
+  }
+  return group;
+}
+
+static void build_adjacency(std::vector<GLuint> const& indices, std::size_t vertex_num, adjacency& adjacent) {
+  adjacent.first.assign(vertex_num + 1, 0);
+  for (GLuint index : indices) {
+    ++adjacent.first[index + 1];
+  }
+  std::partial_sum(adjacent.first.begin(), adjacent.first.end(), adjacent.first.begin());
+  adjacent.triangles.resize(indices.size());
+  std::vector<GLuint> fill(adjacent.first.begin(), adjacent.first.end() - 1);
+  for (std::size_t i = 0; i < indices.size(); ++i) {
+    adjacent.triangles[fill[indices[i]]++] = GLuint(i / 3);
+  }
+}
+
+// the triangles are in cache order, so those around a vertex are close together
+static bool has_edge(std::vector<GLuint> const& indices, adjacency const& adjacent, GLuint from, GLuint to) {
+  for (GLuint k = adjacent.first[from]; k < adjacent.first[from + 1]; ++k) {
+    GLuint const* triangle = &indices[adjacent.triangles[k] * 3];
+    if ((triangle[0] == from && triangle[1] == to) || (triangle[1] == from && triangle[2] == to) || (triangle[2] == from && triangle[0] == to)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// edge between any wedges of two positions
+static bool has_position_edge(std::vector<GLuint> const& indices, adjacency const& adjacent, std::vector<GLuint> const& group,
+                              std::vector<GLuint> const& next_wedge, GLuint from, GLuint to) {
+  GLuint wedge = from;
+  do {
+    for (GLuint k = adjacent.first[wedge]; k < adjacent.first[wedge + 1]; ++k) {
+      GLuint const* triangle = &indices[adjacent.triangles[k] * 3];
+      for (std::size_t c = 0; c < 3; ++c) {
+        if (triangle[c] == wedge && group[triangle[(c + 1) % 3]] == to) {
+          return true;
+        }
+      }
+    }
+    wedge = next_wedge[wedge];
+  } while (wedge != from);
+  return false;
+}
+
+// squared distance to the plane dot(normal, x) + distance = 0
+static void add_plane(quadric& q, glm::dvec3 const& normal, double distance, double weight) {
+  q.a00 += weight * normal.x * normal.x;
+  q.a11 += weight * normal.y * normal.y;
+  q.a22 += weight * normal.z * normal.z;
+  q.a01 += weight * normal.x * normal.y;
+  q.a02 += weight * normal.x * normal.z;
+  q.a12 += weight * normal.y * normal.z;
+  q.b0 += weight * normal.x * distance;
+  q.b1 += weight * normal.y * distance;
+  q.b2 += weight * normal.z * distance;
+  q.c += weight * distance * distance;
+  q.weight += weight;
+}
+
+static void add(quadric& q, quadric const& other) {
+  q.a00 += other.a00;
+  q.a11 += other.a11;
+  q.a22 += other.a22;
+  q.a01 += other.a01;
+  q.a02 += other.a02;
+  q.a12 += other.a12;
+  q.b0 += other.b0;
+  q.b1 += other.b1;
+  q.b2 += other.b2;
+  q.c += other.c;
+  q.weight += other.weight;
+}
+
+// weighted mean squared distance to the planes
+static double evaluate(quadric const& q, glm::fvec3 const& point) {
+  double x = point.x;
+  double y = point.y;
+  double z = point.z;
+  double error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+               + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+               + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+  return q.weight > 0.0 ? std::max(error, 0.0) / q.weight : 0.0;
+}
@@ -19,6 +19,10 @@ model::attribute const& model::TEXCOORD = model::VERTEX_ATTRIBS[2];
 model::attribute const& model::TANGENT = model::VERTEX_ATTRIBS[3];
 model::attribute const& model::BITANGENT = model::VERTEX_ATTRIBS[4];
 model::attribute const  model::INDEX{1 << 5, sizeof(unsigned),  1, GL_UNSIGNED_INT};
+model::attribute const  model::POSITION_UNORM16{1 << 0, sizeof(std::uint16_t), 3, GL_UNSIGNED_SHORT, true};
+model::attribute const  model::NORMAL_OCT16{    1 << 1, sizeof(std::int16_t),  2, GL_SHORT,          true};
+model::attribute const  model::TEXCOORD_UNORM16{1 << 2, sizeof(std::uint16_t), 2, GL_UNSIGNED_SHORT, true};
+model::attribute const  model::INDEX_SHORT{1 << 5, sizeof(std::uint16_t), 1, GL_UNSIGNED_SHORT};
 
 model::model()
  :data{}
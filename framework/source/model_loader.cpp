@@ -1,10 +1,17 @@
 #include "model_loader.hpp"
 
+#include "cpu_profiler.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "obj_parser.hpp"
+#include "vertex_format.hpp"
+
 // use floats and med precision operations
 #include <glm/gtc/type_precision.hpp>
 #include <glm/geometric.hpp>
 
 #include <iostream>
+#include <stdexcept>
 
 namespace model_loader {
 
@@ -12,7 +19,88 @@ void generate_normals(tinyobj::mesh_t& model);
 
 std::vector<glm::fvec3> generate_tangents(tinyobj::mesh_t const& model);
 
-model obj(std::string const& name, model::attrib_flag_t import_attribs){
+model obj(std::string const& name, thread_pool& pool, model::attrib_flag_t import_attribs){
+  PROFILE_SCOPE("model_loader::obj");
+  return obj_parser::load(name, import_attribs, pool);
+}
+
+std::unique_ptr<mesh_cache::mesh> cached_obj(std::string const& name, thread_pool& pool, model::attrib_flag_t import_attribs, bool quantize){
+  PROFILE_SCOPE("model_loader::cached_obj");
+  std::string cooked_name = cooked_path(name);
+  std::unique_ptr<mesh_cache::mesh> cooked{};
+  try {
+    cooked.reset(new mesh_cache::mesh{cooked_name});
+  }
+  catch (std::exception const&) {
+    // missing or from an older version, cooked again below
+  }
+  if (cooked && (cooked->import_attribs() != import_attribs || cooked->quantized() != quantize)) {
+    cooked.reset();
+  }
+  // an untouched source skips hashing
+  mesh_cache::stamp source_stamp = mesh_cache::source_stamp(name);
+  if (cooked && cooked->source_stamp() == source_stamp) {
+    return cooked;
+  }
+
+  obj_parser::mapped_file source{name};
+  std::uint64_t source_hash = mesh_cache::source_hash(source.begin(), source.end());
+  if (cooked && cooked->source_hash() == source_hash) {
+    try {
+      mesh_cache::restamp(cooked_name, source_stamp);
+    }
+    catch (std::runtime_error const&) {
+      // the next load hashes again
+    }
+    return cooked;
+  }
+  cooked.reset();
+
+  model parsed{};
+  try {
+    parsed = obj_parser::parse(source.begin(), source.end(), import_attribs, pool);
+  }
+  catch (std::runtime_error const& error) {
+    throw std::runtime_error(error.what() + std::string{" in "} + name);
+  }
+  // cooking is the place for the slower reordering passes
+  mesh_optimizer::report stats = mesh_optimizer::optimize(parsed);
+  std::cout << "mesh_optimizer: " << name << " acmr " << stats.before.acmr << " -> " << stats.after.acmr
+            << ", atvr " << stats.before.atvr << " -> " << stats.after.atvr << ", "
+            << stats.welded_vertices << " vertices welded, " << stats.clusters << " overdraw clusters" << std::endl;
+  // levels of detail share the vertices and follow the full mesh in the index buffer
+  mesh_simplifier::lod_chain chain = mesh_simplifier::build_chain(parsed);
+  std::cout << "mesh_simplifier: " << name << " " << chain.levels.size() << " levels with";
+  for (auto const& level : chain.levels) {
+    std::cout << " " << level.num_indices / 3;
+  }
+  std::cout << " triangles, error " << chain.levels.back().error << std::endl;
+  parsed.indices.swap(chain.indices);
+  packed_mesh packed = quantize ? vertex_format::quantize(parsed) : vertex_format::pack(parsed);
+  packed.lods = chain.levels;
+  std::cout << "vertex_format: " << name << " " << parsed.vertex_bytes << " -> " << packed.vertex_bytes << " bytes per vertex, "
+            << sizeof(GLuint) * parsed.indices.size() << " -> " << packed.indices.size() << " index bytes" << std::endl;
+  try {
+    mesh_cache::write(packed, source_hash, source_stamp, import_attribs, cooked_name);
+  }
+  catch (std::runtime_error const& error) {
+    // read only resource directories only lose the cache
+    std::cerr << error.what() << std::endl;
+  }
+  return std::unique_ptr<mesh_cache::mesh>{new mesh_cache::mesh{std::move(packed), source_hash, source_stamp, import_attribs}};
+}
+
+std::string cooked_path(std::string const& name) {
+  std::size_t extension = name.find_last_of('.');
+  std::size_t separator = name.find_last_of("/\\");
+  if (extension == std::string::npos || (separator != std::string::npos && extension < separator)) {
+    return name + ".cmesh";
+  }
+  return name.substr(0, extension) + ".cmesh";
+}
+
+model obj_tinyobj(std::string const& name, model::attrib_flag_t import_attribs){
+  PROFILE_SCOPE("model_loader::obj_tinyobj");
   std::vector<tinyobj::shape_t> shapes;
   std::vector<tinyobj::material_t> materials;
 
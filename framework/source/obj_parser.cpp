@@ -0,0 +1,545 @@
+#include "obj_parser.hpp"
+
+#include "cpu_profiler.hpp"
+
+// use floats and med precision operations
+#include <glm/gtc/type_precision.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// smaller files are parsed by one thread
+static const std::size_t MIN_CHUNK_BYTES = 1 << 20;
+// exactly representable powers of ten
+static const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+static const GLuint NONE = ~0u;
+
+// face corner with 0 based attribute indices, -1 if the attribute is missing
+struct obj_corner {
+  int v;
+  int vt;
+  int vn;
+};
+
+// everything parsed from one line aligned chunk
+struct obj_chunk {
+  std::vector<float> positions;
+  std::vector<float> texcoords;
+  std::vector<float> normals;
+  // corners of all faces, each face with at least three of them
+  std::vector<obj_corner> corners;
+  std::vector<unsigned> face_sizes;
+  std::size_t num_triangles;
+  // first face of every object or group started in this chunk
+  std::vector<std::size_t> groups;
+  // negative indices still lack the attributes of previous chunks, corner * 3 + attribute
+  std::vector<std::size_t> relative;
+};
+
+static void parse_chunk(char const* begin, char const* end, obj_chunk& chunk);
+template<std::size_t N>
+static void parse_floats(char const* p, char const* end, std::vector<float>& values);
+static char const* parse_float(char const* p, char const* end, float& value);
+static char const* parse_int(char const* p, char const* end, int& value);
+static char const* parse_corner(char const* p, char const* end, obj_chunk& chunk);
+static bool is_space(char c);
+static bool starts_with(char const* line, char const* end, char const* keyword);
+
+namespace obj_parser {
+
+mapped_file::mapped_file(std::string const& path)
+ :m_data{nullptr}
+ ,m_size{0}
+ ,m_buffer{}
+ ,m_mapped{false}
+{
+#ifndef _WIN32
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::runtime_error("obj_parser: could not open " + path);
+  }
+  struct stat info{};
+  if (fstat(file, &info) == 0 && info.st_size > 0) {
+    void* data = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    if (data != MAP_FAILED) {
+      // chunks are read in parallel from the start
+      madvise(data, std::size_t(info.st_size), MADV_WILLNEED);
+      m_data = static_cast<char const*>(data);
+      m_size = std::size_t(info.st_size);
+      m_mapped = true;
+    }
+  }
+  close(file);
+  if (m_mapped) {
+    return;
+  }
+#endif
+  std::ifstream stream{path, std::ios::in | std::ios::binary};
+  if (!stream) {
+    throw std::runtime_error("obj_parser: could not open " + path);
+  }
+  m_buffer.assign(std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{});
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+}
+
+mapped_file::~mapped_file() {
+#ifndef _WIN32
+  if (m_mapped) {
+    munmap(const_cast<char*>(m_data), m_size);
+  }
+#endif
+}
+
+char const* mapped_file::begin() const {
+  return m_data;
+}
+
+char const* mapped_file::end() const {
+  return m_data + m_size;
+}
+
+model parse(char const* begin, char const* end, model::attrib_flag_t import_attribs, thread_pool& pool) {
+  // the calling thread parses a chunk too
+  std::size_t bytes = std::size_t(end - begin);
+  std::size_t num_chunks = std::max<std::size_t>(std::min(pool.size() + 1, bytes / MIN_CHUNK_BYTES), 1);
+
+  // chunk i covers [bounds[i], bounds[i + 1]), every bound but the last follows a line break
+  std::vector<char const*> bounds(num_chunks + 1, end);
+  bounds[0] = begin;
+  for (std::size_t i = 1; i < num_chunks; ++i) {
+    char const* bound = std::max(begin + i * bytes / num_chunks, bounds[i - 1]);
+    while (bound < end && bound[-1] != '\n') {
+      ++bound;
+    }
+    bounds[i] = bound;
+  }
+
+  std::vector<obj_chunk> chunks(num_chunks);
+  {
+    PROFILE_SCOPE("obj_parser::parse_chunks");
+    pool.parallel_for(num_chunks, [&bounds, &chunks](std::size_t i){
+      parse_chunk(bounds[i], bounds[i + 1], chunks[i]);
+    });
+  }
+
+  // attributes and triangles of previous chunks
+  std::vector<glm::ivec3> first_attribute(num_chunks + 1, glm::ivec3{0});
+  std::vector<std::size_t> first_triangle(num_chunks + 1, 0);
+  for (std::size_t i = 0; i < num_chunks; ++i) {
+    first_attribute[i + 1] = first_attribute[i] + glm::ivec3{int(chunks[i].positions.size() / 3),
+                                                              int(chunks[i].texcoords.size() / 2),
+                                                              int(chunks[i].normals.size() / 3)};
+    first_triangle[i + 1] = first_triangle[i] + chunks[i].num_triangles;
+  }
+  glm::ivec3 num_attributes = first_attribute[num_chunks];
+
+  // resolve negative indices and check all of them
+  pool.parallel_for(num_chunks, [&chunks, &first_attribute, num_attributes](std::size_t i){
+    std::vector<obj_corner>& corners = chunks[i].corners;
+    for (std::size_t slot : chunks[i].relative) {
+      obj_corner& corner = corners[slot / 3];
+      int& index = slot % 3 == 0 ? corner.v : (slot % 3 == 1 ? corner.vt : corner.vn);
+      index += first_attribute[i][int(slot % 3)];
+      if (index < 0) {
+        throw std::runtime_error("obj_parser: face index out of range");
+      }
+    }
+    for (auto const& corner : corners) {
+      if (corner.v < 0 || corner.v >= num_attributes.x || corner.vt >= num_attributes.y || corner.vn >= num_attributes.z) {
+        throw std::runtime_error("obj_parser: face index out of range");
+      }
+    }
+  });
+
+  model::attrib_flag_t attributes{model::POSITION | import_attribs};
+  // prevent MSVC warning due to Win BOOL implementation
+  bool has_normals = (import_attribs & model::NORMAL) != 0;
+  bool generate_normals = has_normals && num_attributes.z == 0;
+  bool has_uvs = (import_attribs & model::TEXCOORD) != 0;
+  if (has_uvs && num_attributes.y == 0) {
+    has_uvs = false;
+    attributes ^= model::TEXCOORD;
+    std::cerr << "Shape has no texcoords" << std::endl;
+  }
+  if ((import_attribs & model::TANGENT) != 0) {
+    if (!has_uvs) {
+      attributes ^= model::TANGENT;
+      std::cerr << "Shape has no texcoords" << std::endl;
+    }
+    else {
+      throw std::logic_error("Tangent creation not implemented yet");
+    }
+  }
+
+  // share vertices of equal corners in order of their first use and split faces into fans, like tinyobjloader
+  // vertices with the same position are chained, so lookups touch memory close to the previous one
+  std::vector<GLuint> indices(first_triangle[num_chunks] * 3);
+  std::vector<obj_corner> vertices;
+  {
+    PROFILE_SCOPE("obj_parser::share_vertices");
+    std::vector<GLuint> first_vertex(std::size_t(num_attributes.x), NONE);
+    std::vector<GLuint> next_vertex;
+    // positions with a vertex in the current group
+    std::vector<int> used_positions;
+    std::vector<GLuint> face;
+    vertices.reserve(std::size_t(num_attributes.x));
+    next_vertex.reserve(std::size_t(num_attributes.x));
+    GLuint* index_out = indices.data();
+    for (auto const& chunk : chunks) {
+      obj_corner const* corner = chunk.corners.data();
+      auto group = chunk.groups.begin();
+      for (std::size_t f = 0; f < chunk.face_sizes.size(); ++f) {
+        if (group != chunk.groups.end() && *group == f) {
+          // tinyobjloader starts a new shape with its own vertices
+          for (int position : used_positions) {
+            first_vertex[std::size_t(position)] = NONE;
+          }
+          used_positions.clear();
+          while (group != chunk.groups.end() && *group == f) {
+            ++group;
+          }
+        }
+        face.clear();
+        for (unsigned k = 0; k < chunk.face_sizes[f]; ++k, ++corner) {
+          GLuint& head = first_vertex[std::size_t(corner->v)];
+          GLuint index = head;
+          while (index != NONE && (vertices[index].vt != corner->vt || vertices[index].vn != corner->vn)) {
+            index = next_vertex[index];
+          }
+          if (index == NONE) {
+            if (head == NONE) {
+              used_positions.push_back(corner->v);
+            }
+            index = GLuint(vertices.size());
+            vertices.push_back(*corner);
+            next_vertex.push_back(head);
+            head = index;
+          }
+          face.push_back(index);
+        }
+        // polygon -> triangle fan conversion
+        for (std::size_t k = 2; k < face.size(); ++k) {
+          *index_out++ = face[0];
+          *index_out++ = face[k - 1];
+          *index_out++ = face[k];
+        }
+      }
+    }
+  }
+
+  // one array per attribute, a single chunk already holds them
+  std::vector<float> positions;
+  std::vector<float> texcoords;
+  std::vector<float> normals;
+  if (num_chunks == 1) {
+    positions.swap(chunks[0].positions);
+    texcoords.swap(chunks[0].texcoords);
+    normals.swap(chunks[0].normals);
+  }
+  else {
+    positions.reserve(std::size_t(num_attributes.x) * 3);
+    texcoords.reserve(std::size_t(num_attributes.y) * 2);
+    normals.reserve(std::size_t(num_attributes.z) * 3);
+    for (auto const& chunk : chunks) {
+      positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+      texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+      normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
+  }
+  chunks.clear();
+
+  // write interleaved vertices in parallel ranges
+  std::size_t stride = 3 + (has_normals ? 3 : 0) + (has_uvs ? 2 : 0);
+  std::vector<float> vertex_data(vertices.size() * stride);
+  {
+    PROFILE_SCOPE("obj_parser::interleave");
+    std::size_t num_ranges = std::max<std::size_t>(std::min(num_chunks, vertices.size() / 4096), 1);
+    pool.parallel_for(num_ranges, [&](std::size_t range){
+      std::size_t last = (range + 1) * vertices.size() / num_ranges;
+      for (std::size_t i = range * vertices.size() / num_ranges; i < last; ++i) {
+        obj_corner const& corner = vertices[i];
+        float* vertex = &vertex_data[i * stride];
+        std::copy(&positions[std::size_t(corner.v) * 3], &positions[std::size_t(corner.v) * 3] + 3, vertex);
+        vertex += 3;
+        if (has_normals) {
+          if (corner.vn >= 0) {
+            std::copy(&normals[std::size_t(corner.vn) * 3], &normals[std::size_t(corner.vn) * 3] + 3, vertex);
+          }
+          vertex += 3;
+        }
+        if (has_uvs && corner.vt >= 0) {
+          std::copy(&texcoords[std::size_t(corner.vt) * 2], &texcoords[std::size_t(corner.vt) * 2] + 2, vertex);
+        }
+      }
+    });
+  }
+
+  if (generate_normals) {
+    PROFILE_SCOPE("obj_parser::generate_normals");
+    // accumulate area weighted face normals in the normal slots
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+      float* v0 = &vertex_data[indices[i] * stride];
+      float* v1 = &vertex_data[indices[i + 1] * stride];
+      float* v2 = &vertex_data[indices[i + 2] * stride];
+      glm::fvec3 p0{v0[0], v0[1], v0[2]};
+      glm::fvec3 normal = glm::cross(glm::fvec3{v1[0], v1[1], v1[2]} - p0, glm::fvec3{v2[0], v2[1], v2[2]} - p0);
+      for (float* vertex : {v0, v1, v2}) {
+        vertex[3] += normal.x;
+        vertex[4] += normal.y;
+        vertex[5] += normal.z;
+      }
+    }
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+      float* vertex = &vertex_data[i * stride];
+      glm::fvec3 normal{vertex[3], vertex[4], vertex[5]};
+      float length = glm::length(normal);
+      if (length > 0.f) {
+        normal /= length;
+      }
+      std::copy(&normal[0], &normal[0] + 3, vertex + 3);
+    }
+  }
+
+  // vectors are moved into the model instead of copied
+  model result{std::vector<GLfloat>{}, attributes};
+  result.data.swap(vertex_data);
+  result.indices.swap(indices);
+  result.vertex_num = vertices.size();
+  return result;
+}
+
+model load(std::string const& path, model::attrib_flag_t import_attribs, thread_pool& pool) {
+  PROFILE_SCOPE("obj_parser::load");
+  mapped_file file{path};
+  try {
+    return parse(file.begin(), file.end(), import_attribs, pool);
+  }
+  catch (std::runtime_error const& error) {
+    throw std::runtime_error(error.what() + std::string{" in "} + path);
+  }
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static void parse_chunk(char const* begin, char const* end, obj_chunk& chunk) {
+  // count lines first, growing the arrays while parsing costs more than this pass
+  std::size_t counts[4] = {0, 0, 0, 0};
+  for (char const* line = begin; line < end; ) {
+    char const* line_end = static_cast<char const*>(std::memchr(line, '\n', std::size_t(end - line)));
+    line_end = line_end ? line_end : end;
+    if (line_end - line > 2 && line[0] == 'v') {
+      ++counts[is_space(line[1]) ? 0 : (line[1] == 't' ? 1 : 2)];
+    }
+    else if (line_end - line > 2 && line[0] == 'f') {
+      ++counts[3];
+    }
+    line = line_end + 1;
+  }
+  chunk.positions.reserve(counts[0] * 3);
+  chunk.texcoords.reserve(counts[1] * 2);
+  chunk.normals.reserve(counts[2] * 3);
+  // most faces are triangles or quads
+  chunk.corners.reserve(counts[3] * 4);
+  chunk.face_sizes.reserve(counts[3]);
+  chunk.num_triangles = 0;
+
+  for (char const* line = begin; line < end; ) {
+    char const* line_end = static_cast<char const*>(std::memchr(line, '\n', std::size_t(end - line)));
+    line_end = line_end ? line_end : end;
+    char const* p = line;
+    line = line_end + 1;
+    while (p < line_end && is_space(*p)) {
+      ++p;
+    }
+    if (line_end - p < 2) {
+      continue;
+    }
+
+    if (p[0] == 'v' && is_space(p[1])) {
+      parse_floats<3>(p + 2, line_end, chunk.positions);
+    }
+    else if (starts_with(p, line_end, "vt")) {
+      parse_floats<2>(p + 3, line_end, chunk.texcoords);
+    }
+    else if (starts_with(p, line_end, "vn")) {
+      parse_floats<3>(p + 3, line_end, chunk.normals);
+    }
+    else if (p[0] == 'f' && is_space(p[1])) {
+      std::size_t first_corner = chunk.corners.size();
+      std::size_t first_relative = chunk.relative.size();
+      char const* q = p + 2;
+      while (true) {
+        while (q < line_end && is_space(*q)) {
+          ++q;
+        }
+        if (q >= line_end || *q == '#') {
+          break;
+        }
+        char const* next = parse_corner(q, line_end, chunk);
+        if (next == q) {
+          throw std::runtime_error("obj_parser: invalid face corner");
+        }
+        q = next;
+      }
+      std::size_t size = chunk.corners.size() - first_corner;
+      if (size < 3) {
+        // lines and points have no triangles and create no vertices
+        chunk.corners.resize(first_corner);
+        chunk.relative.resize(first_relative);
+        continue;
+      }
+      chunk.face_sizes.push_back(unsigned(size));
+      chunk.num_triangles += size - 2;
+    }
+    else if (((p[0] == 'o' || p[0] == 'g') && is_space(p[1])) || starts_with(p, line_end, "usemtl")) {
+      chunk.groups.push_back(chunk.face_sizes.size());
+    }
+  }
+}
+
+// appends N floats, missing ones are 0
+template<std::size_t N>
+static void parse_floats(char const* p, char const* end, std::vector<float>& values) {
+  float parsed[N] = {};
+  for (float& value : parsed) {
+    p = parse_float(p, end, value);
+  }
+  values.insert(values.end(), parsed, parsed + N);
+}
+
+static char const* parse_float(char const* p, char const* end, float& value) {
+  while (p < end && is_space(*p)) {
+    ++p;
+  }
+  char const* start = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+  // up to 19 significant digits fit into the mantissa, further ones only scale it
+  std::uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any = false;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+    any = true;
+    if (digits < 19) {
+      mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+      digits += mantissa != 0;
+    }
+    else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+      any = true;
+      if (digits < 19) {
+        mantissa = mantissa * 10 + std::uint64_t(*p - '0');
+        digits += mantissa != 0;
+        --exponent;
+      }
+    }
+  }
+  if (!any) {
+    return start;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    int exp_value = 0;
+    char const* exp_end = parse_int(p + 1, end, exp_value);
+    if (exp_end != p + 1) {
+      exponent += exp_value;
+      p = exp_end;
+    }
+  }
+
+  double result = double(mantissa);
+  // exact operands give a correctly rounded result
+  if (exponent >= 0 && exponent <= 22) {
+    result *= POWERS_OF_TEN[exponent];
+  }
+  else if (exponent < 0 && exponent >= -22) {
+    result /= POWERS_OF_TEN[-exponent];
+  }
+  else {
+    result *= std::pow(10., double(exponent));
+  }
+  value = float(negative ? -result : result);
+  return p;
+}
+
+static char const* parse_int(char const* p, char const* end, int& value) {
+  char const* start = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+  char const* digits = p;
+  // saturate, such indices are out of range anyway
+  int result = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+    result = result < 100000000 ? result * 10 + (*p - '0') : 1000000000;
+  }
+  if (p == digits) {
+    return start;
+  }
+  value = negative ? -result : result;
+  return p;
+}
+
+static char const* parse_corner(char const* p, char const* end, obj_chunk& chunk) {
+  // v, v/vt, v//vn or v/vt/vn, indices are 1 based or negative from the end
+  int index[3] = {0, 0, 0};
+  char const* q = parse_int(p, end, index[0]);
+  if (q == p || index[0] == 0) {
+    return p;
+  }
+  if (q < end && *q == '/') {
+    q = parse_int(q + 1, end, index[1]);
+    if (q < end && *q == '/') {
+      q = parse_int(q + 1, end, index[2]);
+    }
+  }
+  int counts[3] = {int(chunk.positions.size() / 3), int(chunk.texcoords.size() / 2), int(chunk.normals.size() / 3)};
+  int resolved[3] = {-1, -1, -1};
+  for (std::size_t i = 0; i < 3; ++i) {
+    if (index[i] > 0) {
+      resolved[i] = index[i] - 1;
+    }
+    else if (index[i] < 0) {
+      // completed with the attributes of previous chunks later
+      resolved[i] = counts[i] + index[i];
+      chunk.relative.push_back(chunk.corners.size() * 3 + i);
+    }
+  }
+  chunk.corners.push_back(obj_corner{resolved[0], resolved[1], resolved[2]});
+  return q;
+}
+
+static bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+// line starts with keyword followed by whitespace
+static bool starts_with(char const* line, char const* end, char const* keyword) {
+  std::size_t length = std::strlen(keyword);
+  return std::size_t(end - line) > length && std::equal(keyword, keyword + length, line) && is_space(line[length]);
+}
@@ -0,0 +1,284 @@
+#include "occlusion_culler.hpp"
+
+#include "cpu_profiler.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// clip space w below which vertices count as behind the camera
+static const float MIN_W = 1e-4f;
+
+// edge functions and depth plane of a triangle, evaluated at pixel centers
+struct screen_triangle_setup {
+  // w_i(x, y) = a[i] * x + b[i] * y + c[i], inside if all are >= 0
+  float a[3];
+  float b[3];
+  float c[3];
+  // depth(x, y) = z_a * x + z_b * y + z_c
+  float z_a;
+  float z_b;
+  float z_c;
+};
+
+static void rasterize_span(float* row, int first_x, int last_x, float y, screen_triangle_setup const& setup);
+
+occlusion_culler::occlusion_culler(thread_pool& workers, std::size_t width, std::size_t height)
+ :m_workers(workers)
+ ,m_width{int(width)}
+ ,m_height{int(height)}
+ ,m_view_projection{}
+ ,m_triangles{}
+ ,m_levels{}
+ ,m_level_sizes{}
+{
+  if (width == 0 || height == 0 || width % 4 != 0) {
+    throw std::invalid_argument("occlusion_culler: width must be a positive multiple of 4");
+  }
+  glm::ivec2 size{m_width, m_height};
+  while (true) {
+    m_level_sizes.push_back(size);
+    m_levels.push_back(std::vector<float>(std::size_t(size.x * size.y), 1.f));
+    if (size.x == 1 && size.y == 1) {
+      break;
+    }
+    size = glm::ivec2{(size.x + 1) / 2, (size.y + 1) / 2};
+  }
+}
+
+void occlusion_culler::begin(glm::fmat4 const& view_projection) {
+  m_view_projection = view_projection;
+  m_triangles.clear();
+  std::fill(m_levels[0].begin(), m_levels[0].end(), 1.f);
+}
+
+void occlusion_culler::add_occluder(glm::fmat4 const& model_matrix, std::vector<glm::fvec3> const& triangles) {
+  glm::fmat4 transform = m_view_projection * model_matrix;
+  for (std::size_t i = 0; i + 2 < triangles.size(); i += 3) {
+    screen_triangle triangle{};
+    bool clipped = false;
+    for (std::size_t j = 0; j < 3; ++j) {
+      glm::fvec4 clip = transform * glm::fvec4{triangles[i + j], 1.f};
+      // triangles crossing the near plane are dropped, occluding less is always safe
+      if (clip.w < MIN_W) {
+        clipped = true;
+        break;
+      }
+      glm::fvec3 ndc = glm::fvec3{clip} / clip.w;
+      triangle.v[j] = glm::fvec3{(ndc.x * 0.5f + 0.5f) * float(m_width),
+                                 (ndc.y * 0.5f + 0.5f) * float(m_height),
+                                 ndc.z * 0.5f + 0.5f};
+    }
+    if (clipped) {
+      continue;
+    }
+    glm::fvec3 const* v = triangle.v;
+    // back faces are hidden by the front faces of the closed occluder
+    float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+    if (area <= 0.f) {
+      continue;
+    }
+    float min_y = std::min(v[0].y, std::min(v[1].y, v[2].y));
+    float max_y = std::max(v[0].y, std::max(v[1].y, v[2].y));
+    triangle.min_y = std::max(int(std::floor(min_y)), 0);
+    triangle.max_y = std::min(int(std::ceil(max_y)), m_height - 1);
+    if (triangle.min_y > triangle.max_y) {
+      continue;
+    }
+    m_triangles.push_back(triangle);
+  }
+}
+
+void occlusion_culler::finish() {
+  // one thread rasterizes each band of rows, so no pixel is written by two threads
+  std::size_t num_bands = std::min<std::size_t>(std::max<std::size_t>(m_workers.size(), 1) * 2, std::size_t(m_height));
+  m_workers.parallel_for(num_bands, [this, num_bands](std::size_t band){
+    int first_row = int(band * std::size_t(m_height) / num_bands);
+    int last_row = int((band + 1) * std::size_t(m_height) / num_bands);
+    rasterize_band(first_row, last_row);
+  });
+
+  build_pyramid();
+}
+
+bool occlusion_culler::visible(glm::fvec3 const& center, float radius) const {
+  // screen rectangle and nearest depth of the bounding box of the sphere
+  glm::fvec2 min_pixel{float(m_width), float(m_height)};
+  glm::fvec2 max_pixel{0.f};
+  float min_depth = 1.f;
+  for (int corner = 0; corner < 8; ++corner) {
+    glm::fvec3 offset{corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius};
+    glm::fvec4 clip = m_view_projection * glm::fvec4{center + offset, 1.f};
+    if (clip.w < MIN_W) {
+      // reaches behind the camera, nothing can hide it
+      return true;
+    }
+    glm::fvec3 ndc = glm::fvec3{clip} / clip.w;
+    glm::fvec2 pixel{(ndc.x * 0.5f + 0.5f) * float(m_width), (ndc.y * 0.5f + 0.5f) * float(m_height)};
+    min_pixel = glm::min(min_pixel, pixel);
+    max_pixel = glm::max(max_pixel, pixel);
+    min_depth = std::min(min_depth, ndc.z * 0.5f + 0.5f);
+  }
+  if (min_depth <= 0.f) {
+    return true;
+  }
+  int x0 = std::max(int(std::floor(min_pixel.x)), 0);
+  int y0 = std::max(int(std::floor(min_pixel.y)), 0);
+  int x1 = std::min(int(std::floor(max_pixel.x)), m_width - 1);
+  int y1 = std::min(int(std::floor(max_pixel.y)), m_height - 1);
+  if (x0 > x1 || y0 > y1) {
+    // off screen, left to frustum culling
+    return true;
+  }
+
+  // coarsest level where the rectangle covers at most 2x2 texels
+  std::size_t level = 0;
+  while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+    ++level;
+  }
+  glm::ivec2 size = m_level_sizes[level];
+  float max_depth = 0.f;
+  for (int y = y0 >> level; y <= (y1 >> level); ++y) {
+    for (int x = x0 >> level; x <= (x1 >> level); ++x) {
+      max_depth = std::max(max_depth, m_levels[level][std::size_t(y * size.x + x)]);
+    }
+  }
+  return min_depth <= max_depth;
+}
+
+std::size_t occlusion_culler::num_triangles() const {
+  return m_triangles.size();
+}
+
+std::vector<float> const& occlusion_culler::depth() const {
+  return m_levels[0];
+}
+
+std::vector<glm::fvec3> occlusion_culler::inscribed_sphere(unsigned rings, unsigned segments) {
+  // vertices lie on the unit sphere, so the flat faces lie inside it
+  auto point = [rings, segments](unsigned ring, unsigned segment) {
+    float theta = glm::pi<float>() * float(ring) / float(rings);
+    float phi = 2.f * glm::pi<float>() * float(segment) / float(segments);
+    return glm::fvec3{std::sin(theta) * std::cos(phi), std::cos(theta), -std::sin(theta) * std::sin(phi)};
+  };
+  std::vector<glm::fvec3> triangles;
+  for (unsigned ring = 0; ring < rings; ++ring) {
+    for (unsigned segment = 0; segment < segments; ++segment) {
+      glm::fvec3 top_left = point(ring, segment);
+      glm::fvec3 top_right = point(ring, segment + 1);
+      glm::fvec3 bottom_left = point(ring + 1, segment);
+      glm::fvec3 bottom_right = point(ring + 1, segment + 1);
+      // poles only need one triangle per segment
+      if (ring > 0) {
+        triangles.insert(triangles.end(), {top_left, bottom_left, top_right});
+      }
+      if (ring + 1 < rings) {
+        triangles.insert(triangles.end(), {top_right, bottom_left, bottom_right});
+      }
+    }
+  }
+  return triangles;
+}
+
+void occlusion_culler::rasterize_band(int first_row, int last_row) {
+  PROFILE_SCOPE("occlusion_culler::rasterize_band");
+  for (auto const& triangle : m_triangles) {
+    if (triangle.max_y < first_row || triangle.min_y >= last_row) {
+      continue;
+    }
+    glm::fvec3 const* v = triangle.v;
+    screen_triangle_setup setup{};
+    float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+    for (int i = 0; i < 3; ++i) {
+      // edge opposite of vertex i, normalized to barycentric weights
+      glm::fvec3 const& p = v[(i + 1) % 3];
+      glm::fvec3 const& q = v[(i + 2) % 3];
+      setup.a[i] = (p.y - q.y) / area;
+      setup.b[i] = (q.x - p.x) / area;
+      setup.c[i] = (p.x * q.y - q.x * p.y) / area;
+    }
+    setup.z_a = setup.a[0] * v[0].z + setup.a[1] * v[1].z + setup.a[2] * v[2].z;
+    setup.z_b = setup.b[0] * v[0].z + setup.b[1] * v[1].z + setup.b[2] * v[2].z;
+    setup.z_c = setup.c[0] * v[0].z + setup.c[1] * v[1].z + setup.c[2] * v[2].z;
+
+    float min_x = std::min(v[0].x, std::min(v[1].x, v[2].x));
+    float max_x = std::max(v[0].x, std::max(v[1].x, v[2].x));
+    // spans start at a multiple of 4 for the 4 pixel wide steps
+    int first_x = std::max(int(std::floor(min_x)), 0) & ~3;
+    int last_x = std::min(int(std::ceil(max_x)), m_width - 1);
+    if (first_x > last_x) {
+      continue;
+    }
+    int row_begin = std::max(triangle.min_y, first_row);
+    int row_end = std::min(triangle.max_y + 1, last_row);
+    for (int y = row_begin; y < row_end; ++y) {
+      rasterize_span(&m_levels[0][std::size_t(y * m_width)], first_x, last_x, float(y) + 0.5f, setup);
+    }
+  }
+}
+
+void occlusion_culler::build_pyramid() {
+  PROFILE_SCOPE("occlusion_culler::build_pyramid");
+  for (std::size_t level = 1; level < m_levels.size(); ++level) {
+    glm::ivec2 src_size = m_level_sizes[level - 1];
+    glm::ivec2 dst_size = m_level_sizes[level];
+    std::vector<float> const& src = m_levels[level - 1];
+    std::vector<float>& dst = m_levels[level];
+    for (int y = 0; y < dst_size.y; ++y) {
+      // odd sizes repeat the last row and column
+      int y_a = std::min(2 * y, src_size.y - 1) * src_size.x;
+      int y_b = std::min(2 * y + 1, src_size.y - 1) * src_size.x;
+      for (int x = 0; x < dst_size.x; ++x) {
+        int x_a = std::min(2 * x, src_size.x - 1);
+        int x_b = std::min(2 * x + 1, src_size.x - 1);
+        dst[std::size_t(y * dst_size.x + x)] = std::max(std::max(src[std::size_t(y_a + x_a)], src[std::size_t(y_a + x_b)]),
+                                                        std::max(src[std::size_t(y_b + x_a)], src[std::size_t(y_b + x_b)]));
+      }
+    }
+  }
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// keeps the nearer depth of all covered pixel centers in [first_x, last_x], four pixels per step
+static void rasterize_span(float* row, int first_x, int last_x, float y, screen_triangle_setup const& setup) {
+  float row_w[3];
+  for (int i = 0; i < 3; ++i) {
+    row_w[i] = setup.b[i] * y + setup.c[i];
+  }
+  float row_z = setup.z_b * y + setup.z_c;
+#if defined(__SSE2__)
+  __m128 zero = _mm_setzero_ps();
+  __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+  for (int x = first_x; x <= last_x; x += 4) {
+    __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int i = 0; i < 3; ++i) {
+      __m128 w = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.a[i]), px), _mm_set1_ps(row_w[i]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(w, zero));
+    }
+    __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.z_a), px), _mm_set1_ps(row_z));
+    __m128 old_z = _mm_loadu_ps(row + x);
+    __m128 new_z = _mm_min_ps(old_z, z);
+    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_z), _mm_andnot_ps(inside, old_z)));
+  }
+#else
+  for (int x = first_x; x <= last_x; x += 4) {
+    for (int lane = 0; lane < 4; ++lane) {
+      float px = float(x + lane) + 0.5f;
+      bool inside = true;
+      for (int i = 0; i < 3; ++i) {
+        inside = inside && setup.a[i] * px + row_w[i] >= 0.f;
+      }
+      if (inside) {
+        row[x + lane] = std::min(row[x + lane], setup.z_a * px + row_z);
+      }
+    }
+  }
+#endif
+}
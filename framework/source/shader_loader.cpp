@@ -6,15 +6,56 @@
 #include <glbinding/gl/functions.h>
 // load meta info extension
 #include <glbinding/Meta.h>
-// use gl definitions from glbinding 
+// use gl definitions from glbinding
 using namespace gl;
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <mutex>
 #include <vector>
 #include <string.h>
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// program binary cache file: binary_header followed by length bytes of the binary
+static const char BINARY_MAGIC[4] = {'P', 'B', 'I', 'N'};
+struct binary_header {
+  char magic[4];
+  // gl enum returned by glGetProgramBinary
+  std::uint32_t format;
+  std::uint64_t length;
+  // utils::hash of the binary
+  std::uint64_t hash;
+};
+
+// contents of all read shader files, including included ones
+static std::map<std::string, std::string> file_cache{};
+// files a shader file was expanded from, the file itself comes first
+static std::map<std::string, std::vector<std::string>> file_dependencies{};
+static std::mutex cache_mutex{};
+// directory of program binaries, empty if caching is disabled
+static std::string cache_directory{};
+
+static std::string read_source(std::string const& file_path);
+static std::string read_cached(std::string const& file_path);
+static std::string expand_includes(std::string const& file_path, std::vector<std::string>& files, std::vector<std::string>& stack);
+static std::string add_defines(std::string const& source, std::vector<std::string> const& defines);
+static GLuint compile(std::string const& source, std::string const& file_path, GLenum shader_type);
+static std::string source_names(std::string const& file_path);
+static bool binaries_supported();
+static std::string cache_path(std::vector<std::pair<GLenum, std::string>> const& sources, std::vector<std::string> const& defines);
+static GLuint load_binary(std::string const& path);
+static void save_binary(GLuint program, std::string const& path);
+
 
 static std::string file_name(std::string const& file_path) {
   return file_path.substr(file_path.find_last_of("/\\") + 1);
@@ -22,51 +63,55 @@ static std::string file_name(std::string const& file_path) {
 
 namespace shader_loader {
 
-GLuint shader(std::string const& file_path, GLenum shader_type) {
-  GLuint shader = 0;
-  shader = glCreateShader(shader_type);
-
-  std::string shader_source{utils::read_file(file_path)};
-  // glshadersource expects array of c-strings
-  const char* shader_chars = shader_source.c_str();
-  glShaderSource(shader, 1, &shader_chars, 0);
-
-  glCompileShader(shader);
-
-  // check if compilation was successfull
-  GLint success = 0;
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-  if(success == 0) {
-    // get log length
-    GLint log_size = 0;
-    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
-    // get log
-    std::vector<GLchar> log_buffer(log_size);
-    glGetShaderInfoLog(shader, log_size, &log_size, log_buffer.data());
-    // output errors
-    std::cerr << "OpenGl error: Compilation of " << glbinding::Meta::getString(shader_type).c_str() << " " << file_name(file_path) << ":\n";
-    std::cerr << std::string{log_buffer.begin(), log_buffer.end()};
-    // free broken shader
-    glDeleteShader(shader);
+GLuint shader(std::string const& file_path, GLenum shader_type, std::vector<std::string> const& defines) {
+  return compile(add_defines(read_source(file_path), defines), file_path, shader_type);
+}
 
-    throw std::logic_error("OpenGL error: compilation of " + file_name(file_path));
+unsigned program(std::map<GLenum, std::string> const& stages, std::vector<std::string> const& defines) {
+  // sources are needed for the cache key even if the binary is cached
+  std::vector<std::pair<GLenum, std::string>> sources{};
+  for (auto const& stage : stages) {
+    sources.push_back(std::make_pair(stage.first, add_defines(read_source(stage.second), defines)));
   }
 
-  return shader;
-}
+  bool caching = !cache_directory.empty() && binaries_supported();
+  std::string binary_path{};
+  if (caching) {
+    binary_path = cache_path(sources, defines);
+    GLuint cached = load_binary(binary_path);
+    if (cached != 0) {
+      return cached;
+    }
+  }
 
-unsigned program(std::map<GLenum, std::string> const& stages) {
   unsigned program = glCreateProgram();
 
   std::vector<GLuint> shaders{};
   // load and compile vert and frag shader
+  std::size_t i = 0;
   for (auto const& stage : stages) {
-    GLuint shader_handle = shader(stage.second, stage.first);
+    GLuint shader_handle = 0;
+    try {
+      shader_handle = compile(sources[i++].second, stage.second, stage.first);
+    }
+    catch (std::exception const&) {
+      // free already compiled stages
+      for (auto handle : shaders) {
+        glDeleteShader(handle);
+      }
+      glDeleteProgram(program);
+      throw;
+    }
     shaders.push_back(shader_handle);
     // attach the shader to program
     glAttachShader(program, shader_handle);
   }
 
+  if (caching) {
+    // driver must keep the binary around for glGetProgramBinary
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
   // link shaders
   glLinkProgram(program);
 
@@ -80,7 +125,7 @@ unsigned program(std::map<GLenum, std::string> const& stages) {
     // get log
     std::vector<GLchar> log_buffer(log_size);
     glGetProgramInfoLog(program, log_size, &log_size, log_buffer.data());
-    
+
     // output errors
     std::string names{};
     for(auto const& stage : stages) {
@@ -93,6 +138,9 @@ unsigned program(std::map<GLenum, std::string> const& stages) {
 
     // free broken program
     glDeleteProgram(program);
+    for (auto shader_handle : shaders) {
+      glDeleteShader(shader_handle);
+    }
 
     throw std::logic_error("OpenGL error: linking of " + names);
   }
@@ -104,7 +152,300 @@ unsigned program(std::map<GLenum, std::string> const& stages) {
     glDeleteShader(shader_handle);
   }
 
+  if (caching) {
+    save_binary(program, binary_path);
+  }
+
   return program;
 }
 
+void preload(std::string const& file_path) {
+  read_source(file_path);
+}
+
+std::vector<std::string> dependencies(std::string const& file_path) {
+  std::lock_guard<std::mutex> lock{cache_mutex};
+  auto files = file_dependencies.find(file_path);
+  if (files == file_dependencies.end()) {
+    return std::vector<std::string>{file_path};
+  }
+  return files->second;
+}
+
+std::vector<std::string> refresh() {
+  std::map<std::string, std::string> cached{};
+  {
+    std::lock_guard<std::mutex> lock{cache_mutex};
+    cached = file_cache;
+  }
+  std::vector<std::string> changed{};
+  for (auto const& file : cached) {
+    std::string text{};
+    try {
+      text = utils::read_file(file.first);
+    }
+    catch (std::exception const&) {
+      // deleted files keep their last content
+      continue;
+    }
+    if (text != file.second) {
+      std::lock_guard<std::mutex> lock{cache_mutex};
+      file_cache[file.first] = std::move(text);
+      changed.push_back(file.first);
+    }
+  }
+  return changed;
+}
+
+void invalidate(std::string const& file_path) {
+  std::lock_guard<std::mutex> lock{cache_mutex};
+  file_cache.erase(file_path);
+}
+
+void set_cache_directory(std::string const& directory) {
+  cache_directory = directory;
+  if (cache_directory.empty()) {
+    return;
+  }
+  if (cache_directory.back() != '/' && cache_directory.back() != '\\') {
+    cache_directory += '/';
+  }
+  // fails harmlessly if the directory exists
+#ifdef _WIN32
+  _mkdir(cache_directory.c_str());
+#else
+  mkdir(cache_directory.c_str(), 0755);
+#endif
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static std::string read_source(std::string const& file_path) {
+  std::vector<std::string> files{};
+  std::vector<std::string> stack{};
+  std::string source = expand_includes(file_path, files, stack);
+  std::lock_guard<std::mutex> lock{cache_mutex};
+  file_dependencies[file_path] = files;
+  return source;
+}
+
+static std::string read_cached(std::string const& file_path) {
+  {
+    std::lock_guard<std::mutex> lock{cache_mutex};
+    auto cached = file_cache.find(file_path);
+    if (cached != file_cache.end()) {
+      return cached->second;
+    }
+  }
+  // read outside the lock, concurrent preloads of other files continue
+  std::string text{utils::read_file(file_path)};
+  std::lock_guard<std::mutex> lock{cache_mutex};
+  file_cache[file_path] = text;
+  return text;
+}
+
+static std::string expand_includes(std::string const& file_path, std::vector<std::string>& files, std::vector<std::string>& stack) {
+  // source string number used in #line directives
+  std::size_t file_index = files.size();
+  files.push_back(file_path);
+  stack.push_back(file_path);
+
+  std::string directory = file_path.substr(0, file_path.find_last_of("/\\") + 1);
+  std::istringstream lines{read_cached(file_path)};
+  std::string expanded{};
+  std::string line{};
+  std::size_t line_number = 0;
+  while (std::getline(lines, line)) {
+    ++line_number;
+    std::size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+      expanded += line + "\n";
+      continue;
+    }
+    // file name in quotes, relative to the including file
+    std::size_t open = line.find('"', start + 8);
+    std::size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+    if (close == std::string::npos) {
+      throw std::logic_error("shader_loader: malformed include in " + file_name(file_path) + ":" + std::to_string(line_number));
+    }
+    std::string include_path = directory + line.substr(open + 1, close - open - 1);
+    if (std::find(stack.begin(), stack.end(), include_path) != stack.end()) {
+      throw std::logic_error("shader_loader: recursive include of " + file_name(include_path));
+    }
+    // every file is included once
+    if (std::find(files.begin(), files.end(), include_path) == files.end()) {
+      std::size_t include_index = files.size();
+      expanded += "#line 1 " + std::to_string(include_index) + "\n";
+      expanded += expand_includes(include_path, files, stack);
+    }
+    expanded += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file_index) + "\n";
+  }
+  stack.pop_back();
+  return expanded;
+}
+
+static std::string add_defines(std::string const& source, std::vector<std::string> const& defines) {
+  if (defines.empty()) {
+    return source;
+  }
+  std::string define_lines{};
+  for (auto const& define : defines) {
+    define_lines += "#define " + define + "\n";
+  }
+  // defines must follow the version directive
+  std::size_t version = source.find("#version");
+  if (version == std::string::npos) {
+    return define_lines + "#line 1\n" + source;
+  }
+  std::size_t line_end = source.find('\n', version);
+  if (line_end == std::string::npos) {
+    return source + "\n" + define_lines;
+  }
+  // keep line numbers of compile errors matching the file
+  std::size_t next_line = 2 + std::size_t(std::count(source.begin(), source.begin() + line_end, '\n'));
+  return source.substr(0, line_end + 1) + define_lines + "#line " + std::to_string(next_line) + "\n" + source.substr(line_end + 1);
+}
+
+static GLuint compile(std::string const& source, std::string const& file_path, GLenum shader_type) {
+  GLuint shader = 0;
+  shader = glCreateShader(shader_type);
+
+  // glshadersource expects array of c-strings
+  const char* shader_chars = source.c_str();
+  glShaderSource(shader, 1, &shader_chars, 0);
+
+  glCompileShader(shader);
+
+  // check if compilation was successfull
+  GLint success = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if(success == 0) {
+    // get log length
+    GLint log_size = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
+    // get log
+    std::vector<GLchar> log_buffer(log_size);
+    glGetShaderInfoLog(shader, log_size, &log_size, log_buffer.data());
+    // output errors
+    std::cerr << "OpenGl error: Compilation of " << glbinding::Meta::getString(shader_type).c_str() << " " << file_name(file_path) << ":\n";
+    std::cerr << source_names(file_path);
+    std::cerr << std::string{log_buffer.begin(), log_buffer.end()};
+    // free broken shader
+    glDeleteShader(shader);
+
+    throw std::logic_error("OpenGL error: compilation of " + file_name(file_path));
+  }
+
+  return shader;
+}
+
+static bool binaries_supported() {
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  // program binaries are core since 4.1
+  if (major < 4 || (major == 4 && minor < 1)) {
+    return false;
+  }
+  // drivers may support no format at all
+  GLint num_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+  return num_formats > 0;
+}
+
+static std::string cache_path(std::vector<std::pair<GLenum, std::string>> const& sources, std::vector<std::string> const& defines) {
+  // binaries are only valid for the driver which created them
+  std::string key{};
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const GLubyte* value = glGetString(name);
+    key += value ? reinterpret_cast<const char*>(value) : "";
+    key += '\n';
+  }
+  for (auto const& define : defines) {
+    key += define + '\n';
+  }
+  for (auto const& source : sources) {
+    key += std::to_string(static_cast<unsigned>(source.first)) + '\n' + source.second;
+  }
+
+  std::ostringstream path{};
+  path << cache_directory << std::hex << utils::hash(key) << ".bin";
+  return path.str();
+}
+
+static GLuint load_binary(std::string const& path) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    return 0;
+  }
+  // truncated or foreign files are rejected before the driver sees them
+  binary_header header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0 || header.length == 0) {
+    return 0;
+  }
+  std::vector<char> binary(static_cast<std::size_t>(header.length));
+  file.read(binary.data(), std::streamsize(binary.size()));
+  if (!file || file.gcount() != std::streamsize(binary.size()) || utils::hash(binary.data(), binary.size()) != header.hash) {
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, GLenum(header.format), binary.data(), GLsizei(binary.size()));
+  // drivers reject binaries after updates, fall back to compiling
+  GLint success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (success == 0) {
+    glDeleteProgram(program);
+    std::remove(path.c_str());
+    return 0;
+  }
+  return program;
+}
+
+static void save_binary(GLuint program, std::string const& path) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(static_cast<std::size_t>(length));
+  GLenum format = GL_NONE;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  binary_header header{};
+  std::memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+  header.format = static_cast<std::uint32_t>(format);
+  header.length = static_cast<std::uint64_t>(length);
+  header.hash = utils::hash(binary.data(), std::size_t(length));
+
+  // failing to write only disables the cache for this program
+  // other runs may read the cache meanwhile, the file only appears once it is complete
+  std::string temporary = utils::temporary_path(path);
+  {
+    std::ofstream file{temporary, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    if (!file) {
+      file.close();
+      std::remove(temporary.c_str());
+      return;
+    }
+  }
+  utils::replace_file(temporary, path);
+}
+
+static std::string source_names(std::string const& file_path) {
+  // log lines refer to files by source string number
+  std::vector<std::string> files = shader_loader::dependencies(file_path);
+  if (files.size() < 2) {
+    return std::string{};
+  }
+  std::string names{};
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    names += "  source " + std::to_string(i) + ": " + file_name(files[i]) + "\n";
+  }
+  return names;
 }
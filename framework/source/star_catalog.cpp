@@ -0,0 +1,258 @@
+#include "star_catalog.hpp"
+
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+static std::vector<catalog_star> parse_lines(char const* begin, char const* end, std::vector<int> const& columns, float scale, float max_distance);
+static std::uint16_t quantize(float value, float min, float extent);
+static std::uint16_t pack_color(glm::fvec3 const& color);
+
+namespace star_catalog {
+
+// columns of interest
+enum column {X = 0, Y, Z, MAG, CI, NUM_COLUMNS};
+
+std::vector<catalog_star> parse(std::string const& file_path, float scale, float max_distance, thread_pool& pool) {
+  std::string text{utils::read_file(file_path)};
+
+  // find columns in header line
+  std::size_t header_end = text.find('\n');
+  std::istringstream header{text.substr(0, header_end)};
+  std::vector<int> columns(NUM_COLUMNS, -1);
+  std::string name{};
+  for (int index = 0; std::getline(header, name, ','); ++index) {
+    // strip quotes and carriage returns
+    name.erase(std::remove_if(name.begin(), name.end(), [](char c){ return c == '"' || c == '\r' || c == ' '; }), name.end());
+    if (name == "x") columns[X] = index;
+    else if (name == "y") columns[Y] = index;
+    else if (name == "z") columns[Z] = index;
+    else if (name == "mag") columns[MAG] = index;
+    else if (name == "ci") columns[CI] = index;
+  }
+  if (columns[X] < 0 || columns[Y] < 0 || columns[Z] < 0 || columns[MAG] < 0) {
+    throw std::invalid_argument("star_catalog: " + file_path + " lacks x, y, z or mag column");
+  }
+  if (header_end == std::string::npos) {
+    return std::vector<catalog_star>{};
+  }
+
+  // split into ranges of whole lines, two per worker to even out their lengths
+  std::size_t num_ranges = std::max<std::size_t>(pool.size(), 1) * 2;
+  char const* data = text.data();
+  std::vector<char const*> bounds{data + header_end + 1};
+  for (std::size_t i = 1; i < num_ranges; ++i) {
+    std::size_t split = std::max(header_end + 1 + (text.size() - header_end - 1) * i / num_ranges, std::size_t(bounds.back() - data));
+    std::size_t line_end = text.find('\n', split);
+    bounds.push_back(line_end == std::string::npos ? data + text.size() : data + line_end + 1);
+  }
+  bounds.push_back(data + text.size());
+
+  std::vector<std::vector<catalog_star>> parts(num_ranges);
+  pool.parallel_for(num_ranges, [&](std::size_t i){
+    parts[i] = parse_lines(bounds[i], bounds[i + 1], columns, scale, max_distance);
+  });
+  std::size_t num_stars = 0;
+  for (auto const& part : parts) {
+    num_stars += part.size();
+  }
+
+  std::vector<catalog_star> stars{};
+  stars.reserve(num_stars);
+  for (auto const& part : parts) {
+    stars.insert(stars.end(), part.begin(), part.end());
+  }
+  return stars;
+}
+
+std::vector<catalog_star> generate(std::size_t count, float half_size, unsigned seed) {
+  std::mt19937 generator{seed};
+  std::uniform_real_distribution<float> position{-half_size, half_size};
+  std::uniform_real_distribution<float> unit{0.f, 1.f};
+
+  std::vector<catalog_star> stars(count);
+  for (auto& star : stars) {
+    star.position = glm::fvec3{position(generator), position(generator), position(generator)};
+    // faint stars are more common
+    star.magnitude = 8.f * std::cbrt(unit(generator));
+    star.color = glm::fvec3{unit(generator), unit(generator), unit(generator)};
+  }
+  return stars;
+}
+
+starfield build(std::vector<catalog_star> stars, std::size_t chunk_size) {
+  starfield field{};
+  field.min_magnitude = 0.f;
+  field.magnitude_step = 1.f;
+  if (stars.empty()) {
+    return field;
+  }
+  chunk_size = std::max(chunk_size, std::size_t(1));
+
+  float max_magnitude = std::numeric_limits<float>::lowest();
+  field.min_magnitude = std::numeric_limits<float>::max();
+  for (auto const& star : stars) {
+    field.min_magnitude = std::min(field.min_magnitude, star.magnitude);
+    max_magnitude = std::max(max_magnitude, star.magnitude);
+  }
+  std::size_t num_bins = std::tuple_size<decltype(star_chunk::counts)>::value;
+  field.magnitude_step = std::max((max_magnitude - field.min_magnitude) / float(num_bins), 1e-6f);
+
+  // kd split at the median of the longest axis until ranges fit into a chunk
+  std::vector<std::pair<std::size_t, std::size_t>> ranges{{0, stars.size()}};
+  std::vector<std::pair<std::size_t, std::size_t>> leaves{};
+  while (!ranges.empty()) {
+    std::pair<std::size_t, std::size_t> range = ranges.back();
+    ranges.pop_back();
+    if (range.second - range.first <= chunk_size) {
+      leaves.push_back(range);
+      continue;
+    }
+    glm::fvec3 min{std::numeric_limits<float>::max()};
+    glm::fvec3 max{std::numeric_limits<float>::lowest()};
+    for (std::size_t i = range.first; i < range.second; ++i) {
+      min = glm::min(min, stars[i].position);
+      max = glm::max(max, stars[i].position);
+    }
+    glm::fvec3 size = max - min;
+    int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+    std::size_t middle = range.first + (range.second - range.first) / 2;
+    std::nth_element(stars.begin() + range.first, stars.begin() + middle, stars.begin() + range.second,
+                     [axis](catalog_star const& a, catalog_star const& b){ return a.position[axis] < b.position[axis]; });
+    ranges.push_back(std::make_pair(range.first, middle));
+    ranges.push_back(std::make_pair(middle, range.second));
+  }
+  // keep neighbouring chunks close in memory
+  std::sort(leaves.begin(), leaves.end());
+
+  field.stars.resize(stars.size());
+  for (auto const& leaf : leaves) {
+    // brightest first, so every magnitude limit selects a prefix
+    std::sort(stars.begin() + leaf.first, stars.begin() + leaf.second,
+              [](catalog_star const& a, catalog_star const& b){ return a.magnitude < b.magnitude; });
+
+    star_chunk chunk{};
+    chunk.first = GLint(leaf.first);
+    glm::fvec3 max{std::numeric_limits<float>::lowest()};
+    chunk.min = glm::fvec3{std::numeric_limits<float>::max()};
+    for (std::size_t i = leaf.first; i < leaf.second; ++i) {
+      chunk.min = glm::min(chunk.min, stars[i].position);
+      max = glm::max(max, stars[i].position);
+    }
+    chunk.extent = max - chunk.min;
+
+    std::size_t bin = 0;
+    for (std::size_t i = leaf.first; i < leaf.second; ++i) {
+      catalog_star const& star = stars[i];
+      // close bins the star does not fall into
+      while (bin + 1 < num_bins && star.magnitude >= field.min_magnitude + float(bin + 1) * field.magnitude_step) {
+        chunk.counts[bin++] = GLsizei(i - leaf.first);
+      }
+      packed_star& packed = field.stars[i];
+      for (int axis = 0; axis < 3; ++axis) {
+        packed.position[axis] = quantize(star.position[axis], chunk.min[axis], chunk.extent[axis]);
+      }
+      packed.color = pack_color(star.color);
+    }
+    for (; bin < num_bins; ++bin) {
+      chunk.counts[bin] = GLsizei(leaf.second - leaf.first);
+    }
+    field.chunks.push_back(chunk);
+  }
+  return field;
+}
+
+GLsizei visible_count(starfield const& field, star_chunk const& chunk, float max_magnitude) {
+  float bin = std::ceil((max_magnitude - field.min_magnitude) / field.magnitude_step) - 1.f;
+  if (bin < 0.f) {
+    return 0;
+  }
+  return chunk.counts[std::min(std::size_t(bin), chunk.counts.size() - 1)];
+}
+
+bool in_frustum(std::vector<glm::fvec4> const& planes, star_chunk const& chunk) {
+  for (auto const& plane : planes) {
+    // corner farthest along the plane normal
+    glm::fvec3 corner = chunk.min + glm::fvec3{plane.x > 0.f ? chunk.extent.x : 0.f,
+                                               plane.y > 0.f ? chunk.extent.y : 0.f,
+                                               plane.z > 0.f ? chunk.extent.z : 0.f};
+    if (glm::dot(glm::fvec3{plane}, corner) + plane.w < 0.f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+glm::fvec3 color_index_to_rgb(float bv) {
+  bv = std::min(std::max(bv, -0.4f), 2.f);
+  // black body temperature after Ballesteros
+  float temperature = 4600.f * (1.f / (0.92f * bv + 1.7f) + 1.f / (0.92f * bv + 0.62f));
+  // rough fit of black body colors, white at 6500 K
+  float t = temperature / 100.f;
+  float r = t <= 66.f ? 1.f : 1.29293618f * std::pow(t - 60.f, -0.1332047592f);
+  float g = t <= 66.f ? 0.39008157f * std::log(t) - 0.63184144f : 1.12989086f * std::pow(t - 60.f, -0.0755148492f);
+  float b = t >= 66.f ? 1.f : (t <= 19.f ? 0.f : 0.54320679f * std::log(t - 10.f) - 1.19625409f);
+  return glm::clamp(glm::fvec3{r, g, b}, 0.f, 1.f);
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static std::vector<catalog_star> parse_lines(char const* begin, char const* end, std::vector<int> const& columns, float scale, float max_distance) {
+  int last_column = *std::max_element(columns.begin(), columns.end());
+  std::vector<catalog_star> stars{};
+  char const* line = begin;
+  while (line < end) {
+    char const* line_end = std::find(line, end, '\n');
+    // values of x, y, z, mag and ci, color index defaults to the sun
+    float values[star_catalog::NUM_COLUMNS] = {0.f, 0.f, 0.f, 0.f, 0.65f};
+    int found = 0;
+    char const* field = line;
+    for (int index = 0; index <= last_column && field < line_end; ++index) {
+      for (int c = 0; c < star_catalog::NUM_COLUMNS; ++c) {
+        if (columns[c] == index) {
+          char* number_end = nullptr;
+          float value = std::strtof(field, &number_end);
+          // empty fields keep the default
+          if (number_end != field && number_end <= line_end) {
+            values[c] = value;
+            found += c < star_catalog::CI ? 1 : 0;
+          }
+        }
+      }
+      field = std::find(field, line_end, ',');
+      field = field < line_end ? field + 1 : field;
+    }
+    line = line_end + 1;
+
+    glm::fvec3 position{values[star_catalog::X], values[star_catalog::Y], values[star_catalog::Z]};
+    float distance = glm::length(position);
+    // the scene has its own sun, unknown distances are stored as huge values
+    if (found < 4 || distance <= 0.f || distance > max_distance) {
+      continue;
+    }
+    stars.push_back(catalog_star{position * scale, values[star_catalog::MAG], star_catalog::color_index_to_rgb(values[star_catalog::CI])});
+  }
+  return stars;
+}
+
+static std::uint16_t quantize(float value, float min, float extent) {
+  if (extent <= 0.f) {
+    return 0;
+  }
+  return std::uint16_t(std::lround((value - min) / extent * 65535.f));
+}
+
+static std::uint16_t pack_color(glm::fvec3 const& color) {
+  glm::fvec3 clamped = glm::clamp(color, 0.f, 1.f);
+  unsigned r = unsigned(std::lround(clamped.r * 31.f));
+  unsigned g = unsigned(std::lround(clamped.g * 63.f));
+  unsigned b = unsigned(std::lround(clamped.b * 31.f));
+  return std::uint16_t((r << 11) | (g << 5) | b);
+}
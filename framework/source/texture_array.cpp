@@ -0,0 +1,162 @@
+#include "texture_array.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+static std::size_t num_channels(GLenum channels);
+
+namespace texture_array {
+
+pixel_data resize(pixel_data const& image, std::size_t width, std::size_t height) {
+  if (image.width == width && image.height == height) {
+    return image;
+  }
+  std::size_t components = num_channels(image.channels);
+  std::vector<std::uint8_t> pixels(width * height * components);
+
+  float scale_x = float(image.width) / float(width);
+  float scale_y = float(image.height) / float(height);
+  for (std::size_t y = 0; y < height; ++y) {
+    // sample position in source texel space
+    float src_y = std::max((float(y) + 0.5f) * scale_y - 0.5f, 0.f);
+    std::size_t y0 = std::min(std::size_t(src_y), image.height - 1);
+    std::size_t y1 = std::min(y0 + 1, image.height - 1);
+    float fy = src_y - float(y0);
+
+    for (std::size_t x = 0; x < width; ++x) {
+      float src_x = std::max((float(x) + 0.5f) * scale_x - 0.5f, 0.f);
+      std::size_t x0 = std::min(std::size_t(src_x), image.width - 1);
+      std::size_t x1 = std::min(x0 + 1, image.width - 1);
+      float fx = src_x - float(x0);
+
+      for (std::size_t c = 0; c < components; ++c) {
+        float p00 = image.pixels[(y0 * image.width + x0) * components + c];
+        float p01 = image.pixels[(y0 * image.width + x1) * components + c];
+        float p10 = image.pixels[(y1 * image.width + x0) * components + c];
+        float p11 = image.pixels[(y1 * image.width + x1) * components + c];
+        float top = p00 + (p01 - p00) * fx;
+        float bottom = p10 + (p11 - p10) * fx;
+        pixels[(y * width + x) * components + c] = std::uint8_t(std::lround(top + (bottom - top) * fy));
+      }
+    }
+  }
+  return pixel_data{pixels, image.channels, image.channel_type, width, height};
+}
+
+pixel_data convert(pixel_data const& image, GLenum channels) {
+  if (image.channels == channels) {
+    return image;
+  }
+  std::size_t src_components = num_channels(image.channels);
+  std::size_t dst_components = num_channels(channels);
+  std::size_t num_pixels = image.width * image.height;
+  std::vector<std::uint8_t> pixels(num_pixels * dst_components);
+
+  for (std::size_t i = 0; i < num_pixels; ++i) {
+    std::uint8_t const* src = &image.pixels[i * src_components];
+    std::uint8_t* dst = &pixels[i * dst_components];
+    for (std::size_t c = 0; c < dst_components; ++c) {
+      if (c == 3) {
+        // opaque if source has no alpha, grey alpha sits in second channel
+        dst[c] = src_components == 4 ? src[3] : (src_components == 2 ? src[1] : 255);
+      }
+      else if (src_components < 3) {
+        // replicate grey value
+        dst[c] = src[0];
+      }
+      else {
+        dst[c] = src[c];
+      }
+    }
+  }
+  return pixel_data{pixels, channels, image.channel_type, image.width, image.height};
+}
+
+std::vector<pixel_data> prepare(std::vector<pixel_data> const& images, std::size_t max_size) {
+  if (images.empty()) {
+    throw std::invalid_argument("texture_array: no layers given");
+  }
+  // most common resolution wins, ties go to the larger one
+  std::map<std::pair<std::size_t, std::size_t>, unsigned> resolutions{};
+  bool has_alpha = false;
+  for (auto const& image : images) {
+    if (image.pixels.empty()) {
+      continue;
+    }
+    ++resolutions[std::make_pair(image.width, image.height)];
+    has_alpha = has_alpha || image.channels == GL_RGBA || image.channels == GL_RG;
+  }
+  std::pair<std::size_t, std::size_t> resolution{1, 1};
+  unsigned max_count = 0;
+  for (auto const& pair : resolutions) {
+    if (pair.second >= max_count) {
+      resolution = pair.first;
+      max_count = pair.second;
+    }
+  }
+  resolution.first = std::min(resolution.first, max_size);
+  resolution.second = std::min(resolution.second, max_size);
+
+  GLenum channels = has_alpha ? GL_RGBA : GL_RGB;
+
+  std::vector<pixel_data> layers{};
+  for (auto const& image : images) {
+    if (image.pixels.empty()) {
+      // missing image, fill layer with white
+      layers.push_back(pixel_data{std::vector<std::uint8_t>(resolution.first * resolution.second * num_channels(channels), 255),
+                                  channels, GL_UNSIGNED_BYTE, resolution.first, resolution.second});
+    }
+    else {
+      layers.push_back(resize(convert(image, channels), resolution.first, resolution.second));
+    }
+  }
+  return layers;
+}
+
+texture_object allocate(cooked_texture const& format, std::size_t num_layers) {
+  texture_object t_obj{};
+  t_obj.target = GL_TEXTURE_2D_ARRAY;
+  glGenTextures(1, &t_obj.handle);
+  glBindTexture(t_obj.target, t_obj.handle);
+  // without a complete chain sample only the base level
+  bool has_chain = format.levels.size() > 1;
+  glTexParameteri(t_obj.target, GL_TEXTURE_MIN_FILTER, has_chain ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(t_obj.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(t_obj.target, GL_TEXTURE_MAX_LEVEL, GLint(format.levels.size()) - 1);
+
+  for (std::size_t i = 0; i < format.levels.size(); ++i) {
+    GLsizei width = GLsizei(format.levels[i].width);
+    GLsizei height = GLsizei(format.levels[i].height);
+    if (format.compressed) {
+      // size of all layers of the level in blocks
+      std::size_t blocks = ((format.levels[i].width + 3) / 4) * ((format.levels[i].height + 3) / 4) * num_layers;
+      bool small_blocks = format.internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format.internal_format == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+      glCompressedTexImage3D(t_obj.target, GLint(i), format.internal_format, width, height, GLsizei(num_layers), 0,
+                             GLsizei(blocks * (small_blocks ? 8 : 16)), NULL);
+    }
+    else {
+      glTexImage3D(t_obj.target, GLint(i), GLint(format.internal_format), width, height, GLsizei(num_layers), 0,
+                   format.channels, format.channel_type, NULL);
+    }
+  }
+  return t_obj;
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static std::size_t num_channels(GLenum channels) {
+  if (channels == GL_RED) return 1;
+  else if (channels == GL_RG) return 2;
+  else if (channels == GL_RGB) return 3;
+  else if (channels == GL_RGBA) return 4;
+  throw std::invalid_argument("texture_array: unsupported channel format");
+}
@@ -0,0 +1,607 @@
+#include "texture_cooker.hpp"
+
+#include <glbinding/gl/enum.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define TEXTURE_COOKER_SSE2
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+// 4x4 block of rgba texels
+typedef std::array<std::array<float, 4>, 16> color_block;
+
+static std::size_t num_channels(GLenum channels);
+static float srgb_to_linear(std::uint8_t value);
+static std::uint8_t linear_to_srgb(float value);
+static void box_reduce_sse2(pixel_data const& src, pixel_data& dst);
+static std::vector<float> kaiser_weights(int& first_tap);
+static color_block load_block(pixel_data const& level, std::size_t block_x, std::size_t block_y);
+static void encode_bc1(color_block const& block, std::uint8_t* out);
+static void encode_bc4_alpha(color_block const& block, std::uint8_t* out);
+static void encode_bc7(color_block const& block, std::uint8_t* out);
+
+namespace texture_cooker {
+
+pixel_data downsample(pixel_data const& level, mip_filter filter, bool srgb) {
+  std::size_t components = num_channels(level.channels);
+  std::size_t width = std::max<std::size_t>(level.width / 2, 1);
+  std::size_t height = std::max<std::size_t>(level.height / 2, 1);
+  pixel_data reduced{std::vector<std::uint8_t>(width * height * components), level.channels, level.channel_type, width, height};
+
+  // fast path for the common case of linear rgba with even size
+  if (filter == mip_filter::box && !srgb && components == 4 && level.width % 2 == 0 && level.height % 2 == 0) {
+    box_reduce_sse2(level, reduced);
+    return reduced;
+  }
+
+  // alpha is never srgb encoded
+  std::size_t color_components = (components == 2 || components == 4) ? components - 1 : components;
+  auto to_float = [&](std::size_t x, std::size_t y, std::size_t c) -> float {
+    x = std::min(x, level.width - 1);
+    y = std::min(y, level.height - 1);
+    std::uint8_t value = level.pixels[(y * level.width + x) * components + c];
+    return (srgb && c < color_components) ? srgb_to_linear(value) : float(value) / 255.f;
+  };
+  auto to_byte = [&](float value, std::size_t c) -> std::uint8_t {
+    value = std::min(std::max(value, 0.f), 1.f);
+    return (srgb && c < color_components) ? linear_to_srgb(value) : std::uint8_t(std::lround(value * 255.f));
+  };
+
+  if (filter == mip_filter::box) {
+    for (std::size_t y = 0; y < height; ++y) {
+      for (std::size_t x = 0; x < width; ++x) {
+        for (std::size_t c = 0; c < components; ++c) {
+          float sum = to_float(2 * x, 2 * y, c) + to_float(2 * x + 1, 2 * y, c)
+                    + to_float(2 * x, 2 * y + 1, c) + to_float(2 * x + 1, 2 * y + 1, c);
+          reduced.pixels[(y * width + x) * components + c] = to_byte(sum * 0.25f, c);
+        }
+      }
+    }
+    return reduced;
+  }
+
+  // separable kaiser windowed sinc, horizontal pass into float buffer
+  int first_tap = 0;
+  std::vector<float> weights = kaiser_weights(first_tap);
+  std::vector<float> horizontal(width * level.height * components);
+  for (std::size_t y = 0; y < level.height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      for (std::size_t c = 0; c < components; ++c) {
+        float sum = 0.f;
+        for (std::size_t t = 0; t < weights.size(); ++t) {
+          long src_x = long(2 * x) + first_tap + long(t);
+          src_x = std::min(std::max(src_x, 0l), long(level.width) - 1);
+          sum += weights[t] * to_float(std::size_t(src_x), y, c);
+        }
+        horizontal[(y * width + x) * components + c] = sum;
+      }
+    }
+  }
+  // vertical pass
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      for (std::size_t c = 0; c < components; ++c) {
+        float sum = 0.f;
+        for (std::size_t t = 0; t < weights.size(); ++t) {
+          long src_y = long(2 * y) + first_tap + long(t);
+          src_y = std::min(std::max(src_y, 0l), long(level.height) - 1);
+          sum += weights[t] * horizontal[(std::size_t(src_y) * width + x) * components + c];
+        }
+        reduced.pixels[(y * width + x) * components + c] = to_byte(sum, c);
+      }
+    }
+  }
+  return reduced;
+}
+
+std::vector<pixel_data> mip_chain(pixel_data const& image, mip_filter filter, bool srgb) {
+  std::vector<pixel_data> levels{image};
+  while (levels.back().width > 1 || levels.back().height > 1) {
+    // reduce from previous level, kaiser footprint covers the lost detail
+    levels.push_back(downsample(levels.back(), filter, srgb));
+  }
+  return levels;
+}
+
+std::vector<std::uint8_t> compress(pixel_data const& level, block_format format) {
+  if (level.channels != GL_RGBA) {
+    throw std::invalid_argument("texture_cooker: block compression requires rgba input");
+  }
+  std::size_t blocks_x = (level.width + 3) / 4;
+  std::size_t blocks_y = (level.height + 3) / 4;
+  std::size_t block_bytes = format == block_format::bc1 ? 8 : 16;
+  std::vector<std::uint8_t> blocks(blocks_x * blocks_y * block_bytes);
+
+  for (std::size_t by = 0; by < blocks_y; ++by) {
+    for (std::size_t bx = 0; bx < blocks_x; ++bx) {
+      color_block block = load_block(level, bx, by);
+      std::uint8_t* out = &blocks[(by * blocks_x + bx) * block_bytes];
+      if (format == block_format::bc1) {
+        encode_bc1(block, out);
+      }
+      else if (format == block_format::bc3) {
+        // alpha block followed by color block
+        encode_bc4_alpha(block, out);
+        encode_bc1(block, out + 8);
+      }
+      else if (format == block_format::bc7) {
+        encode_bc7(block, out);
+      }
+      else {
+        throw std::invalid_argument("texture_cooker: no block format given");
+      }
+    }
+  }
+  return blocks;
+}
+
+cooked_texture cook(pixel_data const& image, options const& opts) {
+  cooked_texture texture{};
+  texture.channels = image.channels;
+  texture.channel_type = GL_UNSIGNED_BYTE;
+  texture.compressed = opts.compression != block_format::none;
+
+  pixel_data source = image;
+  if (texture.compressed && image.channels != GL_RGBA) {
+    // block encoders work on rgba, expand input
+    std::size_t components = num_channels(image.channels);
+    std::vector<std::uint8_t> rgba(image.width * image.height * 4, 255);
+    for (std::size_t i = 0; i < image.width * image.height; ++i) {
+      for (std::size_t c = 0; c < 3; ++c) {
+        // grey images replicate their first channel
+        std::size_t src_c = components < 3 ? 0 : c;
+        rgba[i * 4 + c] = image.pixels[i * components + src_c];
+      }
+      if (components == 2) {
+        rgba[i * 4 + 3] = image.pixels[i * components + 1];
+      }
+    }
+    source = pixel_data{rgba, GL_RGBA, GL_UNSIGNED_BYTE, image.width, image.height};
+    texture.channels = GL_RGBA;
+  }
+
+  if (opts.compression == block_format::bc1) {
+    texture.internal_format = opts.srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  }
+  else if (opts.compression == block_format::bc3) {
+    texture.internal_format = opts.srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  }
+  else if (opts.compression == block_format::bc7) {
+    texture.internal_format = opts.srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+  else if (texture.channels == GL_RGBA) {
+    texture.internal_format = opts.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  }
+  else if (texture.channels == GL_RGB) {
+    texture.internal_format = opts.srgb ? GL_SRGB8 : GL_RGB8;
+  }
+  else if (texture.channels == GL_RG) {
+    texture.internal_format = GL_RG8;
+  }
+  else {
+    texture.internal_format = GL_R8;
+  }
+
+  for (auto const& level : mip_chain(source, opts.filter, opts.srgb)) {
+    std::vector<std::uint8_t> bytes = texture.compressed ? compress(level, opts.compression) : level.pixels;
+    texture.levels.push_back(texture_level{level.width, level.height, bytes});
+  }
+  return texture;
+}
+
+void write(cooked_texture const& texture, std::string const& file_name) {
+  std::ofstream file(file_name, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("texture_cooker: could not open " + file_name);
+  }
+
+  header head{};
+  std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+  head.version = VERSION;
+  head.num_levels = std::uint32_t(texture.levels.size());
+  head.internal_format = static_cast<std::uint32_t>(texture.internal_format);
+  head.channels = static_cast<std::uint32_t>(texture.channels);
+  head.channel_type = static_cast<std::uint32_t>(texture.channel_type);
+  head.compressed = texture.compressed ? 1 : 0;
+
+  std::vector<level_entry> entries{};
+  std::uint64_t offset = sizeof(header) + sizeof(level_entry) * texture.levels.size();
+  for (auto const& level : texture.levels) {
+    entries.push_back(level_entry{std::uint32_t(level.width), std::uint32_t(level.height), offset, level.bytes.size()});
+    offset += level.bytes.size();
+  }
+
+  file.write(reinterpret_cast<char const*>(&head), sizeof(head));
+  file.write(reinterpret_cast<char const*>(entries.data()), std::streamsize(sizeof(level_entry) * entries.size()));
+  for (auto const& level : texture.levels) {
+    file.write(reinterpret_cast<char const*>(level.bytes.data()), std::streamsize(level.bytes.size()));
+  }
+  if (!file) {
+    throw std::runtime_error("texture_cooker: could not write " + file_name);
+  }
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static std::size_t num_channels(GLenum channels) {
+  if (channels == GL_RED) return 1;
+  else if (channels == GL_RG) return 2;
+  else if (channels == GL_RGB) return 3;
+  else if (channels == GL_RGBA) return 4;
+  throw std::invalid_argument("texture_cooker: unsupported channel format");
+}
+
+static float srgb_to_linear(std::uint8_t value) {
+  // table computed on first use
+  static std::array<float, 256> const table = []() {
+    std::array<float, 256> t{};
+    for (std::size_t i = 0; i < t.size(); ++i) {
+      float c = float(i) / 255.f;
+      t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return t;
+  }();
+  return table[value];
+}
+
+static std::uint8_t linear_to_srgb(float value) {
+  float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+  return std::uint8_t(std::lround(std::min(std::max(c, 0.f), 1.f) * 255.f));
+}
+
+// average 2x2 rgba8 texels, dst has half the even sized src resolution
+static void box_reduce_sse2(pixel_data const& src, pixel_data& dst) {
+  std::size_t x_start = 0;
+  for (std::size_t y = 0; y < dst.height; ++y) {
+    std::uint8_t const* row0 = &src.pixels[(2 * y) * src.width * 4];
+    std::uint8_t const* row1 = row0 + src.width * 4;
+    std::uint8_t* out = &dst.pixels[y * dst.width * 4];
+    x_start = 0;
+#ifdef TEXTURE_COOKER_SSE2
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const round = _mm_set1_epi16(2);
+    // four output texels from eight input texels of two rows per iteration
+    for (; x_start + 4 <= dst.width; x_start += 4) {
+      __m128i a0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row0 + x_start * 8));
+      __m128i a1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row0 + x_start * 8 + 16));
+      __m128i b0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row1 + x_start * 8));
+      __m128i b1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row1 + x_start * 8 + 16));
+      // vertical sums in 16 bit, each register holds two texels
+      __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+      __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+      __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+      __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+      // horizontal neighbours: add upper texel onto lower one
+      s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+      s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+      s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+      s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+      __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), round), 2);
+      __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), round), 2);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x_start * 4), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    // remaining texels
+    for (std::size_t x = x_start; x < dst.width; ++x) {
+      for (std::size_t c = 0; c < 4; ++c) {
+        unsigned sum = unsigned(row0[x * 8 + c]) + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c];
+        out[x * 4 + c] = std::uint8_t((sum + 2) / 4);
+      }
+    }
+  }
+}
+
+// zeroth order modified bessel function of the first kind
+static double bessel_i0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 32; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+// normalized taps of a kaiser windowed sinc for 2:1 reduction
+static std::vector<float> kaiser_weights(int& first_tap) {
+  // window half width in source texels and kaiser shape parameter
+  const double width = 3.0;
+  const double alpha = 4.0;
+  const double pi = 3.14159265358979323846;
+  // six taps around the destination texel center, which lies at source position 1
+  first_tap = -2;
+
+  std::vector<float> weights{};
+  double total = 0.0;
+  for (int t = 0; t < 6; ++t) {
+    // distance of source texel center to destination texel center in source texels
+    double d = double(first_tap + t) + 0.5 - 1.0;
+    double x = d / 2.0;
+    double sinc = std::abs(x) < 1e-8 ? 1.0 : std::sin(pi * x) / (pi * x);
+    double r = d / width;
+    double window = std::abs(r) >= 1.0 ? 0.0 : bessel_i0(alpha * std::sqrt(1.0 - r * r)) / bessel_i0(alpha);
+    weights.push_back(float(sinc * window));
+    total += sinc * window;
+  }
+  for (auto& weight : weights) {
+    weight = float(weight / total);
+  }
+  return weights;
+}
+
+// read block texels as floats in [0, 255], edge texels are repeated
+static color_block load_block(pixel_data const& level, std::size_t block_x, std::size_t block_y) {
+  color_block block{};
+  for (std::size_t i = 0; i < 16; ++i) {
+    std::size_t x = std::min(block_x * 4 + i % 4, level.width - 1);
+    std::size_t y = std::min(block_y * 4 + i / 4, level.height - 1);
+    for (std::size_t c = 0; c < 4; ++c) {
+      block[i][c] = float(level.pixels[(y * level.width + x) * 4 + c]);
+    }
+  }
+  return block;
+}
+
+// principal axis of the block colors in the first num_components channels
+static std::array<float, 4> principal_axis(color_block const& block, std::size_t num_components, std::array<float, 4>& mean) {
+  mean = std::array<float, 4>{};
+  for (auto const& texel : block) {
+    for (std::size_t c = 0; c < num_components; ++c) {
+      mean[c] += texel[c] / 16.f;
+    }
+  }
+  float covariance[4][4] = {};
+  for (auto const& texel : block) {
+    for (std::size_t i = 0; i < num_components; ++i) {
+      for (std::size_t j = 0; j < num_components; ++j) {
+        covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+      }
+    }
+  }
+  // power iteration
+  std::array<float, 4> axis{{1.f, 1.f, 1.f, 1.f}};
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    std::array<float, 4> next{};
+    float length = 0.f;
+    for (std::size_t i = 0; i < num_components; ++i) {
+      for (std::size_t j = 0; j < num_components; ++j) {
+        next[i] += covariance[i][j] * axis[j];
+      }
+      length += next[i] * next[i];
+    }
+    if (length < 1e-12f) {
+      break;
+    }
+    length = std::sqrt(length);
+    for (std::size_t i = 0; i < num_components; ++i) {
+      axis[i] = next[i] / length;
+    }
+  }
+  return axis;
+}
+
+// block texels with extreme projections onto the principal axis
+static void fit_endpoints(color_block const& block, std::size_t num_components, std::array<float, 4>& e0, std::array<float, 4>& e1) {
+  std::array<float, 4> mean{};
+  std::array<float, 4> axis = principal_axis(block, num_components, mean);
+  float min_proj = std::numeric_limits<float>::max();
+  float max_proj = -std::numeric_limits<float>::max();
+  for (auto const& texel : block) {
+    float proj = 0.f;
+    for (std::size_t c = 0; c < num_components; ++c) {
+      proj += (texel[c] - mean[c]) * axis[c];
+    }
+    if (proj < min_proj) {
+      min_proj = proj;
+      e0 = texel;
+    }
+    if (proj > max_proj) {
+      max_proj = proj;
+      e1 = texel;
+    }
+  }
+}
+
+static std::uint16_t to_565(std::array<float, 4> const& color) {
+  unsigned r = unsigned(std::lround(std::min(std::max(color[0], 0.f), 255.f) * 31.f / 255.f));
+  unsigned g = unsigned(std::lround(std::min(std::max(color[1], 0.f), 255.f) * 63.f / 255.f));
+  unsigned b = unsigned(std::lround(std::min(std::max(color[2], 0.f), 255.f) * 31.f / 255.f));
+  return std::uint16_t((r << 11) | (g << 5) | b);
+}
+
+static std::array<float, 4> from_565(std::uint16_t color) {
+  return std::array<float, 4>{{float((color >> 11) & 31) * 255.f / 31.f,
+                               float((color >> 5) & 63) * 255.f / 63.f,
+                               float(color & 31) * 255.f / 31.f, 255.f}};
+}
+
+static float distance_squared(std::array<float, 4> const& a, std::array<float, 4> const& b, std::size_t num_components) {
+  float sum = 0.f;
+  for (std::size_t c = 0; c < num_components; ++c) {
+    sum += (a[c] - b[c]) * (a[c] - b[c]);
+  }
+  return sum;
+}
+
+// 565 endpoints and 2 bit indices, always in four color mode
+static void encode_bc1(color_block const& block, std::uint8_t* out) {
+  std::array<float, 4> e0{};
+  std::array<float, 4> e1{};
+  fit_endpoints(block, 3, e0, e1);
+  std::uint16_t c0 = to_565(e1);
+  std::uint16_t c1 = to_565(e0);
+  // four color mode requires c0 > c1
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+  std::uint32_t indices = 0;
+  if (c0 != c1) {
+    std::array<std::array<float, 4>, 4> palette{};
+    palette[0] = from_565(c0);
+    palette[1] = from_565(c1);
+    for (std::size_t c = 0; c < 3; ++c) {
+      palette[2][c] = (2.f * palette[0][c] + palette[1][c]) / 3.f;
+      palette[3][c] = (palette[0][c] + 2.f * palette[1][c]) / 3.f;
+    }
+    for (std::size_t i = 0; i < 16; ++i) {
+      std::uint32_t best = 0;
+      float best_error = std::numeric_limits<float>::max();
+      for (std::uint32_t p = 0; p < 4; ++p) {
+        float error = distance_squared(block[i], palette[p], 3);
+        if (error < best_error) {
+          best_error = error;
+          best = p;
+        }
+      }
+      indices |= best << (2 * i);
+    }
+  }
+  out[0] = std::uint8_t(c0 & 0xFF);
+  out[1] = std::uint8_t(c0 >> 8);
+  out[2] = std::uint8_t(c1 & 0xFF);
+  out[3] = std::uint8_t(c1 >> 8);
+  for (std::size_t i = 0; i < 4; ++i) {
+    out[4 + i] = std::uint8_t((indices >> (8 * i)) & 0xFF);
+  }
+}
+
+// 8 bit alpha endpoints and 3 bit indices, eight value mode
+static void encode_bc4_alpha(color_block const& block, std::uint8_t* out) {
+  float min_alpha = 255.f;
+  float max_alpha = 0.f;
+  for (auto const& texel : block) {
+    min_alpha = std::min(min_alpha, texel[3]);
+    max_alpha = std::max(max_alpha, texel[3]);
+  }
+  std::uint8_t a0 = std::uint8_t(std::lround(max_alpha));
+  std::uint8_t a1 = std::uint8_t(std::lround(min_alpha));
+  out[0] = a0;
+  out[1] = a1;
+
+  std::uint64_t indices = 0;
+  if (a0 != a1) {
+    // code 0 is a0, 1 is a1, 2-7 interpolate from a0 towards a1
+    float palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    for (int i = 1; i < 7; ++i) {
+      palette[i + 1] = (float(7 - i) * a0 + float(i) * a1) / 7.f;
+    }
+    for (std::size_t i = 0; i < 16; ++i) {
+      std::uint64_t best = 0;
+      float best_error = std::numeric_limits<float>::max();
+      for (std::uint64_t p = 0; p < 8; ++p) {
+        float error = std::abs(block[i][3] - palette[p]);
+        if (error < best_error) {
+          best_error = error;
+          best = p;
+        }
+      }
+      indices |= best << (3 * i);
+    }
+  }
+  for (std::size_t i = 0; i < 6; ++i) {
+    out[2 + i] = std::uint8_t((indices >> (8 * i)) & 0xFF);
+  }
+}
+
+// appends bits to a 128 bit block, least significant bit first
+struct bit_writer {
+  std::uint8_t* out;
+  std::size_t position;
+
+  void write(std::uint32_t value, std::size_t bits) {
+    for (std::size_t i = 0; i < bits; ++i, ++position) {
+      if ((value >> i) & 1u) {
+        out[position / 8] = std::uint8_t(out[position / 8] | (1u << (position % 8)));
+      }
+    }
+  }
+};
+
+// mode 6: one subset, rgba endpoints with 7 bits plus p-bit, 4 bit indices
+static void encode_bc7(color_block const& block, std::uint8_t* out) {
+  static const std::uint32_t weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+  std::array<float, 4> e0{};
+  std::array<float, 4> e1{};
+  fit_endpoints(block, 4, e0, e1);
+
+  // quantize each endpoint to 7 bits per channel and choose the better p-bit
+  std::array<std::array<std::uint32_t, 4>, 2> quantized{};
+  std::array<std::uint32_t, 2> p_bits{};
+  std::array<float, 4> const* endpoints[2] = {&e0, &e1};
+  for (std::size_t e = 0; e < 2; ++e) {
+    float best_error = std::numeric_limits<float>::max();
+    for (std::uint32_t p = 0; p < 2; ++p) {
+      std::array<std::uint32_t, 4> q{};
+      float error = 0.f;
+      for (std::size_t c = 0; c < 4; ++c) {
+        float value = (*endpoints[e])[c];
+        long q7 = std::lround((value - float(p)) / 2.f);
+        q[c] = std::uint32_t(std::min(std::max(q7, 0l), 127l));
+        float restored = float((q[c] << 1) | p);
+        error += (restored - value) * (restored - value);
+      }
+      if (error < best_error) {
+        best_error = error;
+        quantized[e] = q;
+        p_bits[e] = p;
+      }
+    }
+  }
+
+  std::array<std::array<float, 4>, 16> palette{};
+  for (std::size_t i = 0; i < 16; ++i) {
+    for (std::size_t c = 0; c < 4; ++c) {
+      std::uint32_t v0 = (quantized[0][c] << 1) | p_bits[0];
+      std::uint32_t v1 = (quantized[1][c] << 1) | p_bits[1];
+      palette[i][c] = float(((64 - weights[i]) * v0 + weights[i] * v1 + 32) >> 6);
+    }
+  }
+  std::array<std::uint32_t, 16> indices{};
+  for (std::size_t i = 0; i < 16; ++i) {
+    float best_error = std::numeric_limits<float>::max();
+    for (std::uint32_t p = 0; p < 16; ++p) {
+      float error = distance_squared(block[i], palette[p], 4);
+      if (error < best_error) {
+        best_error = error;
+        indices[i] = p;
+      }
+    }
+  }
+  // most significant bit of the anchor index is implicit zero
+  if (indices[0] >= 8) {
+    std::swap(quantized[0], quantized[1]);
+    std::swap(p_bits[0], p_bits[1]);
+    for (auto& index : indices) {
+      index = 15 - index;
+    }
+  }
+
+  std::memset(out, 0, 16);
+  bit_writer writer{out, 0};
+  // mode 6 is encoded as six zero bits followed by a one
+  writer.write(1u << 6, 7);
+  for (std::size_t c = 0; c < 4; ++c) {
+    writer.write(quantized[0][c], 7);
+    writer.write(quantized[1][c], 7);
+  }
+  writer.write(p_bits[0], 1);
+  writer.write(p_bits[1], 1);
+  writer.write(indices[0], 3);
+  for (std::size_t i = 1; i < 16; ++i) {
+    writer.write(indices[i], 4);
+  }
+}
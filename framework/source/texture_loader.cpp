@@ -1,5 +1,8 @@
 #include "texture_loader.hpp"
 
+#include "cpu_profiler.hpp"
+#include "texture_cooker.hpp"
+
 // request supported types
 #define STBI_ONLY_JPEG
 #define STBI_ONLY_PNG
@@ -13,10 +16,12 @@
  
 #include <cstdint> 
 #include <cstring> 
+#include <fstream> 
 #include <stdexcept> 
 
 namespace texture_loader {
 pixel_data file(std::string const& file_name) {
+  PROFILE_SCOPE("texture_loader::file");
   // match to opengl representation
   stbi_set_flip_vertically_on_load(true);
 
@@ -24,7 +29,8 @@ pixel_data file(std::string const& file_name) {
   int width = 0;
   int height = 0;
   int format = STBI_default;
-  data_ptr = stbi_load(file_name.c_str(), &width, &height, &format, STBI_rgb_alpha);
+  // keep channels of file, format receives their number
+  data_ptr = stbi_load(file_name.c_str(), &width, &height, &format, STBI_default);
 
   if(!data_ptr) {
     throw std::logic_error(std::string{"stb_image: "} + stbi_failure_reason());
@@ -61,4 +67,46 @@ pixel_data file(std::string const& file_name) {
   return pixel_data{texture_data, pixel_format, GL_UNSIGNED_BYTE, std::size_t(width), std::size_t(height)};
 }
 
-}
\ No newline at end of file
+cooked_texture cooked(std::string const& file_name) {
+  PROFILE_SCOPE("texture_loader::cooked");
+  // single read of the whole container
+  std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+  if (!file) {
+    throw std::invalid_argument("texture_loader: could not open " + file_name);
+  }
+  std::vector<char> bytes(static_cast<std::size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(bytes.data(), std::streamsize(bytes.size()));
+
+  texture_cooker::header head{};
+  if (bytes.size() < sizeof(head)) {
+    throw std::logic_error("texture_loader: truncated container " + file_name);
+  }
+  std::memcpy(&head, bytes.data(), sizeof(head));
+  if (std::memcmp(head.magic, texture_cooker::MAGIC, sizeof(head.magic)) != 0 || head.version != texture_cooker::VERSION) {
+    throw std::logic_error("texture_loader: " + file_name + " is no cooked texture of version " + std::to_string(texture_cooker::VERSION));
+  }
+
+  cooked_texture texture{};
+  texture.internal_format = GLenum(head.internal_format);
+  texture.channels = GLenum(head.channels);
+  texture.channel_type = GLenum(head.channel_type);
+  texture.compressed = head.compressed != 0;
+
+  std::size_t entries_end = sizeof(head) + sizeof(texture_cooker::level_entry) * head.num_levels;
+  if (bytes.size() < entries_end) {
+    throw std::logic_error("texture_loader: truncated container " + file_name);
+  }
+  for (std::size_t i = 0; i < head.num_levels; ++i) {
+    texture_cooker::level_entry entry{};
+    std::memcpy(&entry, bytes.data() + sizeof(head) + sizeof(entry) * i, sizeof(entry));
+    if (entry.offset + entry.size > bytes.size()) {
+      throw std::logic_error("texture_loader: truncated container " + file_name);
+    }
+    char const* begin = bytes.data() + entry.offset;
+    texture.levels.push_back(texture_level{entry.width, entry.height, std::vector<std::uint8_t>(begin, begin + entry.size)});
+  }
+  return texture;
+}
+
+}
@@ -0,0 +1,204 @@
+#include "texture_streamer.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+static std::size_t num_channels(GLenum channels);
+
+texture_streamer::texture_streamer(std::size_t buffer_count, std::size_t buffer_bytes, std::size_t frame_budget)
+ :m_buffers(buffer_count)
+ ,m_requests{}
+ ,m_frame_budget{frame_budget}
+{
+  for (auto& buffer : m_buffers) {
+    glGenBuffers(1, &buffer.handle);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.handle);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(buffer_bytes), NULL, GL_STREAM_DRAW);
+    buffer.size = buffer_bytes;
+    buffer.fence = nullptr;
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+texture_streamer::~texture_streamer() {
+  for (auto& buffer : m_buffers) {
+    if (buffer.fence) {
+      glDeleteSync(buffer.fence);
+    }
+    glDeleteBuffers(1, &buffer.handle);
+  }
+}
+
+void texture_streamer::enqueue(texture_object const& texture, GLint level, GLint layer, pixel_data image, std::function<void()> on_complete) {
+  if (image.channel_type != GL_UNSIGNED_BYTE) {
+    throw std::invalid_argument("texture_streamer: only 8 bit channels are supported");
+  }
+  request req{};
+  req.texture = texture;
+  req.level = level;
+  req.layer = layer;
+  req.width = image.width;
+  req.height = image.height;
+  req.channels = image.channels;
+  req.channel_type = image.channel_type;
+  req.internal_format = GL_NONE;
+  req.compressed = false;
+  req.row_bytes = image.width * num_channels(image.channels);
+  req.row_height = 1;
+  req.next_row = 0;
+  req.bytes = std::move(image.pixels);
+  req.on_complete = std::move(on_complete);
+  m_requests.push_back(std::move(req));
+}
+
+void texture_streamer::enqueue(texture_object const& texture, GLint level, GLint layer, GLenum internal_format, texture_level data, std::function<void()> on_complete) {
+  std::size_t blocks_x = (data.width + 3) / 4;
+  std::size_t blocks_y = (data.height + 3) / 4;
+  request req{};
+  req.texture = texture;
+  req.level = level;
+  req.layer = layer;
+  req.width = data.width;
+  req.height = data.height;
+  req.channels = GL_NONE;
+  req.channel_type = GL_NONE;
+  req.internal_format = internal_format;
+  req.compressed = true;
+  // tiles consist of whole rows of 4x4 blocks
+  req.row_bytes = data.bytes.size() / blocks_y;
+  req.row_height = 4;
+  req.next_row = 0;
+  req.bytes = std::move(data.bytes);
+  req.on_complete = std::move(on_complete);
+  if (req.row_bytes * blocks_y != req.bytes.size() || req.row_bytes % blocks_x != 0) {
+    throw std::invalid_argument("texture_streamer: compressed level size does not match resolution");
+  }
+  m_requests.push_back(std::move(req));
+}
+
+void texture_streamer::update() {
+  std::size_t staged = 0;
+  // rows of rgb data are not 4 byte aligned for all widths
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  while (!m_requests.empty() && staged < m_frame_budget) {
+    request& req = m_requests.front();
+    staging_buffer* buffer = acquire(req.row_bytes);
+    if (!buffer) {
+      // gpu still reads all staging buffers, continue next frame
+      break;
+    }
+    staged += upload_tile(*buffer, req);
+
+    if (req.next_row >= req.height) {
+      std::function<void()> on_complete = std::move(req.on_complete);
+      m_requests.pop_front();
+      if (on_complete) {
+        on_complete();
+      }
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void texture_streamer::flush() {
+  std::size_t budget = m_frame_budget;
+  m_frame_budget = std::numeric_limits<std::size_t>::max();
+  while (!m_requests.empty()) {
+    update();
+  }
+  m_frame_budget = budget;
+}
+
+bool texture_streamer::idle() const {
+  return m_requests.empty();
+}
+
+std::size_t texture_streamer::pending_bytes() const {
+  std::size_t bytes = 0;
+  for (auto const& req : m_requests) {
+    bytes += req.bytes.size() - (req.next_row / req.row_height) * req.row_bytes;
+  }
+  return bytes;
+}
+
+texture_streamer::staging_buffer* texture_streamer::acquire(std::size_t bytes) {
+  // only polls fences, blocks on the first buffer when flushing
+  for (auto& buffer : m_buffers) {
+    if (buffer.fence) {
+      GLenum state = glClientWaitSync(buffer.fence, SyncObjectMask::GL_NONE_BIT, 0);
+      if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) {
+        continue;
+      }
+      glDeleteSync(buffer.fence);
+      buffer.fence = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.handle);
+    if (buffer.size < bytes) {
+      // single row does not fit, grow this buffer
+      buffer.size = bytes;
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(buffer.size), NULL, GL_STREAM_DRAW);
+    }
+    return &buffer;
+  }
+  if (m_frame_budget == std::numeric_limits<std::size_t>::max() && !m_buffers.empty()) {
+    // flushing, wait for the first buffer
+    glClientWaitSync(m_buffers.front().fence, SyncObjectMask::GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+    return acquire(bytes);
+  }
+  return nullptr;
+}
+
+std::size_t texture_streamer::upload_tile(staging_buffer& buffer, request& req) {
+  // as many whole rows as fit into the buffer
+  std::size_t rows = std::max<std::size_t>(buffer.size / req.row_bytes, 1);
+  std::size_t first_row = req.next_row;
+  std::size_t last_row = std::min(first_row + rows * req.row_height, req.height);
+  std::size_t tile_rows = (last_row - first_row + req.row_height - 1) / req.row_height;
+  std::size_t tile_bytes = tile_rows * req.row_bytes;
+  std::size_t offset = (first_row / req.row_height) * req.row_bytes;
+
+  // buffer is bound by acquire, invalidate instead of waiting for previous contents
+  void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(tile_bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  std::memcpy(staging, req.bytes.data() + offset, tile_bytes);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  GLint y = GLint(first_row);
+  GLsizei width = GLsizei(req.width);
+  GLsizei height = GLsizei(last_row - first_row);
+  bool layered = req.texture.target == GL_TEXTURE_2D_ARRAY;
+  glBindTexture(req.texture.target, req.texture.handle);
+  // data pointer is an offset into the bound unpack buffer
+  if (req.compressed && layered) {
+    glCompressedTexSubImage3D(req.texture.target, req.level, 0, y, req.layer, width, height, 1, req.internal_format, GLsizei(tile_bytes), NULL);
+  }
+  else if (req.compressed) {
+    glCompressedTexSubImage2D(req.texture.target, req.level, 0, y, width, height, req.internal_format, GLsizei(tile_bytes), NULL);
+  }
+  else if (layered) {
+    glTexSubImage3D(req.texture.target, req.level, 0, y, req.layer, width, height, 1, req.channels, req.channel_type, NULL);
+  }
+  else {
+    glTexSubImage2D(req.texture.target, req.level, 0, y, width, height, req.channels, req.channel_type, NULL);
+  }
+  buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, UnusedMask::GL_UNUSED_BIT);
+
+  req.next_row = last_row;
+  return tile_bytes;
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static std::size_t num_channels(GLenum channels) {
+  if (channels == GL_RED) return 1;
+  else if (channels == GL_RG) return 2;
+  else if (channels == GL_RGB) return 3;
+  else if (channels == GL_RGBA) return 4;
+  throw std::invalid_argument("texture_streamer: unsupported channel format");
+}
@@ -0,0 +1,122 @@
+#include "thread_pool.hpp"
+
+#include "cpu_profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+// indices of one parallel_for, shared with helper tasks which may start after it returned
+struct parallel_range {
+  std::function<void(std::size_t)> task;
+  std::size_t num_tasks;
+  std::atomic<std::size_t> next;
+  std::vector<std::exception_ptr> errors;
+  // finished indices, guarded by mutex
+  std::size_t finished;
+  std::mutex mutex;
+  std::condition_variable done;
+};
+
+static void run_range(parallel_range& range);
+
+thread_pool::thread_pool(std::size_t num_threads)
+ :m_threads{}
+ ,m_tasks{}
+ ,m_mutex{}
+ ,m_condition{}
+ ,m_stop{false}
+{
+  if (num_threads == 0) {
+    // hardware_concurrency may return 0 if unknown
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    m_threads.emplace_back(&thread_pool::work, this);
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void thread_pool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_tasks.push_back(std::move(task));
+  }
+  m_condition.notify_one();
+}
+
+std::size_t thread_pool::size() const {
+  return m_threads.size();
+}
+
+void thread_pool::parallel_for(std::size_t num_tasks, std::function<void(std::size_t)> const& task) {
+  if (num_tasks == 0) {
+    return;
+  }
+  std::shared_ptr<parallel_range> range = std::make_shared<parallel_range>();
+  range->task = task;
+  range->num_tasks = num_tasks;
+  range->next = 0;
+  range->errors.resize(num_tasks);
+  range->finished = 0;
+  // helpers finding no index left return immediately
+  for (std::size_t i = 1; i < std::min(num_tasks, size() + 1); ++i) {
+    submit([range](){ run_range(*range); });
+  }
+  run_range(*range);
+  // only indices already being worked on remain
+  {
+    std::unique_lock<std::mutex> lock{range->mutex};
+    range->done.wait(lock, [&range]{ return range->finished == range->num_tasks; });
+  }
+  for (auto const& error : range->errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+void thread_pool::work() {
+  PROFILE_THREAD("worker");
+  while (true) {
+    std::function<void()> task{};
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_condition.wait(lock, [this]{ return m_stop || !m_tasks.empty(); });
+      // remaining tasks are executed before stopping
+      if (m_tasks.empty()) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static void run_range(parallel_range& range) {
+  for (std::size_t i = range.next++; i < range.num_tasks; i = range.next++) {
+    try {
+      range.task(i);
+    }
+    catch (...) {
+      range.errors[i] = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock{range.mutex};
+    if (++range.finished == range.num_tasks) {
+      range.done.notify_all();
+    }
+  }
+}
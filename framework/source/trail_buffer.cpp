@@ -0,0 +1,84 @@
+#include "trail_buffer.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace trails {
+
+trail_buffer create(std::vector<glm::fvec4> const& colors, GLsizei length) {
+  if (colors.empty() || length < 2) {
+    throw std::invalid_argument("trails: need at least one trail with two samples");
+  }
+  trail_buffer trails{};
+  trails.num_trails = GLsizei(colors.size());
+  trails.length = length;
+  GLsizeiptr sample_bytes = GLsizeiptr(sizeof(glm::fvec4)) * trails.num_trails * length;
+
+  glGenBuffers(1, &trails.buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, trails.buffer);
+  glBufferData(GL_TEXTURE_BUFFER, sample_bytes + GLsizeiptr(sizeof(glm::fvec4) * colors.size()), NULL, GL_DYNAMIC_DRAW);
+  // colors never change, they follow the samples
+  glBufferSubData(GL_TEXTURE_BUFFER, sample_bytes, GLsizeiptr(sizeof(glm::fvec4) * colors.size()), colors.data());
+
+  trails.texture.target = GL_TEXTURE_BUFFER;
+  glGenTextures(1, &trails.texture.handle);
+  glBindTexture(GL_TEXTURE_BUFFER, trails.texture.handle);
+  // three component buffer textures need gl 4.0, so samples are padded to vec4
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, trails.buffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  // core profile needs a bound vertex array even without attributes
+  glGenVertexArrays(1, &trails.vertex_AO);
+  // first push writes slot 0
+  trails.head = length - 1;
+  return trails;
+}
+
+void push(trail_buffer& trails, std::vector<glm::fvec4> const& positions) {
+  if (GLsizei(positions.size()) != trails.num_trails) {
+    throw std::invalid_argument("trails: number of positions does not match number of trails");
+  }
+  trails.head = (trails.head + 1) % trails.length;
+  trails.filled = std::min(trails.filled + 1, trails.length);
+
+  GLsizeiptr slot_bytes = GLsizeiptr(sizeof(glm::fvec4)) * trails.num_trails;
+  glBindBuffer(GL_TEXTURE_BUFFER, trails.buffer);
+  glBufferSubData(GL_TEXTURE_BUFFER, slot_bytes * trails.head, slot_bytes, positions.data());
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void draw(trail_buffer const& trails, shader_program const& trail_program, GLuint texture_unit) {
+  if (trails.filled < 2) {
+    return;
+  }
+  glUniform1i(trail_program.u_locs.at("trail_samples"), GLint(texture_unit));
+  glUniform1i(trail_program.u_locs.at("trail_head"), trails.head);
+  glUniform1i(trail_program.u_locs.at("trail_length"), trails.length);
+  glUniform1i(trail_program.u_locs.at("num_trails"), trails.num_trails);
+
+  glActiveTexture(GLenum(unsigned(GL_TEXTURE0) + texture_unit));
+  glBindTexture(GL_TEXTURE_BUFFER, trails.texture.handle);
+  glBindVertexArray(trails.vertex_AO);
+  // vertex id is the age of the sample, instance id the trail
+  glDrawArraysInstanced(GL_LINE_STRIP, 0, trails.filled, trails.num_trails);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void clear(trail_buffer& trails) {
+  trails.head = trails.length - 1;
+  trails.filled = 0;
+}
+
+void destroy(trail_buffer& trails) {
+  glDeleteVertexArrays(1, &trails.vertex_AO);
+  glDeleteTextures(1, &trails.texture.handle);
+  glDeleteBuffers(1, &trails.buffer);
+  trails = trail_buffer{};
+}
+
+}
@@ -10,7 +10,9 @@ using namespace gl;
 #include <glm/gtc/type_precision.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cstdio>
 #include <iostream>
+#include <random>
 #include <sstream>
 #include <fstream>
 
@@ -96,17 +98,28 @@ std::string file_name(std::string const& file_path) {
   return file_path.substr(file_path.find_last_of("/\\") + 1);
 }
 
+std::uint64_t hash(void const* data, std::size_t size, std::uint64_t hash) {
+  unsigned char const* bytes = static_cast<unsigned char const*>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::uint64_t hash(std::string const& data, std::uint64_t hash) {
+  return utils::hash(data.data(), data.size(), hash);
+}
+
 std::string read_file(std::string const& name) {
-  std::ifstream ifile(name);
+  std::ifstream ifile(name, std::ios::binary);
 
   if(ifile) {
-    std::string filetext;
-    
-    while(ifile.good()) {
-      std::string line;
-      std::getline(ifile, line);
-      filetext.append(line + "\n");
-    }
+    // read whole file at once, catalogs and models can be large
+    ifile.seekg(0, std::ios::end);
+    std::string filetext(std::size_t(ifile.tellg()), '\0');
+    ifile.seekg(0, std::ios::beg);
+    ifile.read(&filetext[0], std::streamsize(filetext.size()));
     
     return filetext; 
   }
@@ -117,14 +130,48 @@ std::string read_file(std::string const& name) {
   }
 }
 
+std::string json_string(std::string const& text) {
+  std::string quoted{"\""};
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+    }
+    // control characters are not allowed in json strings
+    quoted += (c >= 0 && c < 0x20) ? ' ' : c;
+  }
+  return quoted + "\"";
+}
+
+std::string temporary_path(std::string const& path) {
+  // concurrent runs writing the same cache must not share a temporary
+  std::random_device random{};
+  std::ostringstream name{};
+  name << path << "." << std::hex << random() << random() << ".tmp";
+  return name.str();
+}
+
+bool replace_file(std::string const& temporary, std::string const& path) {
+#ifdef _WIN32
+  // rename does not replace existing files on windows
+  std::remove(path.c_str());
+#endif
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
 std::string read_resource_path(int argc, char* argv[]) {
   std::string resource_path{};
-  //first argument is resource path
-  if (argc > 1) {
-    resource_path = argv[1];
+  //first argument which is not an --option is resource path
+  for (int i = 1; i < argc && resource_path.empty(); ++i) {
+    if (std::string{argv[i]}.compare(0, 2, "--") != 0) {
+      resource_path = argv[i];
+    }
   }
   // no resource path specified, use default
-  else {
+  if (resource_path.empty()) {
     std::string exe_path{argv[0]};
     resource_path = exe_path.substr(0, exe_path.find_last_of("/\\"));
     resource_path += "/../../resources/";
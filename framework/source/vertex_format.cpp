@@ -0,0 +1,214 @@
+#include "vertex_format.hpp"
+
+#include "cpu_profiler.hpp"
+
+#include <glbinding/gl/enum.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static void compute_bounds(model const& source, packed_mesh& packed);
+static void single_lod(packed_mesh& packed);
+static GLfloat const* attribute_data(model const& source, std::size_t vertex, model::attrib_flag_t flag);
+static std::uint16_t to_unorm16(float value, float min, float max);
+static std::int16_t to_snorm16(float value);
+static float sign_not_zero(float value);
+
+packed_mesh::packed_mesh()
+ :vertices{}
+ ,indices{}
+ ,layout{}
+ ,vertex_bytes{0}
+ ,vertex_num{0}
+ ,index_num{0}
+ ,index_type{GL_UNSIGNED_INT}
+ ,quantized{false}
+ ,position_min{0.f}
+ ,position_max{0.f}
+ ,texcoord_min{0.f}
+ ,texcoord_max{0.f}
+ ,lods{}
+{}
+
+namespace vertex_format {
+
+packed_mesh pack(model const& source) {
+  packed_mesh packed{};
+  for (auto const& supported : model::VERTEX_ATTRIBS) {
+    auto offset = source.offsets.find(supported.flag);
+    if (offset != source.offsets.end()) {
+      packed.layout.push_back(supported);
+      packed.layout.back().offset = offset->second;
+    }
+  }
+  packed.vertex_bytes = source.vertex_bytes;
+  packed.vertex_num = source.vertex_num;
+  packed.index_num = source.indices.size();
+  packed.index_type = model::INDEX.type;
+  compute_bounds(source, packed);
+  single_lod(packed);
+
+  std::uint8_t const* vertices = reinterpret_cast<std::uint8_t const*>(source.data.data());
+  packed.vertices.assign(vertices, vertices + sizeof(GLfloat) * source.data.size());
+  std::uint8_t const* indices = reinterpret_cast<std::uint8_t const*>(source.indices.data());
+  packed.indices.assign(indices, indices + sizeof(GLuint) * source.indices.size());
+  return packed;
+}
+
+packed_mesh quantize(model const& source) {
+  PROFILE_SCOPE("vertex_format::quantize");
+  packed_mesh packed{};
+  packed.quantized = true;
+  packed.vertex_num = source.vertex_num;
+  packed.index_num = source.indices.size();
+  compute_bounds(source, packed);
+  single_lod(packed);
+
+  std::size_t vertex_bytes = 0;
+  for (auto const& supported : model::VERTEX_ATTRIBS) {
+    if (source.offsets.count(supported.flag) == 0) {
+      continue;
+    }
+    model::attribute encoded = supported;
+    if (supported.flag == model::POSITION.flag) {
+      encoded = model::POSITION_UNORM16;
+    }
+    else if (supported.flag == model::NORMAL.flag) {
+      encoded = model::NORMAL_OCT16;
+    }
+    else if (supported.flag == model::TEXCOORD.flag) {
+      encoded = model::TEXCOORD_UNORM16;
+    }
+    // attributes start at 4 byte boundaries
+    vertex_bytes = (vertex_bytes + 3) / 4 * 4;
+    encoded.offset = reinterpret_cast<GLvoid*>(std::uintptr_t(vertex_bytes));
+    vertex_bytes += std::size_t(encoded.size * encoded.components);
+    packed.layout.push_back(encoded);
+  }
+  vertex_bytes = (vertex_bytes + 3) / 4 * 4;
+  packed.vertex_bytes = GLsizei(vertex_bytes);
+
+  packed.vertices.resize(source.vertex_num * vertex_bytes);
+  for (std::size_t v = 0; v < source.vertex_num; ++v) {
+    for (auto const& attribute : packed.layout) {
+      GLfloat const* value = attribute_data(source, v, attribute.flag);
+      std::uint8_t* out = &packed.vertices[v * vertex_bytes + reinterpret_cast<std::uintptr_t>(attribute.offset)];
+      if (attribute.flag == model::POSITION.flag) {
+        std::uint16_t encoded[3];
+        for (int c = 0; c < 3; ++c) {
+          encoded[c] = to_unorm16(value[c], packed.position_min[c], packed.position_max[c]);
+        }
+        std::memcpy(out, encoded, sizeof(encoded));
+      }
+      else if (attribute.flag == model::NORMAL.flag) {
+        glm::fvec2 octahedral = encode_octahedral(glm::fvec3{value[0], value[1], value[2]});
+        std::int16_t encoded[2] = {to_snorm16(octahedral.x), to_snorm16(octahedral.y)};
+        std::memcpy(out, encoded, sizeof(encoded));
+      }
+      else if (attribute.flag == model::TEXCOORD.flag) {
+        std::uint16_t encoded[2];
+        for (int c = 0; c < 2; ++c) {
+          encoded[c] = to_unorm16(value[c], packed.texcoord_min[c], packed.texcoord_max[c]);
+        }
+        std::memcpy(out, encoded, sizeof(encoded));
+      }
+      else {
+        std::memcpy(out, value, std::size_t(attribute.size * attribute.components));
+      }
+    }
+  }
+
+  if (source.vertex_num <= std::size_t(std::numeric_limits<std::uint16_t>::max()) + 1) {
+    packed.index_type = model::INDEX_SHORT.type;
+    packed.indices.resize(sizeof(std::uint16_t) * source.indices.size());
+    for (std::size_t i = 0; i < source.indices.size(); ++i) {
+      std::uint16_t index = std::uint16_t(source.indices[i]);
+      std::memcpy(&packed.indices[i * sizeof(index)], &index, sizeof(index));
+    }
+  }
+  else {
+    packed.index_type = model::INDEX.type;
+    std::uint8_t const* indices = reinterpret_cast<std::uint8_t const*>(source.indices.data());
+    packed.indices.assign(indices, indices + sizeof(GLuint) * source.indices.size());
+  }
+  return packed;
+}
+
+glm::fvec2 encode_octahedral(glm::fvec3 const& normal) {
+  float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (sum == 0.f) {
+    return glm::fvec2{0.f};
+  }
+  glm::fvec3 n = normal / sum;
+  // lower hemisphere is folded over the diagonals
+  if (n.z < 0.f) {
+    return glm::fvec2{(1.f - std::abs(n.y)) * sign_not_zero(n.x), (1.f - std::abs(n.x)) * sign_not_zero(n.y)};
+  }
+  return glm::fvec2{n.x, n.y};
+}
+
+glm::fvec3 decode_octahedral(glm::fvec2 const& encoded) {
+  glm::fvec3 n{encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y)};
+  if (n.z < 0.f) {
+    n = glm::fvec3{(1.f - std::abs(encoded.y)) * sign_not_zero(encoded.x), (1.f - std::abs(encoded.x)) * sign_not_zero(encoded.y), n.z};
+  }
+  return glm::normalize(n);
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static void compute_bounds(model const& source, packed_mesh& packed) {
+  if (source.vertex_num == 0) {
+    return;
+  }
+  packed.position_min = glm::fvec3{std::numeric_limits<float>::max()};
+  packed.position_max = glm::fvec3{-std::numeric_limits<float>::max()};
+  bool has_texcoords = source.offsets.count(model::TEXCOORD) > 0;
+  if (has_texcoords) {
+    packed.texcoord_min = glm::fvec2{std::numeric_limits<float>::max()};
+    packed.texcoord_max = glm::fvec2{-std::numeric_limits<float>::max()};
+  }
+  for (std::size_t v = 0; v < source.vertex_num; ++v) {
+    GLfloat const* position = attribute_data(source, v, model::POSITION);
+    packed.position_min = glm::min(packed.position_min, glm::fvec3{position[0], position[1], position[2]});
+    packed.position_max = glm::max(packed.position_max, glm::fvec3{position[0], position[1], position[2]});
+    if (has_texcoords) {
+      GLfloat const* texcoord = attribute_data(source, v, model::TEXCOORD);
+      packed.texcoord_min = glm::min(packed.texcoord_min, glm::fvec2{texcoord[0], texcoord[1]});
+      packed.texcoord_max = glm::max(packed.texcoord_max, glm::fvec2{texcoord[0], texcoord[1]});
+    }
+  }
+}
+
+static void single_lod(packed_mesh& packed) {
+  packed.lods.assign(1, mesh_simplifier::level{0, packed.index_num, 0.f});
+}
+
+static GLfloat const* attribute_data(model const& source, std::size_t vertex, model::attrib_flag_t flag) {
+  std::size_t offset = reinterpret_cast<std::uintptr_t>(source.offsets.at(flag)) / sizeof(GLfloat);
+  return &source.data[vertex * std::size_t(source.vertex_bytes) / sizeof(GLfloat) + offset];
+}
+
+static std::uint16_t to_unorm16(float value, float min, float max) {
+  if (max <= min) {
+    return 0;
+  }
+  float normalized = std::min(std::max((value - min) / (max - min), 0.f), 1.f);
+  return std::uint16_t(std::lround(normalized * 65535.f));
+}
+
+static std::int16_t to_snorm16(float value) {
+  return std::int16_t(std::lround(std::min(std::max(value, -1.f), 1.f) * 32767.f));
+}
+
+static float sign_not_zero(float value) {
+  return value >= 0.f ? 1.f : -1.f;
+}
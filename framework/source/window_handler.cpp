@@ -3,8 +3,6 @@
 #include <glbinding/gl/gl.h>
 // load glbinding extensions
 #include <glbinding/Binding.h>
-// load meta info extension
-#include <glbinding/Meta.h>
 
 //dont load gl bindings from glfw
 #define GLFW_INCLUDE_NONE
@@ -28,16 +26,6 @@ using namespace gl;
 
 // helper functions
 static void glsl_error(int error, const char* description);
-static void watch_gl_errors(bool activate = true);
-static void APIENTRY openglCallbackFunction(
-  GLenum source,
-  GLenum type,
-  GLuint id,
-  GLenum severity,
-  GLsizei length,
-  const GLchar* message,
-  const void* userParam
-);
 
 namespace window_handler {
 
@@ -55,7 +43,7 @@ bool isCore()
     return (value & static_cast<unsigned int>(GL_CONTEXT_CORE_PROFILE_BIT)) > 0;
 }
 
-GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor) {
+GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor, bool debug_context) {
 
   glfwSetErrorCallback(glsl_error);
 
@@ -66,8 +54,8 @@ GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigne
   // set OGL version explicitly 
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, ver_major);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, ver_minor);
-  // enable deug support
-  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
+  // debug support is only requested for validation, drivers may be slower with it
+  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, debug_context);
 
   //MacOS requires forward compat core profile
   #ifdef __APPLE__
@@ -102,16 +90,6 @@ GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigne
   else {
     std::cout << " compat" << std::endl;
   }
-  // activate error checking after each gl function call
-  watch_gl_errors();
-
-  // Enable the debug callback
-  glEnable(GL_DEBUG_OUTPUT);
-  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-  glDebugMessageCallback(openglCallbackFunction, nullptr);
-  glDebugMessageControl(
-    GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, true
-  );
 
   return window;
 }
@@ -139,22 +117,11 @@ void set_callback_object(GLFWwindow* window, Application* app) {
 }
 
 
-// calculate fps and show in m_window title
-void show_fps(GLFWwindow* window) {
-    // variables for fps computation
-  static double m_last_second_time;
-  static unsigned m_frames_per_second;
-
-  ++m_frames_per_second;
-  double current_time = glfwGetTime();
-  if (current_time - m_last_second_time >= 1.0) {
-    std::string title{"OpenGL Framework - "};
-    title += std::to_string(m_frames_per_second) + " fps";
-
-    glfwSetWindowTitle(window, title.c_str());
-    m_frames_per_second = 0;
-    m_last_second_time = current_time;
-  }
+// show the given status text after the framework name in the window title
+void show_status(GLFWwindow* window, std::string const& status) {
+  std::string title{"OpenGL Framework - "};
+  title += status;
+  glfwSetWindowTitle(window, title.c_str());
 }
 
 void close_and_quit(GLFWwindow* window, int status) {
@@ -171,60 +138,3 @@ void close_and_quit(GLFWwindow* window, int status) {
 static void glsl_error(int error, const char* description) {
   std::cerr << "GLSL Error " << error << " : "<< description << std::endl;
 }
-
-static void APIENTRY openglCallbackFunction(
-  GLenum source,
-  GLenum type,
-  GLuint id,
-  GLenum severity,
-  GLsizei length,
-  const GLchar* message,
-  const void* userParam
-){
-  (void)source; (void)type; (void)id; 
-  (void)severity; (void)length; (void)userParam;
-  if (severity == GL_DEBUG_SEVERITY_NOTIFICATION || type == GL_DEBUG_TYPE_PERFORMANCE) {
-    return;
-  }
-  std::cerr << glbinding::Meta::getString(severity) << " - " << glbinding::Meta::getString(type) << ": ";
-  std::cerr << message << std::endl;
-  // if (severity != GL_DEBUG_SEVERITY_NOTIFICATION && type != GL_DEBUG_TYPE_PERFORMANCE) {
-  //   throw std::runtime_error{"OpenGL error"};
-  // }
-}
-
-static void watch_gl_errors(bool activate) {
-  if(activate) {
-    // add callback after each function call
-    glbinding::setCallbackMaskExcept(glbinding::CallbackMask::After | glbinding::CallbackMask::ParametersAndReturnValue, {"glGetError", "glBegin", "glVertex3f", "glColor3f"});
-    glbinding::setAfterCallback(
-      [](glbinding::FunctionCall const& call) {
-        GLenum error = glGetError();
-        if (error != GL_NO_ERROR) {
-          // print name
-          std::cerr <<  "OpenGL Error: " << call.function->name() << "(";
-          // parameters
-          for (unsigned i = 0; i < call.parameters.size(); ++i)
-          {
-            std::cerr << call.parameters[i]->asString();
-            if (i < call.parameters.size() - 1)
-              std::cerr << ", ";
-          }
-          std::cerr << ")";
-          // return value
-          if(call.returnValue) {
-            std::cerr << " -> " << call.returnValue->asString();
-          }
-          // error
-          std::cerr  << " - " << glbinding::Meta::getString(error) << std::endl;
-          // throw exception to allow for backtrace
-          throw std::runtime_error("OpenGl error: " + std::string(call.function->name()));
-          exit(EXIT_FAILURE);
-        }
-      }
-    );
-  }
-  else {
-    glbinding::setCallbackMask(glbinding::CallbackMask::None);
-  }
-}
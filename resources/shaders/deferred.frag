@@ -0,0 +1,32 @@
+#version 150
+
+out vec4 out_Color;
+
+// surface attributes written by simple.frag with GBUFFER defined
+uniform sampler2D gbuffer_albedo;
+uniform sampler2D gbuffer_normal;
+uniform sampler2D gbuffer_depth;
+// reconstructs world positions from window depth
+uniform mat4 InverseViewProjection;
+
+#include "lighting.glsl"
+
+// AMBIENT: fullscreen pass copying the depth, otherwise one light volume
+void main() {
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(gbuffer_depth, texel, 0).r;
+	// no surface, keep the background
+	if (depth == 1.0) {
+		discard;
+	}
+	vec3 albedo = texelFetch(gbuffer_albedo, texel, 0).rgb;
+#ifdef AMBIENT
+	gl_FragDepth = depth;
+	out_Color = vec4(ambient_light() * albedo, 1.0);
+#else
+	vec2 uv = gl_FragCoord.xy / vec2(textureSize(gbuffer_depth, 0));
+	vec4 position = InverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+	vec3 normal = texelFetch(gbuffer_normal, texel, 0).xyz;
+	out_Color = vec4(direct_light(position.xyz / position.w, normal) * albedo, 1.0);
+#endif
+}
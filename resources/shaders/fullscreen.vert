@@ -0,0 +1,7 @@
+#version 150
+
+void main() {
+	// fullscreen triangle from vertex ids 0, 1, 2
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+	gl_Position = vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 430
+
+in vec3 pass_Normal;
+in vec4 four_pass_position;
+in vec2 pass_Texture_Coor;
+flat in vec4 pass_Color;
+
+out vec4 out_Color;
+uniform sampler2DArray current_texture;
+
+#include "lighting.glsl"
+
+// lighting as in simple.frag, texture layer comes from the object buffer
+void main() {
+  vec3 I = blinn_phong(four_pass_position.xyz, pass_Normal);
+
+  vec4 color_from_tex = texture(current_texture, vec3(pass_Texture_Coor, pass_Color.w));
+
+  out_Color = vec4(I * color_from_tex.rgb, 1.0);
+}
@@ -0,0 +1,43 @@
+#version 430
+// vertex attributes of VAO
+layout(location = 0) in vec3 in_Position;
+layout(location = 1) in vec3 in_Normal;
+layout(location = 2) in vec2 in_Texture_Coor;
+// index into object buffer, advanced per instance
+layout(location = 3) in uint in_ObjectId;
+
+#include "vertex_format.glsl"
+
+struct object_data {
+  vec4 color;
+  vec4 bounds;
+};
+
+layout(std430, binding = 0) readonly buffer Objects {
+  object_data objects[];
+};
+layout(std430, binding = 3) readonly buffer Transforms {
+  mat4 transforms[];
+};
+
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+
+out vec3 pass_Normal;
+out vec4 four_pass_position;
+out vec2 pass_Texture_Coor;
+flat out vec4 pass_Color;
+
+void main(void)
+{
+	mat4 model_matrix = transforms[in_ObjectId];
+	// same as NormalMatrix uploaded in forward path
+	mat4 normal_matrix = transpose(inverse(ViewMatrix * model_matrix));
+
+	vec3 position = vertex_position(in_Position);
+	gl_Position = (ProjectionMatrix * ViewMatrix * model_matrix) * vec4(position, 1.0);
+	pass_Normal = (normal_matrix * vec4(vertex_normal(in_Normal), 1.0)).xyz;
+	four_pass_position = model_matrix * vec4(position, 1.0);
+	pass_Texture_Coor = vertex_texcoord(in_Texture_Coor);
+	pass_Color = objects[in_ObjectId].color;
+}
@@ -0,0 +1,15 @@
+#version 150
+#extension GL_ARB_explicit_attrib_location : require
+// unit sphere, scaled to the light radius
+layout(location = 0) in vec3 in_Position;
+
+#include "vertex_format.glsl"
+
+//Matrix Uniforms as specified with glUniformMatrix4fv
+uniform mat4 ModelMatrix;
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+
+void main() {
+	gl_Position = ProjectionMatrix * ViewMatrix * ModelMatrix * vec4(vertex_position(in_Position), 1.0);
+}
@@ -0,0 +1,45 @@
+// blinn-phong lighting shared by the planet shaders
+uniform float light_intensity;
+uniform vec3 light_color;
+uniform vec3 cam_position;
+uniform vec3 light_position;
+
+vec3 ambient_color = vec3(0.1f, 0.1f, 0.1f);
+vec3 diffuse_color = vec3(0.5f, 0.5f, 0.5f);
+vec3 specular_color = vec3(1.f, 1.f, 1.f);
+
+// light without direction, multiply with the surface color
+vec3 ambient_light() {
+  vec3 AMB =  ambient_color;
+  return AMB * ambient_color;
+}
+
+// diffuse and specular light of the point light, multiply with the surface color
+vec3 direct_light(vec3 position, vec3 normal) {
+  // Rewrote formula on page 8, of 4th slide from:
+  // I = I_a * k_a * O_d + f_att * I_d * [k_d * O_d * (NL) + k_s * O_s * (RV)]
+  // to:
+  // I = (I_a * k_a + f_att * I_d * k_d * (NL)) * O_d + f_att * k_s * O_s * (RV)
+  // I = (AMB + DIFF) * ambient_diffuse_color + SPEC * specular_color
+  // Keep in mind that the PLINN-PHONG model states: (RV) -> (NH), where H = L + V is halfway direct
+  // and that one I is calculated for R,G,B each
+
+  vec3 L = light_position - position; // Light direction vector
+  vec3 N = normal; // Normal vector
+  float f_att = 1/pow(length(L), 2.f);
+
+  vec3 DIFF = 10*light_intensity * light_color * f_att * max(dot(normalize(L), normalize(N)), 0.f);
+
+  vec3 V = cam_position - position; //View direction vector
+  vec3 H = normalize(L) + normalize(V);
+  float spec_pow = 60.f;
+  // more power to light color in spec
+  vec3 SPEC = 10*light_intensity * light_color * f_att * pow(max(dot(normalize(N), normalize(H)), 0.f), spec_pow);
+
+  return DIFF * diffuse_color + SPEC * specular_color;
+}
+
+// light reaching the camera from a surface point, multiply with the surface color
+vec3 blinn_phong(vec3 position, vec3 normal) {
+  return ambient_light() + direct_light(position, normal);
+}
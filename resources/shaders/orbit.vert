@@ -0,0 +1,20 @@
+#version 150
+#extension GL_ARB_explicit_attrib_location : require
+// point on the unit circle in the xz plane
+layout(location = 0) in vec2 in_Position;
+
+// two texels per ring: center and radius, color
+uniform samplerBuffer orbit_instances;
+
+//Matrix Uniforms uploaded with glUniform*
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+
+out vec3 pass_Color;
+
+void main() {
+	vec4 orbit = texelFetch(orbit_instances, gl_InstanceID * 2);
+	vec3 position = orbit.xyz + vec3(in_Position.x, 0.0, in_Position.y) * orbit.w;
+	gl_Position = ProjectionMatrix * ViewMatrix * vec4(position, 1.0);
+	pass_Color = texelFetch(orbit_instances, gl_InstanceID * 2 + 1).rgb;
+}
@@ -5,6 +5,8 @@ layout(location = 0) in vec3 in_Position;
 layout(location = 1) in vec3 in_Normal;
 layout(location = 2) in vec2 in_Texture_Coor;
 
+#include "vertex_format.glsl"
+
 //Matrix Uniforms as specified with glUniformMatrix4fv
 uniform mat4 ModelMatrix;
 uniform mat4 ViewMatrix;
@@ -19,13 +21,14 @@ out vec2 pass_Texture_Coor;
 
 void main(void)
 {
-	gl_Position = (ProjectionMatrix  * ViewMatrix * ModelMatrix) * vec4(in_Position, 1.0);
-	pass_Normal = (NormalMatrix * vec4(in_Normal, 1.0)).xyz;
+	vec3 position = vertex_position(in_Position);
+	gl_Position = (ProjectionMatrix  * ViewMatrix * ModelMatrix) * vec4(position, 1.0);
+	pass_Normal = (NormalMatrix * vec4(vertex_normal(in_Normal), 1.0)).xyz;
 	//Transform the rel. position matrix into our view and model space
-	four_pass_position = (ModelMatrix * vec4(in_Position, 1.0f));
-	pass_Position = (ModelMatrix * vec4(in_Position, 1.0f)).xyz;
+	four_pass_position = (ModelMatrix * vec4(position, 1.0f));
+	pass_Position = (ModelMatrix * vec4(position, 1.0f)).xyz;
 	//pass_Position = pass_Position + vec3(0.f, -3.f, 0.f);
 	pass_View = ViewMatrix;
 	pass_Model = ModelMatrix;
-	pass_Texture_Coor = in_Texture_Coor;
+	pass_Texture_Coor = vertex_texcoord(in_Texture_Coor);
 }
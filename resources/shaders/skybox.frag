@@ -0,0 +1,10 @@
+#version 150
+
+in vec3 pass_Direction;
+out vec4 out_Color;
+
+uniform samplerCube sky_texture;
+
+void main() {
+	out_Color = texture(sky_texture, pass_Direction);
+}
@@ -0,0 +1,15 @@
+#version 150
+
+// camera rotation and projection, inverted
+uniform mat4 InverseViewProjection;
+
+out vec3 pass_Direction;
+
+void main() {
+	// fullscreen triangle from vertex ids 0, 1, 2
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+	// on the far plane, behind everything else
+	gl_Position = vec4(position, 1.0, 1.0);
+	vec4 direction = InverseViewProjection * vec4(position, 1.0, 1.0);
+	pass_Direction = direction.xyz / direction.w;
+}
@@ -0,0 +1,21 @@
+#version 150
+#extension GL_ARB_explicit_attrib_location : require
+// position normalized to the bounds of the star chunk
+layout(location = 0) in vec3 in_Position;
+// color packed as rgb565
+layout(location = 1) in uint in_Color;
+
+//Matrix Uniforms uploaded with glUniform*
+uniform mat4 ModelViewMatrix;
+uniform mat4 ProjectionMatrix;
+// bounds of the drawn chunk
+uniform vec3 chunk_min;
+uniform vec3 chunk_extent;
+
+out vec3 pass_Color;
+
+void main() {
+	vec3 position = chunk_min + in_Position * chunk_extent;
+	gl_Position = ProjectionMatrix * ModelViewMatrix * vec4(position, 1.0);
+	pass_Color = vec3((in_Color >> 11u) & 31u, (in_Color >> 5u) & 63u, in_Color & 31u) / vec3(31.0, 63.0, 31.0);
+}
@@ -0,0 +1,24 @@
+#version 150
+
+// samples of all trails, slot major, followed by one color per trail
+uniform samplerBuffer trail_samples;
+// slot of the newest sample
+uniform int trail_head;
+uniform int trail_length;
+uniform int num_trails;
+
+//Matrix Uniforms uploaded with glUniform*
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+
+out vec3 pass_Color;
+
+void main() {
+	// vertex id is the age of the sample, instance id the trail
+	int slot = (trail_head - gl_VertexID + trail_length) % trail_length;
+	vec3 position = texelFetch(trail_samples, slot * num_trails + gl_InstanceID).xyz;
+	gl_Position = ProjectionMatrix * ViewMatrix * vec4(position, 1.0);
+	// fade out towards the oldest sample
+	vec3 color = texelFetch(trail_samples, trail_length * num_trails + gl_InstanceID).rgb;
+	pass_Color = color * (1.0 - float(gl_VertexID) / float(trail_length));
+}
@@ -0,0 +1,38 @@
+// decoding of the planet vertex attributes, see vertex_format::quantize
+#ifdef QUANTIZED_VERTICES
+// positions and texture coordinates arrive normalized to these bounds
+uniform vec3 position_min;
+uniform vec3 position_extent;
+uniform vec2 texcoord_min;
+uniform vec2 texcoord_extent;
+
+vec3 vertex_position(vec3 position) {
+  return position_min + position * position_extent;
+}
+
+// octahedral normal in xy
+vec3 vertex_normal(vec3 normal) {
+  vec3 n = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));
+  if (n.z < 0.0) {
+    vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    n.xy = (1.0 - abs(n.yx)) * signs;
+  }
+  return normalize(n);
+}
+
+vec2 vertex_texcoord(vec2 texcoord) {
+  return texcoord_min + texcoord * texcoord_extent;
+}
+#else
+vec3 vertex_position(vec3 position) {
+  return position;
+}
+
+vec3 vertex_normal(vec3 normal) {
+  return normal;
+}
+
+vec2 vertex_texcoord(vec2 texcoord) {
+  return texcoord;
+}
+#endif
@@ -10,6 +10,8 @@ class geometry_node : public Node{
     model geometry;
     glm::vec3 geo_color;
     texture_object geo_texture;
+    // layer of geo_texture if it is a texture array
+    int geo_layer = 0;
 
     // Methods
     model getGeometry();
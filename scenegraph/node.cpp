@@ -93,7 +93,8 @@ Node * Node::removeChildren(string child_name){
 }
 
 //Constructor
-Node::Node()
+Node::Node():
+    parent{NULL}
     {}
 
 Node::Node(string new_name, Node * new_parent, glm::mat4 new_localTransform):